@@ -4,12 +4,18 @@
 // Different function pointer types used by MR
 typedef char *(*Getter)(char *key, int partition_number);
 typedef void (*Mapper)(char *file_name);
+typedef void (*SplitMapper)(char *file_name, long offset, long length);
 typedef void (*Reducer)(char *key, Getter get_func, int partition_number);
 typedef unsigned long (*Partitioner)(char *key, int num_partitions);
+typedef char *(*CombineGetter)(char *key);
+typedef void (*Combiner)(char *key, CombineGetter get_func);
 
 // External functions: these are what you must define
 void MR_Emit(char *key, char *value);
 
+// Called from a Combiner to pass a combined value on to the reducers
+void MR_EmitToReducer(char *key, char *value);
+
 unsigned long MR_DefaultHashPartition(char *key, int num_partitions);
 
 void MR_Run(int argc, char *argv[], 
@@ -17,4 +23,29 @@ void MR_Run(int argc, char *argv[],
 	    Reducer reduce, int num_reducers, 
 	    Partitioner partition);
 
+// Same as MR_Run, but runs combine over each mapper's local output
+// before it is handed to the reducers
+void MR_RunWithCombiner(int argc, char *argv[], 
+			Mapper map, int num_mappers, 
+			Reducer reduce, int num_reducers, 
+			Combiner combine, 
+			Partitioner partition);
+
+// Tuning knobs for MR_RunEx; a zero field means "use the default"
+typedef struct {
+    Combiner combine;           // optional, as in MR_RunWithCombiner
+    unsigned long memory_limit; // bytes of buffered pairs before spilling
+    char *spill_dir;            // where spill files go (default: /tmp)
+    unsigned long arena_size;   // bytes per mapper arena block
+    SplitMapper split_map;      // if set, used instead of map
+    unsigned long split_size;   // target bytes per split
+    char *profile_file;         // if set, job metrics are written here
+} MR_Options;
+
+void MR_RunEx(int argc, char *argv[], 
+	      Mapper map, int num_mappers, 
+	      Reducer reduce, int num_reducers, 
+	      Partitioner partition, 
+	      MR_Options *options);
+
 #endif // __mapreduce_h__
@@ -34,53 +34,220 @@ unsigned int hashpower = HASHPOWER_DEFAULT;
 #define hashsize(n) ((uint64_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
-/* Main hash table. This is where we look except during expansion. */
-static item** primary_hashtable = 0;
-
 /*
- * Previous hash table. During expansion, we look here for keys that haven't
- * been moved over to the primary yet.
+ * The table layout is published as a single snapshot, so a thread always
+ * sees a matching power, primary and old table. A new snapshot is swapped in
+ * when expansion starts and when it finishes; worker threads are never
+ * paused for this.
+ *
+ * Buckets are only modified under their item lock, and the expansion thread
+ * moves an old bucket while holding the same lock. A thread still using the
+ * previous snapshot under that lock writes to the same old bucket the new
+ * snapshot expects, so either view is consistent. Replaced snapshots are
+ * kept on a retired list until the maintenance thread knows no reader can
+ * still hold them; see assoc_reclaim().
  */
-static item** old_hashtable = 0;
+struct assoc_table {
+    void *primary; /* where we look except during expansion */
+    /* Previous hash table. During expansion, we look here for keys that
+     * haven't been moved over to the primary yet. */
+    void *old;
+    /*
+     * During expansion we migrate values with bucket granularity; this is
+     * how far we've gotten so far. Ranges from 0 .. hashsize(hashpower - 1).
+     * Only advanced by the expansion thread while holding the bucket's lock.
+     */
+    uint64_t expand_bucket;
+    unsigned int hashpower;
+    bool expanding;
+    struct assoc_table *retired;
+};
 
-/* Flag: Are we in the middle of expanding now? */
-static bool expanding = false;
+static struct assoc_table *table = NULL;
 
 /*
- * During expansion we migrate values with bucket granularity; this is how
- * far we've gotten so far. Ranges from 0 .. hashsize(hashpower - 1) - 1.
+ * Bucketed index (-o hash_index=bucketed). Each bucket is one cache line
+ * holding a one byte tag from the hash for each slot, so a lookup only
+ * dereferences items whose tag matches. Items that don't fit chain off the
+ * bucket through h_next, like the chained index does. Buckets never share
+ * entries, so the item lock for a bucket still covers everything in it.
+ */
+#define ASSOC_BUCKET_SLOTS 6
+struct assoc_bucket {
+    uint8_t tags[ASSOC_BUCKET_SLOTS]; /* 0 is an empty slot */
+    uint16_t unused;
+    item *slots[ASSOC_BUCKET_SLOTS];
+    item *overflow;
+};
+
+/* Expand at this many items per bucket rather than 1.5. */
+#define ASSOC_BUCKET_LOAD 4
+
+static bool bucketed = false;
+
+/* The bucket index is the low hashpower bits, which reach into the top byte
+ * once the table is big enough, so the tag can't just be taken from there.
+ * Multiplying by an odd constant carries every bit of hv into the top byte,
+ * and items sharing a bucket differ only in the bits above the index, so
+ * they still get differing tags.
  */
-static uint64_t expand_bucket = 0;
+static inline uint8_t _hashtag(const uint32_t hv) {
+    uint8_t tag = (hv * 0x9e3779b1U) >> 24;
+    return tag ? tag : 1;
+}
+
+static inline size_t _bucket_size(void) {
+    return bucketed ? sizeof(struct assoc_bucket) : sizeof(item *);
+}
+
+static void *_table_alloc(const unsigned int power) {
+    void *t = NULL;
+    if (!bucketed) {
+        return calloc(hashsize(power), sizeof(void *));
+    }
+    if (posix_memalign(&t, 64, hashsize(power) * sizeof(struct assoc_bucket)) != 0) {
+        return NULL;
+    }
+    memset(t, 0, hashsize(power) * sizeof(struct assoc_bucket));
+    return t;
+}
+
+static inline struct assoc_table *assoc_table_get(void) {
+    return __atomic_load_n(&table, __ATOMIC_ACQUIRE);
+}
+
+static void assoc_table_publish(struct assoc_table *t) {
+    t->retired = table;
+    __atomic_store_n(&table, t, __ATOMIC_RELEASE);
+}
+
+/* returns the table and bucket index the hash value currently lives in */
+static inline void *_hashtable(struct assoc_table *t, const uint32_t hv, uint64_t *bucket) {
+    uint64_t oldbucket;
+
+    if (t->expanding &&
+        (oldbucket = (hv & hashmask(t->hashpower - 1))) >=
+            __atomic_load_n(&t->expand_bucket, __ATOMIC_ACQUIRE))
+    {
+        *bucket = oldbucket;
+        return t->old;
+    }
+    *bucket = hv & hashmask(t->hashpower);
+    return t->primary;
+}
+
+/* returns the head of the chain the hash value currently lives in */
+static inline item **_hashbucket(struct assoc_table *t, const uint32_t hv) {
+    uint64_t b;
+    item **ht = _hashtable(t, hv, &b);
+    return &ht[b];
+}
+
+static inline struct assoc_bucket *_tagbucket(struct assoc_table *t, const uint32_t hv) {
+    uint64_t b;
+    struct assoc_bucket *ht = _hashtable(t, hv, &b);
+    return &ht[b];
+}
+
+static item *_bucket_find(struct assoc_bucket *b, const char *key,
+        const size_t nkey, const uint8_t tag, int *depth) {
+    item *it;
+    for (int x = 0; x < ASSOC_BUCKET_SLOTS; x++) {
+        if (b->tags[x] != tag)
+            continue;
+        it = b->slots[x];
+        ++*depth;
+        if ((nkey == it->nkey) && (memcmp(key, ITEM_key(it), nkey) == 0)) {
+            return it;
+        }
+    }
+    for (it = b->overflow; it; it = it->h_next) {
+        ++*depth;
+        if ((nkey == it->nkey) && (memcmp(key, ITEM_key(it), nkey) == 0)) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+static void _bucket_insert(struct assoc_bucket *b, item *it, const uint8_t tag) {
+    for (int x = 0; x < ASSOC_BUCKET_SLOTS; x++) {
+        if (b->tags[x] == 0) {
+            b->slots[x] = it;
+            b->tags[x] = tag;
+            it->h_next = 0;
+            return;
+        }
+    }
+    it->h_next = b->overflow;
+    b->overflow = it;
+}
+
+static bool _bucket_delete(struct assoc_bucket *b, const char *key,
+        const size_t nkey, const uint8_t tag) {
+    item **pos;
+    for (int x = 0; x < ASSOC_BUCKET_SLOTS; x++) {
+        item *it = b->slots[x];
+        if (b->tags[x] == tag &&
+                (nkey == it->nkey) && (memcmp(key, ITEM_key(it), nkey) == 0)) {
+            b->tags[x] = 0;
+            b->slots[x] = NULL;
+            return true;
+        }
+    }
+    pos = &b->overflow;
+    while (*pos && ((nkey != (*pos)->nkey) || memcmp(key, ITEM_key(*pos), nkey))) {
+        pos = &(*pos)->h_next;
+    }
+    if (*pos) {
+        item *nxt = (*pos)->h_next;
+        (*pos)->h_next = 0;
+        *pos = nxt;
+        return true;
+    }
+    return false;
+}
 
 void assoc_init(const int hashtable_init) {
     if (hashtable_init) {
         hashpower = hashtable_init;
     }
-    primary_hashtable = calloc(hashsize(hashpower), sizeof(void *));
-    if (! primary_hashtable) {
+    bucketed = settings.hash_bucketed;
+    struct assoc_table *t = calloc(1, sizeof(struct assoc_table));
+    if (t != NULL) {
+        t->primary = _table_alloc(hashpower);
+    }
+    if (t == NULL || ! t->primary) {
         fprintf(stderr, "Failed to init hashtable.\n");
         exit(EXIT_FAILURE);
     }
+    t->hashpower = hashpower;
+    assoc_table_publish(t);
     STATS_LOCK();
     stats_state.hash_power_level = hashpower;
-    stats_state.hash_bytes = hashsize(hashpower) * sizeof(void *);
+    stats_state.hash_bytes = hashsize(hashpower) * _bucket_size();
     STATS_UNLOCK();
 }
 
+/* Callers still hold the item lock for hv. The table snapshot is read without
+ * any global lock, but the items in a bucket are not: slab memory is reused
+ * in place once an item is unlinked, so walking h_next or comparing keys
+ * without the item lock could follow a recycled item. Dropping the item lock
+ * here would need items themselves to go through a grace period first.
+ */
 item *assoc_find(const char *key, const size_t nkey, const uint32_t hv) {
     item *it;
-    uint64_t oldbucket;
+    item *ret = NULL;
+    int depth = 0;
 
-    if (expanding &&
-        (oldbucket = (hv & hashmask(hashpower - 1))) >= expand_bucket)
-    {
-        it = old_hashtable[oldbucket];
-    } else {
-        it = primary_hashtable[hv & hashmask(hashpower)];
+    if (bucketed) {
+        ret = _bucket_find(_tagbucket(assoc_table_get(), hv), key, nkey,
+                _hashtag(hv), &depth);
+        MEMCACHED_ASSOC_FIND(key, nkey, depth);
+        return ret;
     }
 
-    item *ret = NULL;
-    int depth = 0;
+    it = *_hashbucket(assoc_table_get(), hv);
     while (it) {
         if ((nkey == it->nkey) && (memcmp(key, ITEM_key(it), nkey) == 0)) {
             ret = it;
@@ -97,16 +264,7 @@ item *assoc_find(const char *key, const size_t nkey, const uint32_t hv) {
    the item wasn't found */
 
 static item** _hashitem_before (const char *key, const size_t nkey, const uint32_t hv) {
-    item **pos;
-    uint64_t oldbucket;
-
-    if (expanding &&
-        (oldbucket = (hv & hashmask(hashpower - 1))) >= expand_bucket)
-    {
-        pos = &old_hashtable[oldbucket];
-    } else {
-        pos = &primary_hashtable[hv & hashmask(hashpower)];
-    }
+    item **pos = _hashbucket(assoc_table_get(), hv);
 
     while (*pos && ((nkey != (*pos)->nkey) || memcmp(key, ITEM_key(*pos), nkey))) {
         pos = &(*pos)->h_next;
@@ -116,29 +274,90 @@ static item** _hashitem_before (const char *key, const size_t nkey, const uint32
 
 /* grows the hashtable to the next power of 2. */
 static void assoc_expand(void) {
-    old_hashtable = primary_hashtable;
+    struct assoc_table *cur = table;
+    struct assoc_table *t = calloc(1, sizeof(struct assoc_table));
+    if (t == NULL) {
+        /* Bad news, but we can keep running. */
+        return;
+    }
 
-    primary_hashtable = calloc(hashsize(hashpower + 1), sizeof(void *));
-    if (primary_hashtable) {
+    t->primary = _table_alloc(cur->hashpower + 1);
+    if (t->primary) {
         if (settings.verbose > 1)
             fprintf(stderr, "Hash table expansion starting\n");
-        hashpower++;
-        expanding = true;
-        expand_bucket = 0;
+        t->old = cur->primary;
+        t->hashpower = cur->hashpower + 1;
+        t->expanding = true;
+        assoc_table_publish(t);
+        hashpower = t->hashpower;
         STATS_LOCK();
         stats_state.hash_power_level = hashpower;
-        stats_state.hash_bytes += hashsize(hashpower) * sizeof(void *);
+        stats_state.hash_bytes += hashsize(hashpower) * _bucket_size();
         stats_state.hash_is_expanding = true;
         STATS_UNLOCK();
     } else {
-        primary_hashtable = old_hashtable;
+        free(t);
         /* Bad news, but we can keep running. */
     }
 }
 
+/* all buckets have moved; nobody can look in the old table anymore. */
+static void assoc_expand_done(void) {
+    struct assoc_table *cur = table;
+    struct assoc_table *t = calloc(1, sizeof(struct assoc_table));
+    if (t == NULL) {
+        /* leave the finished expansion published; lookups still work. */
+        return;
+    }
+    t->primary = cur->primary;
+    t->hashpower = cur->hashpower;
+    assoc_table_publish(t);
+    free(cur->old);
+    STATS_LOCK();
+    stats_state.hash_bytes -= hashsize(t->hashpower - 1) * _bucket_size();
+    stats_state.hash_is_expanding = false;
+    STATS_UNLOCK();
+    if (settings.verbose > 1)
+        fprintf(stderr, "Hash table expansion done\n");
+}
+
+/* Frees retired snapshots once nobody can be using them. Every reader looks
+ * the snapshot up and uses it while holding the item lock for its bucket, so
+ * after each item lock has been taken and dropped since the current snapshot
+ * was published, no reader is left holding an older one. Only called from
+ * the maintenance thread, without any item lock held, and it's once or twice
+ * per expansion so walking the lock table is cheap enough.
+ */
+static void assoc_reclaim(void) {
+    struct assoc_table *t = table;
+    struct assoc_table *old = t->retired;
+    if (old == NULL)
+        return;
+    t->retired = NULL;
+
+    for (uint64_t x = 0; x < hashsize(item_lock_hashpower); x++) {
+        item_lock(x);
+        item_unlock(x);
+    }
+
+    while (old != NULL) {
+        struct assoc_table *next = old->retired;
+        free(old);
+        old = next;
+    }
+}
+
+static inline bool assoc_expanding(void) {
+    struct assoc_table *t = table;
+    return t->expanding &&
+        t->expand_bucket < hashsize(t->hashpower - 1);
+}
+
 void assoc_start_expand(uint64_t curr_items) {
+    uint64_t limit = bucketed ? hashsize(hashpower) * ASSOC_BUCKET_LOAD
+        : (hashsize(hashpower) * 3) / 2;
     if (pthread_mutex_trylock(&maintenance_lock) == 0) {
-        if (curr_items > (hashsize(hashpower) * 3) / 2 && hashpower < HASHPOWER_MAX) {
+        if (curr_items > limit && hashpower < HASHPOWER_MAX) {
             pthread_cond_signal(&maintenance_cond);
         }
         pthread_mutex_unlock(&maintenance_lock);
@@ -147,18 +366,14 @@ void assoc_start_expand(uint64_t curr_items) {
 
 /* Note: this isn't an assoc_update.  The key must not already exist to call this */
 int assoc_insert(item *it, const uint32_t hv) {
-    uint64_t oldbucket;
-
 //    assert(assoc_find(ITEM_key(it), it->nkey) == 0);  /* shouldn't have duplicately named things defined */
 
-    if (expanding &&
-        (oldbucket = (hv & hashmask(hashpower - 1))) >= expand_bucket)
-    {
-        it->h_next = old_hashtable[oldbucket];
-        old_hashtable[oldbucket] = it;
+    if (bucketed) {
+        _bucket_insert(_tagbucket(assoc_table_get(), hv), it, _hashtag(hv));
     } else {
-        it->h_next = primary_hashtable[hv & hashmask(hashpower)];
-        primary_hashtable[hv & hashmask(hashpower)] = it;
+        item **bucket = _hashbucket(assoc_table_get(), hv);
+        it->h_next = *bucket;
+        *bucket = it;
     }
 
     MEMCACHED_ASSOC_INSERT(ITEM_key(it), it->nkey);
@@ -166,6 +381,17 @@ int assoc_insert(item *it, const uint32_t hv) {
 }
 
 void assoc_delete(const char *key, const size_t nkey, const uint32_t hv) {
+    if (bucketed) {
+        bool found = _bucket_delete(_tagbucket(assoc_table_get(), hv), key, nkey,
+                _hashtag(hv));
+        /* callers don't delete things they can't find. */
+        assert(found);
+        if (found) {
+            MEMCACHED_ASSOC_DELETE(key, nkey);
+        }
+        return;
+    }
+
     item **before = _hashitem_before(key, nkey, hv);
 
     if (*before) {
@@ -185,6 +411,27 @@ void assoc_delete(const char *key, const size_t nkey, const uint32_t hv) {
 }
 
 
+/* moves everything in an old bucket over to the new table */
+static void _bucket_move(struct assoc_table *t, const uint64_t oldbucket) {
+    struct assoc_bucket *old = &((struct assoc_bucket *)t->old)[oldbucket];
+    struct assoc_bucket *primary = t->primary;
+    item *it, *next;
+    uint32_t hv;
+
+    for (int x = 0; x < ASSOC_BUCKET_SLOTS; x++) {
+        if ((it = old->slots[x]) == NULL)
+            continue;
+        hv = hash(ITEM_key(it), it->nkey);
+        _bucket_insert(&primary[hv & hashmask(t->hashpower)], it, _hashtag(hv));
+    }
+    for (it = old->overflow; NULL != it; it = next) {
+        next = it->h_next;
+        hv = hash(ITEM_key(it), it->nkey);
+        _bucket_insert(&primary[hv & hashmask(t->hashpower)], it, _hashtag(hv));
+    }
+    memset(old, 0, sizeof(*old));
+}
+
 static volatile int do_run_maintenance_thread = 1;
 
 #define DEFAULT_HASH_BULK_MOVE 1
@@ -197,35 +444,35 @@ static void *assoc_maintenance_thread(void *arg) {
         int ii = 0;
 
         /* There is only one expansion thread, so no need to global lock. */
-        for (ii = 0; ii < hash_bulk_move && expanding; ++ii) {
+        for (ii = 0; ii < hash_bulk_move && assoc_expanding(); ++ii) {
             item *it, *next;
             uint64_t bucket;
             void *item_lock = NULL;
+            struct assoc_table *t = table;
 
             /* bucket = hv & hashmask(hashpower) =>the bucket of hash table
              * is the lowest N bits of the hv, and the bucket of item_locks is
              *  also the lowest M bits of hv, and N is greater than M.
              *  So we can process expanding with only one item_lock. cool! */
-            if ((item_lock = item_trylock(expand_bucket))) {
-                    for (it = old_hashtable[expand_bucket]; NULL != it; it = next) {
+            if ((item_lock = item_trylock(t->expand_bucket))) {
+                if (bucketed) {
+                    _bucket_move(t, t->expand_bucket);
+                } else {
+                    item **old = t->old;
+                    item **primary = t->primary;
+                    for (it = old[t->expand_bucket]; NULL != it; it = next) {
                         next = it->h_next;
-                        bucket = hash(ITEM_key(it), it->nkey) & hashmask(hashpower);
-                        it->h_next = primary_hashtable[bucket];
-                        primary_hashtable[bucket] = it;
+                        bucket = hash(ITEM_key(it), it->nkey) & hashmask(t->hashpower);
+                        it->h_next = primary[bucket];
+                        primary[bucket] = it;
                     }
 
-                    old_hashtable[expand_bucket] = NULL;
-
-                    expand_bucket++;
-                    if (expand_bucket == hashsize(hashpower - 1)) {
-                        expanding = false;
-                        free(old_hashtable);
-                        STATS_LOCK();
-                        stats_state.hash_bytes -= hashsize(hashpower - 1) * sizeof(void *);
-                        stats_state.hash_is_expanding = false;
-                        STATS_UNLOCK();
-                        if (settings.verbose > 1)
-                            fprintf(stderr, "Hash table expansion done\n");
+                    old[t->expand_bucket] = NULL;
+                }
+
+                    __atomic_store_n(&t->expand_bucket, t->expand_bucket + 1, __ATOMIC_RELEASE);
+                    if (t->expand_bucket == hashsize(t->hashpower - 1)) {
+                        assoc_expand_done();
                     }
 
             } else {
@@ -238,20 +485,14 @@ static void *assoc_maintenance_thread(void *arg) {
             }
         }
 
-        if (!expanding) {
+        if (!assoc_expanding()) {
+            assoc_reclaim();
             /* We are done expanding.. just wait for next invocation */
             pthread_cond_wait(&maintenance_cond, &maintenance_lock);
-            /* assoc_expand() swaps out the hash table entirely, so we need
-             * all threads to not hold any references related to the hash
-             * table while this happens.
-             * This is instead of a more complex, possibly slower algorithm to
-             * allow dynamic hash table expansion without causing significant
-             * wait times.
-             */
+            /* assoc_expand() publishes a new table snapshot, which readers
+             * pick up on their next lookup. See struct assoc_table. */
             if (do_run_maintenance_thread) {
-                pause_threads(PAUSE_ALL_THREADS);
                 assoc_expand();
-                pause_threads(RESUME_ALL_THREADS);
             }
         }
     }
@@ -291,8 +532,8 @@ void stop_assoc_maintenance_thread() {
 
 struct assoc_iterator {
     uint64_t bucket;
-    item *it;
     item *next;
+    int slot;
     bool bucket_locked;
 };
 
@@ -306,38 +547,52 @@ void *assoc_get_iterator(void) {
     return iter;
 }
 
+/* next item in the locked bucket. the caller may unlink the returned item,
+ * so the position past it is saved first. */
+static item *_iter_next(struct assoc_table *t, struct assoc_iterator *iter) {
+    item *it;
+    if (bucketed) {
+        struct assoc_bucket *b = &((struct assoc_bucket *)t->primary)[iter->bucket];
+        while (iter->slot < ASSOC_BUCKET_SLOTS) {
+            if ((it = b->slots[iter->slot++]) != NULL)
+                return it;
+        }
+        if (iter->slot == ASSOC_BUCKET_SLOTS) {
+            iter->slot++;
+            iter->next = b->overflow;
+        }
+    }
+    if ((it = iter->next) != NULL) {
+        iter->next = it->h_next;
+    }
+    return it;
+}
+
 bool assoc_iterate(void *iterp, item **it) {
     struct assoc_iterator *iter = (struct assoc_iterator *) iterp;
+    // - only check the primary hash table since expand is blocked.
+    struct assoc_table *t = assoc_table_get();
     *it = NULL;
     // - if locked bucket and next, update next and return
     if (iter->bucket_locked) {
-        if (iter->next != NULL) {
-            iter->it = iter->next;
-            iter->next = iter->it->h_next;
-            *it = iter->it;
-        } else {
+        if ((*it = _iter_next(t, iter)) == NULL) {
             // unlock previous bucket, if any
             item_unlock(iter->bucket);
             // iterate the bucket post since it starts at 0.
             iter->bucket++;
             iter->bucket_locked = false;
-            *it = NULL;
         }
         return true;
     }
 
     // - loop until we hit the end or find something.
-    if (iter->bucket != hashsize(hashpower)) {
+    if (iter->bucket != hashsize(t->hashpower)) {
         // - lock next bucket
         item_lock(iter->bucket);
         iter->bucket_locked = true;
-        // - only check the primary hash table since expand is blocked.
-        iter->it = primary_hashtable[iter->bucket];
-        if (iter->it != NULL) {
-            // - set it, next and return
-            iter->next = iter->it->h_next;
-            *it = iter->it;
-        } else {
+        iter->slot = 0;
+        iter->next = bucketed ? NULL : ((item **)t->primary)[iter->bucket];
+        if ((*it = _iter_next(t, iter)) == NULL) {
             // - nothing found in this bucket, try next.
             item_unlock(iter->bucket);
             iter->bucket_locked = false;
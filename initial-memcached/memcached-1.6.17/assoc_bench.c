@@ -0,0 +1,158 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Microbenchmark for the hash table index layouts in assoc.c.
+ *
+ * Builds a table of synthetic items for each -o hash_index= mode and times
+ * hits and misses in random order. Items are allocated in shuffled order so
+ * chasing into them costs a cache miss, as it does in a loaded slab.
+ *
+ * usage: assoc_bench [items] [hashpower]
+ */
+#include "memcached.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* assoc.c only needs a few symbols from the rest of the server. */
+struct settings settings;
+struct stats_state stats_state;
+unsigned int item_lock_hashpower;
+
+void STATS_LOCK(void) {
+}
+
+void STATS_UNLOCK(void) {
+}
+
+void item_lock(uint32_t hv) {
+}
+
+void item_unlock(uint32_t hv) {
+}
+
+void *item_trylock(uint32_t hv) {
+    return &settings;
+}
+
+void item_trylock_unlock(void *lock) {
+}
+
+#define KEY_MAX 32
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void shuffle(uint32_t *order, uint32_t count) {
+    for (uint32_t x = count - 1; x > 0; x--) {
+        uint32_t y = random() % (x + 1);
+        uint32_t tmp = order[x];
+        order[x] = order[y];
+        order[y] = tmp;
+    }
+}
+
+static double run_lookups(char *keys, uint32_t *hvs, uint32_t *order,
+        uint32_t count, uint32_t *found) {
+    uint64_t start = now_ns();
+    *found = 0;
+    for (uint32_t x = 0; x < count; x++) {
+        char *key = &keys[order[x] * KEY_MAX];
+        if (assoc_find(key, strlen(key), hvs[order[x]]) != NULL)
+            (*found)++;
+    }
+    return (double)(now_ns() - start) / count;
+}
+
+static void bench(const char *name, uint32_t count, int power) {
+    item **items = calloc(count, sizeof(item *));
+    char *keys = calloc(count, KEY_MAX);
+    char *misses = calloc(count, KEY_MAX);
+    uint32_t *hvs = calloc(count, sizeof(uint32_t));
+    uint32_t *mhvs = calloc(count, sizeof(uint32_t));
+    uint32_t *order = calloc(count, sizeof(uint32_t));
+    uint32_t found;
+    double hit_ns, miss_ns;
+
+    if (!items || !keys || !misses || !hvs || !mhvs || !order) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (uint32_t x = 0; x < count; x++)
+        order[x] = x;
+    shuffle(order, count);
+
+    assoc_init(power);
+    for (uint32_t x = 0; x < count; x++) {
+        uint32_t i = order[x];
+        char *key = &keys[i * KEY_MAX];
+        int nkey = snprintf(key, KEY_MAX, "bench:key:%u", i);
+        snprintf(&misses[i * KEY_MAX], KEY_MAX, "bench:miss:%u", i);
+        hvs[i] = hash(key, nkey);
+        mhvs[i] = hash(&misses[i * KEY_MAX], strlen(&misses[i * KEY_MAX]));
+
+        item *it = calloc(1, sizeof(item) + nkey + 1);
+        it->nkey = nkey;
+        memcpy(ITEM_key(it), key, nkey + 1);
+        items[i] = it;
+        assoc_insert(it, hvs[i]);
+    }
+
+    shuffle(order, count);
+    hit_ns = run_lookups(keys, hvs, order, count, &found);
+    if (found != count) {
+        fprintf(stderr, "%s: only found %u of %u items\n", name, found, count);
+        exit(EXIT_FAILURE);
+    }
+    miss_ns = run_lookups(misses, mhvs, order, count, &found);
+
+    printf("%-10s items: %u hashpower: %d table bytes: %llu hit: %.1f ns miss: %.1f ns\n",
+            name, count, power, (unsigned long long)stats_state.hash_bytes,
+            hit_ns, miss_ns);
+
+    for (uint32_t x = 0; x < count; x++) {
+        assoc_delete(ITEM_key(items[x]), items[x]->nkey, hvs[x]);
+        free(items[x]);
+    }
+    free(items);
+    free(keys);
+    free(misses);
+    free(hvs);
+    free(mhvs);
+    free(order);
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = 4000000;
+    int power;
+
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 10);
+    // size the table the way a running server would end up: the chained
+    // index grows past 1.5 items per bucket, the bucketed one past 4.
+    power = 12;
+    while (power < HASHPOWER_MAX && ((uint64_t)1 << power) * 3 / 2 < count)
+        power++;
+    if (argc > 2)
+        power = atoi(argv[2]);
+
+    hash_init(MURMUR3_HASH);
+    srandom(1);
+
+    settings.hash_bucketed = false;
+    bench("chained", count, power);
+
+    power = 12;
+    while (power < HASHPOWER_MAX && ((uint64_t)1 << power) * 4 < count)
+        power++;
+    if (argc > 2)
+        power = atoi(argv[2]);
+    settings.hash_bucketed = true;
+    bench("bucketed", count, power);
+
+    return 0;
+}
@@ -17,6 +17,10 @@
 #include <assert.h>
 #include "extstore.h"
 #include "config.h"
+#ifdef EXTSTORE_URING
+#include <errno.h>
+#include <liburing.h>
+#endif
 
 // TODO: better if an init option turns this on/off.
 #ifdef EXTSTORE_DEBUG
@@ -49,6 +53,7 @@ typedef struct __store_wbuf {
     unsigned int free;
     unsigned int size;
     unsigned int offset; /* offset into page this write starts at */
+    int buf_index; /* index into registered io_uring buffers */
     bool full; /* done writing to this page */
     bool flushed; /* whether wbuf has been flushed to disk */
 } _store_wbuf;
@@ -65,6 +70,7 @@ typedef struct _store_page {
     unsigned int bucket; /* which bucket the page is linked into */
     unsigned int free_bucket; /* which bucket this page returns to when freed */
     int fd;
+    int direct_fd; /* O_DIRECT fd for full wbuf writes, or -1 */
     unsigned short id;
     bool active; /* actively being written to */
     bool closed; /* closed and draining before free */
@@ -81,6 +87,11 @@ typedef struct {
     obj_io *queue_tail;
     store_engine *e;
     unsigned int depth; // queue depth
+#ifdef EXTSTORE_URING
+    struct io_uring ring;
+    unsigned int ring_entries;
+    bool fixed_bufs; /* wbufs registered with this ring */
+#endif
 } store_io_thread;
 
 typedef struct {
@@ -108,19 +119,26 @@ struct store_engine {
     unsigned int page_bucketcount; /* count of potential page buckets */
     unsigned int free_page_bucketcount; /* count of free page buckets */
     unsigned int io_depth; /* FIXME: Might cache into thr struct */
+    unsigned int wbuf_count;
+    struct iovec *wbuf_iovs; /* wbuf memory, for io_uring registration */
+    bool io_uring; /* IO threads submit through io_uring */
     pthread_mutex_t stats_mutex;
     struct extstore_stats stats;
 };
 
+// wbufs are page aligned so they can be written with O_DIRECT.
+#define WBUF_ALIGN 4096
+
 static _store_wbuf *wbuf_new(size_t size) {
     _store_wbuf *b = calloc(1, sizeof(_store_wbuf));
     if (b == NULL)
         return NULL;
-    b->buf = calloc(size, sizeof(char));
-    if (b->buf == NULL) {
+    if (posix_memalign((void **)&b->buf, WBUF_ALIGN, size) != 0) {
         free(b);
         return NULL;
     }
+    memset(b->buf, 0, size);
+    b->buf_index = -1;
     b->buf_pos = b->buf;
     b->free = size;
     b->size = size;
@@ -153,6 +171,9 @@ static uint64_t _next_version(store_engine *e) {
 }
 
 static void *extstore_io_thread(void *arg);
+#ifdef EXTSTORE_URING
+static void *extstore_io_thread_uring(void *arg);
+#endif
 static void *extstore_maint_thread(void *arg);
 
 /* Copies stats internal to engine and computes any derived values */
@@ -213,10 +234,31 @@ const char *extstore_err(enum extstore_res res) {
             break;
         case EXTSTORE_INIT_THREAD_FAIL:
             break;
+        case EXTSTORE_INIT_NO_URING:
+            rv = "io_uring requested but not available";
+            break;
     }
     return rv;
 }
 
+#ifdef EXTSTORE_URING
+// The ring has room for a full batch from the queue, with slack for the
+// wbuf flushes which share it.
+static int _io_uring_setup(store_engine *e, store_io_thread *t) {
+    unsigned int entries = e->io_depth < 64 ? 64 : e->io_depth * 2;
+    if (io_uring_queue_init(entries, &t->ring, 0) != 0) {
+        return -1;
+    }
+    t->ring_entries = t->ring.sq.ring_entries;
+    // registered buffers skip the per-IO page pinning for wbuf writes. not
+    // fatal if the memlock limit is too low; plain writes are used instead.
+    if (io_uring_register_buffers(&t->ring, e->wbuf_iovs, e->wbuf_count) == 0) {
+        t->fixed_bufs = true;
+    }
+    return 0;
+}
+#endif
+
 // TODO: #define's for DEFAULT_BUCKET, FREE_VERSION, etc
 void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
         enum extstore_res *res) {
@@ -245,12 +287,25 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
         return NULL;
     }
 
+#ifndef EXTSTORE_URING
+    if (cf->io_uring) {
+        *res = EXTSTORE_INIT_NO_URING;
+        return NULL;
+    }
+#endif
+
     store_engine *e = calloc(1, sizeof(store_engine));
     if (e == NULL) {
         *res = EXTSTORE_INIT_OOM;
         return NULL;
     }
 
+    // so the error path knows which files were opened.
+    for (f = fh; f != NULL; f = f->next) {
+        f->fd = -1;
+        f->direct_fd = -1;
+    }
+
     e->page_size = cf->page_size;
     uint64_t temp_page_count = 0;
     for (f = fh; f != NULL; f = f->next) {
@@ -260,8 +315,7 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
 #ifdef EXTSTORE_DEBUG
             perror("extstore open");
 #endif
-            free(e);
-            return NULL;
+            goto error;
         }
         // use an fcntl lock to help avoid double starting.
         struct flock lock;
@@ -271,32 +325,36 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
         lock.l_len = 0;
         if (fcntl(f->fd, F_SETLK, &lock) < 0) {
             *res = EXTSTORE_INIT_OPEN_FAIL;
-            free(e);
-            return NULL;
+            goto error;
         }
         if (ftruncate(f->fd, 0) < 0) {
             *res = EXTSTORE_INIT_OPEN_FAIL;
-            free(e);
-            return NULL;
+            goto error;
         }
 
+#ifdef O_DIRECT
+        // full wbufs are aligned in memory and on disk, so the io_uring
+        // engine can write them around the page cache. reads stay buffered
+        // as items are not aligned.
+        if (cf->io_uring) {
+            f->direct_fd = open(f->file, O_RDWR | O_DIRECT);
+        }
+#endif
+
         temp_page_count += f->page_count;
         f->offset = 0;
     }
 
     if (temp_page_count >= UINT16_MAX) {
         *res = EXTSTORE_INIT_TOO_MANY_PAGES;
-        free(e);
-        return NULL;
+        goto error;
     }
     e->page_count = temp_page_count;
 
     e->pages = calloc(e->page_count, sizeof(store_page));
     if (e->pages == NULL) {
         *res = EXTSTORE_INIT_OOM;
-        // FIXME: loop-close. make error label
-        free(e);
-        return NULL;
+        goto error;
     }
 
     // interleave the pages between devices
@@ -318,6 +376,7 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
         pthread_mutex_init(&e->pages[i].mutex, NULL);
         e->pages[i].id = i;
         e->pages[i].fd = f->fd;
+        e->pages[i].direct_fd = f->direct_fd;
         e->pages[i].free_bucket = f->free_bucket;
         e->pages[i].offset = f->offset;
         e->pages[i].free = true;
@@ -355,10 +414,27 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
 
     // allocate write buffers
     // also IO's to use for shipping to IO thread
+    e->wbuf_iovs = calloc(cf->wbuf_count, sizeof(struct iovec));
+    if (e->wbuf_iovs == NULL) {
+        *res = EXTSTORE_INIT_OOM;
+        goto error;
+    }
+    e->wbuf_count = cf->wbuf_count;
     for (i = 0; i < cf->wbuf_count; i++) {
         _store_wbuf *w = wbuf_new(cf->wbuf_size);
         obj_io *io = calloc(1, sizeof(obj_io));
-        /* TODO: on error, loop again and free stack. */
+        if (w == NULL || io == NULL) {
+            if (w != NULL) {
+                free(w->buf);
+                free(w);
+            }
+            free(io);
+            *res = EXTSTORE_INIT_OOM;
+            goto error;
+        }
+        w->buf_index = i;
+        e->wbuf_iovs[i].iov_base = w->buf;
+        e->wbuf_iovs[i].iov_len = w->size;
         w->next = e->wbuf_stack;
         e->wbuf_stack = w;
         io->next = e->io_stack;
@@ -369,15 +445,42 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
     pthread_mutex_init(&e->stats_mutex, NULL);
 
     e->io_depth = cf->io_depth;
+    e->io_uring = cf->io_uring;
 
-    // spawn threads
     e->io_threads = calloc(cf->io_threadcount, sizeof(store_io_thread));
+    if (e->io_threads == NULL) {
+        *res = EXTSTORE_INIT_OOM;
+        goto error;
+    }
+#ifdef EXTSTORE_URING
+    // set up every ring before any thread starts, so a failure here has
+    // nothing running to stop.
+    if (e->io_uring) {
+        for (i = 0; i < cf->io_threadcount; i++) {
+            if (_io_uring_setup(e, &e->io_threads[i]) != 0) {
+                *res = EXTSTORE_INIT_NO_URING;
+                while (--i >= 0) {
+                    io_uring_queue_exit(&e->io_threads[i].ring);
+                }
+                goto error;
+            }
+        }
+    }
+#endif
+
+    // spawn threads
     for (i = 0; i < cf->io_threadcount; i++) {
+        void *(*io_thread)(void *) = extstore_io_thread;
         pthread_mutex_init(&e->io_threads[i].mutex, NULL);
         pthread_cond_init(&e->io_threads[i].cond, NULL);
         e->io_threads[i].e = e;
+#ifdef EXTSTORE_URING
+        if (e->io_uring) {
+            io_thread = extstore_io_thread_uring;
+        }
+#endif
         // FIXME: error handling
-        pthread_create(&thread, NULL, extstore_io_thread, &e->io_threads[i]);
+        pthread_create(&thread, NULL, io_thread, &e->io_threads[i]);
     }
     e->io_threadcount = cf->io_threadcount;
 
@@ -391,6 +494,38 @@ void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf,
     extstore_run_maint(e);
 
     return (void *)e;
+
+error:
+    // nothing has been started yet; release what was allocated and opened.
+    while (e->wbuf_stack != NULL) {
+        _store_wbuf *w = e->wbuf_stack;
+        e->wbuf_stack = w->next;
+        free(w->buf);
+        free(w);
+    }
+    while (e->io_stack != NULL) {
+        obj_io *io = e->io_stack;
+        e->io_stack = io->next;
+        free(io);
+    }
+    free(e->io_threads);
+    free(e->wbuf_iovs);
+    free(e->page_buckets);
+    free(e->stats.page_data);
+    free(e->free_page_buckets);
+    free(e->pages);
+    for (f = fh; f != NULL; f = f->next) {
+        if (f->direct_fd >= 0) {
+            close(f->direct_fd);
+            f->direct_fd = -1;
+        }
+        if (f->fd >= 0) {
+            close(f->fd);
+            f->fd = -1;
+        }
+    }
+    free(e);
+    return NULL;
 }
 
 void extstore_run_maint(void *ptr) {
@@ -580,19 +715,76 @@ int extstore_write_request(void *ptr, unsigned int bucket,
     return ret;
 }
 
-/* _must_ be called after a successful write_request.
- * fills the rest of io structure.
+/* Like extstore_write_request(), but takes a stack of objects for the same
+ * bucket and hands out space for as many as fit in the page's current write
+ * buffer, under a single page lock. Returns the number of objects from the
+ * head of the stack which got a buffer, or -1 if none did. The page is left
+ * locked; the caller copies into each io->buf in order, then calls
+ * extstore_write_batch() with the same count.
  */
-void extstore_write(void *ptr, obj_io *io) {
+int extstore_write_request_batch(void *ptr, unsigned int bucket,
+        unsigned int free_bucket, obj_io *io) {
     store_engine *e = (store_engine *)ptr;
+    int count = 1;
+
+    if (extstore_write_request(ptr, bucket, free_bucket, io) != 0)
+        return -1;
+
     store_page *p = &e->pages[io->page_id];
+    unsigned int free = p->wbuf->free - io->len;
+    char *pos = io->buf + io->len;
+    for (obj_io *tio = io->next; tio != NULL && tio->len <= free; tio = tio->next) {
+        tio->buf = pos;
+        tio->page_id = p->id;
+        pos += tio->len;
+        free -= tio->len;
+        count++;
+    }
 
+    return count;
+}
+
+// fills in where the object landed. called with the page locked.
+static void _write_commit(store_page *p, obj_io *io) {
     io->offset = p->wbuf->offset + (p->wbuf->size - p->wbuf->free);
     io->page_version = p->version;
     p->wbuf->buf_pos += io->len;
     p->wbuf->free -= io->len;
     p->bytes_used += io->len;
     p->obj_count++;
+}
+
+/* _must_ be called after a successful write_request_batch, with the count
+ * it returned. fills the rest of each io structure and unlocks the page.
+ */
+void extstore_write_batch(void *ptr, obj_io *io, int count) {
+    store_engine *e = (store_engine *)ptr;
+    store_page *p = &e->pages[io->page_id];
+    uint64_t bytes = 0;
+
+    for (int x = 0; x < count; x++, io = io->next) {
+        _write_commit(p, io);
+        bytes += io->len;
+    }
+    STAT_L(e);
+    e->stats.bytes_written += bytes;
+    e->stats.bytes_used += bytes;
+    e->stats.objects_written += count;
+    e->stats.objects_used += count;
+    e->stats.write_batches++;
+    STAT_UL(e);
+
+    pthread_mutex_unlock(&p->mutex);
+}
+
+/* _must_ be called after a successful write_request.
+ * fills the rest of io structure.
+ */
+void extstore_write(void *ptr, obj_io *io) {
+    store_engine *e = (store_engine *)ptr;
+    store_page *p = &e->pages[io->page_id];
+
+    _write_commit(p, io);
     STAT_L(e);
     e->stats.bytes_written += io->len;
     e->stats.bytes_used += io->len;
@@ -693,6 +885,31 @@ int extstore_check(void *ptr, unsigned int page_id, uint64_t page_version) {
     return ret;
 }
 
+/* Lock-free check that a read could succeed, so dead reads never get queued.
+ * The page must exist, still be at the read's version and open, and the
+ * object must lie inside space handed out for that version. Versions only
+ * move forward, so a read found dead here stays dead; one that races with a
+ * page being recycled is caught again by _io_read_prep().
+ */
+int extstore_check_read(void *ptr, obj_io *io) {
+    store_engine *e = (store_engine *)ptr;
+    if (io->page_id < e->page_count) {
+        store_page *p = &e->pages[io->page_id];
+        if (__atomic_load_n(&p->version, __ATOMIC_RELAXED) == io->page_version
+                && !__atomic_load_n(&p->closed, __ATOMIC_RELAXED)
+                && !__atomic_load_n(&p->free, __ATOMIC_RELAXED)
+                && (uint64_t)io->offset + io->len <= __atomic_load_n(&p->allocated, __ATOMIC_RELAXED)) {
+            return 0;
+        }
+    }
+
+    STAT_L(e);
+    e->stats.reads_skipped++;
+    e->stats.bytes_skipped += io->len;
+    STAT_UL(e);
+    return -1;
+}
+
 /* allows a compactor to say "we're done with this page, kill it. */
 void extstore_close_page(void *ptr, unsigned int page_id, uint64_t page_version) {
     store_engine *e = (store_engine *)ptr;
@@ -731,6 +948,76 @@ static inline int _read_from_wbuf(store_page *p, obj_io *io) {
     return io->len;
 }
 
+/* Checks a read against its page before the IO is issued. Returns 1 if the
+ * caller has to read from disk, in which case a page refcount is held until
+ * _io_finish(). Otherwise *ret is the final result.
+ */
+static int _io_read_prep(store_engine *e, store_page *p, obj_io *io, int *ret) {
+    int do_op = 1;
+    // Page is currently open. deal if read is past the end.
+    pthread_mutex_lock(&p->mutex);
+    if (!p->free && !p->closed && p->version == io->page_version) {
+        if (p->active && io->offset >= p->written) {
+            *ret = _read_from_wbuf(p, io);
+            do_op = 0;
+        } else {
+            p->refcount++;
+        }
+        STAT_L(e);
+        e->stats.bytes_read += io->len;
+        e->stats.objects_read++;
+        STAT_UL(e);
+    } else {
+        do_op = 0;
+        *ret = -2; // TODO: enum in IO for status?
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return do_op;
+}
+
+static void _io_finish(store_engine *e, store_page *p, obj_io *io, int ret, int do_op) {
+    if (ret == 0) {
+        E_DEBUG("read returned nothing\n");
+    }
+
+#ifdef EXTSTORE_DEBUG
+    if (ret == -1) {
+        perror("read/write op failed");
+    }
+#endif
+    io->cb(e, io, ret);
+    if (do_op) {
+        pthread_mutex_lock(&p->mutex);
+        p->refcount--;
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+/* Pull and disconnect a batch of up to max IO's from the queue.
+ * Call with me->mutex held.
+ */
+static obj_io *_io_queue_pull(store_io_thread *me, unsigned int max) {
+    unsigned int i;
+    obj_io *io_stack = NULL;
+    obj_io *end = NULL;
+    if (me->queue == NULL || max == 0)
+        return NULL;
+    io_stack = me->queue;
+    end = io_stack;
+    for (i = 1; i < max; i++) {
+        if (end->next) {
+            end = end->next;
+        } else {
+            me->queue_tail = end->next;
+            break;
+        }
+    }
+    me->depth -= i;
+    me->queue = end->next;
+    end->next = NULL;
+    return io_stack;
+}
+
 /* engine IO thread; takes engine context
  * manage writes/reads
  * runs IO callbacks inline after each IO
@@ -746,27 +1033,10 @@ static void *extstore_io_thread(void *arg) {
             pthread_cond_wait(&me->cond, &me->mutex);
         }
 
-        // Pull and disconnect a batch from the queue
         // Chew small batches from the queue so the IO thread picker can keep
         // the IO queue depth even, instead of piling on threads one at a time
         // as they gobble a queue.
-        if (me->queue != NULL) {
-            int i;
-            obj_io *end = NULL;
-            io_stack = me->queue;
-            end = io_stack;
-            for (i = 1; i < e->io_depth; i++) {
-                if (end->next) {
-                    end = end->next;
-                } else {
-                    me->queue_tail = end->next;
-                    break;
-                }
-            }
-            me->depth -= i;
-            me->queue = end->next;
-            end->next = NULL;
-        }
+        io_stack = _io_queue_pull(me, e->io_depth);
         pthread_mutex_unlock(&me->mutex);
 
         obj_io *cur_io = io_stack;
@@ -780,24 +1050,7 @@ static void *extstore_io_thread(void *arg) {
             // TODO: loop if not enough bytes were read/written.
             switch (cur_io->mode) {
                 case OBJ_IO_READ:
-                    // Page is currently open. deal if read is past the end.
-                    pthread_mutex_lock(&p->mutex);
-                    if (!p->free && !p->closed && p->version == cur_io->page_version) {
-                        if (p->active && cur_io->offset >= p->written) {
-                            ret = _read_from_wbuf(p, cur_io);
-                            do_op = 0;
-                        } else {
-                            p->refcount++;
-                        }
-                        STAT_L(e);
-                        e->stats.bytes_read += cur_io->len;
-                        e->stats.objects_read++;
-                        STAT_UL(e);
-                    } else {
-                        do_op = 0;
-                        ret = -2; // TODO: enum in IO for status?
-                    }
-                    pthread_mutex_unlock(&p->mutex);
+                    do_op = _io_read_prep(e, p, cur_io, &ret);
                     if (do_op) {
 #if !defined(HAVE_PREAD) || !defined(HAVE_PREADV)
                         // TODO: lseek offset is natively 64-bit on OS X, but
@@ -826,27 +1079,111 @@ static void *extstore_io_thread(void *arg) {
                     ret = pwrite(p->fd, cur_io->buf, cur_io->len, p->offset + cur_io->offset);
                     break;
             }
-            if (ret == 0) {
-                E_DEBUG("read returned nothing\n");
-            }
+            _io_finish(e, p, cur_io, ret, do_op);
+            cur_io = next;
+        }
+    }
 
-#ifdef EXTSTORE_DEBUG
-            if (ret == -1) {
-                perror("read/write op failed");
+    return NULL;
+}
+
+#ifdef EXTSTORE_URING
+/* Queues an SQE for the IO, or completes it immediately if it can be served
+ * from a wbuf or is invalid. Returns 1 if an SQE was queued.
+ */
+static int _io_uring_prep(store_engine *e, store_io_thread *me, obj_io *io) {
+    store_page *p = &e->pages[io->page_id];
+    struct io_uring_sqe *sqe;
+    int ret = 0;
+
+    if (io->mode == OBJ_IO_READ && !_io_read_prep(e, p, io, &ret)) {
+        _io_finish(e, p, io, ret, 0);
+        return 0;
+    }
+
+    // the caller never pulls more than the ring can hold.
+    sqe = io_uring_get_sqe(&me->ring);
+    assert(sqe != NULL);
+    switch (io->mode) {
+        case OBJ_IO_READ:
+            if (io->iov == NULL) {
+                io_uring_prep_read(sqe, p->fd, io->buf, io->len, p->offset + io->offset);
+            } else {
+                io_uring_prep_readv(sqe, p->fd, io->iov, io->iovcnt, p->offset + io->offset);
             }
-#endif
-            cur_io->cb(e, cur_io, ret);
-            if (do_op) {
-                pthread_mutex_lock(&p->mutex);
-                p->refcount--;
-                pthread_mutex_unlock(&p->mutex);
+            break;
+        case OBJ_IO_WRITE: {
+            // only wbuf flushes are submitted as writes, and those are always
+            // a full aligned buffer at an aligned page offset.
+            _store_wbuf *w = (_store_wbuf *) io->data;
+            int fd = p->direct_fd != -1 ? p->direct_fd : p->fd;
+            if (me->fixed_bufs && w->buf_index >= 0) {
+                io_uring_prep_write_fixed(sqe, fd, io->buf, io->len,
+                        p->offset + io->offset, w->buf_index);
+            } else {
+                io_uring_prep_write(sqe, fd, io->buf, io->len, p->offset + io->offset);
             }
+            break;
+        }
+    }
+    io_uring_sqe_set_data(sqe, io);
+    return 1;
+}
+
+/* io_uring variant of the IO thread.
+ * Everything pulled from the queue is submitted with a single syscall, and
+ * completions are reaped in batches, so callbacks for many reads run without
+ * a wakeup per IO. New work queued while IO's are in flight is picked up once
+ * at least one of them completes.
+ */
+static void *extstore_io_thread_uring(void *arg) {
+    store_io_thread *me = (store_io_thread *)arg;
+    store_engine *e = me->e;
+    unsigned int inflight = 0;
+    while (1) {
+        obj_io *io_stack = NULL;
+        pthread_mutex_lock(&me->mutex);
+        if (me->queue == NULL && inflight == 0) {
+            pthread_cond_wait(&me->cond, &me->mutex);
+        }
+        io_stack = _io_queue_pull(me, me->ring_entries - inflight);
+        pthread_mutex_unlock(&me->mutex);
+
+        unsigned int queued = 0;
+        obj_io *cur_io = io_stack;
+        while (cur_io) {
+            obj_io *next = cur_io->next;
+            queued += _io_uring_prep(e, me, cur_io);
             cur_io = next;
         }
+        inflight += queued;
+
+        if (inflight == 0)
+            continue;
+
+        // submit anything new and block for at least one completion.
+        int sret = io_uring_submit_and_wait(&me->ring, 1);
+        if (sret < 0 && sret != -EINTR) {
+            E_DEBUG("io_uring_submit_and_wait failed: %d\n", sret);
+        }
+
+        struct io_uring_cqe *cqe;
+        unsigned int head;
+        unsigned int count = 0;
+        io_uring_for_each_cqe(&me->ring, head, cqe) {
+            obj_io *io = io_uring_cqe_get_data(cqe);
+            store_page *p = &e->pages[io->page_id];
+            int ret = cqe->res < 0 ? -1 : cqe->res;
+            _io_finish(e, p, io, ret, io->mode == OBJ_IO_READ);
+            count++;
+        }
+        io_uring_cq_advance(&me->ring, count);
+        inflight -= count;
     }
 
     return NULL;
 }
+#endif
 
 // call with *p locked.
 static void _free_page(store_engine *e, store_page *p) {
@@ -28,10 +28,13 @@ struct extstore_stats {
     uint64_t objects_evicted;
     uint64_t objects_read;
     uint64_t objects_written;
+    uint64_t write_batches; /* page lock acquisitions by batched writes */
     uint64_t objects_used; /* total number of objects stored */
     uint64_t bytes_evicted;
     uint64_t bytes_written;
     uint64_t bytes_read; /* wbuf - read -> bytes read from storage */
+    uint64_t reads_skipped; /* reads of dead objects dropped before any IO */
+    uint64_t bytes_skipped; /* bytes those reads would have fetched */
     uint64_t bytes_used; /* total number of bytes stored */
     uint64_t bytes_fragmented; /* see above comment */
     uint64_t io_queue;
@@ -50,12 +53,14 @@ struct extstore_conf {
     unsigned int wbuf_count; // this might get locked to "2 per active page"
     unsigned int io_threadcount;
     unsigned int io_depth; // with normal I/O, hits locks less. req'd for AIO
+    bool io_uring; // submit IO through io_uring instead of blocking syscalls
 };
 
 struct extstore_conf_file {
     unsigned int page_count;
     char *file;
     int fd; // internal usage
+    int direct_fd; // internal usage
     uint64_t offset; // internal usage
     unsigned int bucket; // free page bucket
     unsigned int free_bucket; // specialized free bucket
@@ -97,19 +102,24 @@ enum extstore_res {
     EXTSTORE_INIT_TOO_MANY_PAGES,
     EXTSTORE_INIT_OOM,
     EXTSTORE_INIT_OPEN_FAIL,
-    EXTSTORE_INIT_THREAD_FAIL
+    EXTSTORE_INIT_THREAD_FAIL,
+    EXTSTORE_INIT_NO_URING
 };
 
 const char *extstore_err(enum extstore_res res);
 void *extstore_init(struct extstore_conf_file *fh, struct extstore_conf *cf, enum extstore_res *res);
 int extstore_write_request(void *ptr, unsigned int bucket, unsigned int free_bucket, obj_io *io);
 void extstore_write(void *ptr, obj_io *io);
+int extstore_write_request_batch(void *ptr, unsigned int bucket, unsigned int free_bucket, obj_io *io);
+void extstore_write_batch(void *ptr, obj_io *io, int count);
 int extstore_submit(void *ptr, obj_io *io);
 /* count are the number of objects being removed, bytes are the original
  * length of those objects. Bytes is optional but you can't track
  * fragmentation without it.
  */
 int extstore_check(void *ptr, unsigned int page_id, uint64_t page_version);
+/* returns 0 if a read may find its object, -1 if it definitely can't. */
+int extstore_check_read(void *ptr, obj_io *io);
 int extstore_delete(void *ptr, unsigned int page_id, uint64_t page_version, unsigned int count, unsigned int bytes);
 void extstore_get_stats(void *ptr, struct extstore_stats *st);
 /* add page data array to a stats structure.
@@ -6,12 +6,68 @@
 #define XXH_INLINE_ALL // modifier for xxh3's include below
 #include "xxhash.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AES_HASH
+#include <wmmintrin.h>
+#endif
+
 hash_func hash;
 
 static uint32_t XXH3_hash(const void *key, size_t length) {
     return (uint32_t)XXH3_64bits(key, length);
 }
 
+#ifdef HAVE_AES_HASH
+/*
+ * Key hash built from AES-NI rounds. Each 16 bytes of key are folded into
+ * one of two lanes with one round; the lanes are then merged and two more
+ * rounds diffuse the last block into every output bit. Not a cryptographic
+ * hash; the round keys are fixed like the murmur3 seed is.
+ *
+ * XXH3 only takes its vectorized path for inputs over 240 bytes, which keys
+ * almost never are, so this is the variant that wins on short keys.
+ */
+__attribute__((target("aes,sse2")))
+static uint32_t aes_hash(const void *key, size_t length) {
+    const uint8_t *p = key;
+    const __m128i k0 = _mm_set_epi64x(0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL);
+    const __m128i k1 = _mm_set_epi64x(0xa4093822299f31d0ULL, 0x082efa98ec4e6c89ULL);
+    __m128i a = _mm_xor_si128(k0, _mm_cvtsi32_si128((int)length));
+    __m128i b = k1;
+
+    if (length < 16) {
+        uint8_t tail[16] = {0};
+        memcpy(tail, p, length);
+        a = _mm_aesenc_si128(_mm_xor_si128(a,
+                    _mm_loadu_si128((const __m128i *)tail)), k1);
+    } else {
+        // two independent lanes so short keys aren't one long chain of
+        // rounds. The last block is loaded to end exactly at the end of the
+        // key, overlapping the one before it instead of padding.
+        const uint8_t *last = p + length - 16;
+        while (p + 16 < last) {
+            a = _mm_aesenc_si128(_mm_xor_si128(a, _mm_loadu_si128((const __m128i *)p)), k1);
+            b = _mm_aesenc_si128(_mm_xor_si128(b, _mm_loadu_si128((const __m128i *)(p + 16))), k0);
+            p += 32;
+        }
+        if (p < last) {
+            a = _mm_aesenc_si128(_mm_xor_si128(a, _mm_loadu_si128((const __m128i *)p)), k1);
+        }
+        b = _mm_aesenc_si128(_mm_xor_si128(b, _mm_loadu_si128((const __m128i *)last)), k0);
+    }
+
+    a = _mm_aesenc_si128(a, b);
+    a = _mm_aesenc_si128(a, k0);
+    a = _mm_aesenc_si128(a, k1);
+    return (uint32_t)_mm_cvtsi128_si32(a);
+}
+
+static bool aes_hash_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes");
+}
+#endif
+
 int hash_init(enum hashfunc_type type) {
     switch(type) {
         case JENKINS_HASH:
@@ -26,6 +82,18 @@ int hash_init(enum hashfunc_type type) {
             hash = XXH3_hash;
             settings.hash_algorithm = "xxh3";
             break;
+        case AES_HASH:
+            // picked at runtime: fall back to xxh3 on CPUs without AES-NI.
+#ifdef HAVE_AES_HASH
+            if (aes_hash_supported()) {
+                hash = aes_hash;
+                settings.hash_algorithm = "aes";
+                break;
+            }
+#endif
+            hash = XXH3_hash;
+            settings.hash_algorithm = "xxh3";
+            break;
         default:
             return -1;
     }
@@ -0,0 +1,114 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * Microbenchmark for the key hash functions in hash.c.
+ *
+ * Hashes synthetic keys of typical lengths with each -o hash_algorithm=
+ * choice and reports ns/key. The default key set stays in cache so the
+ * numbers are the hash and not memory. The low bits of each hash are also
+ * dropped into a table averaging 16 keys per bucket, since that is all the
+ * hash index uses; "spread" is the fullest bucket divided by the average,
+ * so lower is better.
+ *
+ * usage: hash_bench [keys] [rounds]
+ */
+#include "memcached.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* hash.c only needs the settings struct from the rest of the server. */
+struct settings settings;
+
+#define KEY_MAX 64
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* keys look like the ones we store: a prefix, an id and some padding. */
+static void make_keys(char *keys, uint32_t count, int nkey) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    for (uint32_t x = 0; x < count; x++) {
+        char *key = &keys[x * KEY_MAX];
+        int len = snprintf(key, KEY_MAX, "user:%u:", x);
+        while (len < nkey)
+            key[len++] = chars[random() % (sizeof(chars) - 1)];
+        key[nkey] = '\0';
+    }
+}
+
+static void bench(enum hashfunc_type type, char *keys, uint32_t count,
+        int nkey, int rounds, uint32_t *buckets, uint32_t nbuckets) {
+    uint32_t sum = 0;
+    uint32_t max = 0;
+    uint64_t start;
+    double ns;
+
+    if (hash_init(type) != 0) {
+        fprintf(stderr, "failed to init hash %d\n", type);
+        exit(EXIT_FAILURE);
+    }
+
+    start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t x = 0; x < count; x++)
+            sum += hash(&keys[x * KEY_MAX], nkey);
+    }
+    ns = (double)(now_ns() - start) / ((uint64_t)count * rounds);
+
+    memset(buckets, 0, sizeof(uint32_t) * nbuckets);
+    for (uint32_t x = 0; x < count; x++) {
+        uint32_t b = hash(&keys[x * KEY_MAX], nkey) & (nbuckets - 1);
+        if (++buckets[b] > max)
+            max = buckets[b];
+    }
+
+    printf("%-8s key bytes: %2d ns/key: %5.1f spread: %.2f (%08x)\n",
+            settings.hash_algorithm, nkey, ns,
+            max / ((double)count / nbuckets), sum);
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = 20000;
+    uint32_t nbuckets = 1;
+    int rounds = 200;
+    static const enum hashfunc_type types[] = {
+        JENKINS_HASH, MURMUR3_HASH, XXH3_HASH, AES_HASH
+    };
+
+    if (argc > 1)
+        count = strtoul(argv[1], NULL, 10);
+    if (argc > 2)
+        rounds = atoi(argv[2]);
+
+    while (nbuckets * 32 <= count)
+        nbuckets <<= 1;
+
+    char *keys = calloc(count, KEY_MAX);
+    uint32_t *buckets = calloc(nbuckets, sizeof(uint32_t));
+    if (!keys || !buckets) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    srandom(1);
+    for (int nkey = 20; nkey <= 60; nkey += 10) {
+        make_keys(keys, count, nkey);
+        for (int x = 0; x < sizeof(types) / sizeof(types[0]); x++) {
+            // aes falls back to xxh3 without AES-NI; don't repeat it.
+            if (types[x] == AES_HASH) {
+                hash_init(AES_HASH);
+                if (strcmp(settings.hash_algorithm, "aes") != 0)
+                    continue;
+            }
+            bench(types[x], keys, count, nkey, rounds, buckets, nbuckets);
+        }
+    }
+
+    free(keys);
+    free(buckets);
+    return 0;
+}
@@ -106,6 +106,7 @@ static pthread_mutex_t bump_buf_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static bool lru_bump_async(lru_bump_buf *b, item *it, uint32_t hv);
 static uint64_t lru_total_bumps_dropped(void);
+static uint64_t lru_total_bumps_queued(void);
 
 /* Get the next CAS id for a new item. */
 /* TODO: refactor some atomics for this. */
@@ -589,6 +590,34 @@ void do_item_update(item *it) {
     }
 }
 
+/* do_item_update() for hits from worker threads. A relink is queued for the
+ * LRU maintainer thread instead of taking the LRU lock here. If the queue is
+ * full the item stays ACTIVE in COLD and gets rescued when it reaches the
+ * tail. In flat mode the time is bumped up front so an item is queued at most
+ * once per ITEM_UPDATE_INTERVAL; a dropped bump just leaves it in place.
+ * Requires lock held for item. */
+void do_item_update_async(conn *c, item *it, const uint32_t hv) {
+    if (!settings.lru_maintainer_thread) {
+        do_item_update(it);
+        return;
+    }
+
+    if (!settings.lru_segmented) {
+        if (it->time < current_time - ITEM_UPDATE_INTERVAL
+                && (it->it_flags & ITEM_LINKED) != 0) {
+            it->time = current_time;
+            lru_bump_async(c->thread->lru_bump_buf, it, hv);
+        }
+        return;
+    }
+
+    it->time = current_time;
+    if ((it->it_flags & ITEM_LINKED) != 0 && ITEM_lruid(it) == COLD_LRU
+            && (it->it_flags & ITEM_ACTIVE)) {
+        lru_bump_async(c->thread->lru_bump_buf, it, hv);
+    }
+}
+
 int do_item_replace(item *it, item *new_it, const uint32_t hv) {
     MEMCACHED_ITEM_REPLACE(ITEM_key(it), it->nkey, it->nbytes,
                            ITEM_key(new_it), new_it->nkey, new_it->nbytes);
@@ -745,6 +774,8 @@ void item_stats_totals(ADD_STAT add_stats, void *c) {
                     (unsigned long long)totals.direct_reclaims);
         APPEND_STAT("lru_bumps_dropped", "%llu",
                     (unsigned long long)lru_total_bumps_dropped());
+        APPEND_STAT("lru_bumps_queued", "%llu",
+                    (unsigned long long)lru_total_bumps_queued());
     }
 }
 
@@ -1083,7 +1114,7 @@ void do_item_bump(conn *c, item *it, const uint32_t hv) {
         }
     } else {
         it->it_flags |= ITEM_FETCHED;
-        do_item_update(it);
+        do_item_update_async(c, it, hv);
     }
 }
 
@@ -1332,6 +1363,18 @@ static bool lru_bump_async(lru_bump_buf *b, item *it, uint32_t hv) {
     return ret;
 }
 
+/* Applies a queued bump. Flat mode hits already bumped the time when they
+ * were queued, so do_item_update() would skip the relink.
+ * Requires lock held for item. */
+static void do_item_bump_relink(item *it) {
+    if (settings.lru_segmented) {
+        do_item_update(it);
+    } else if ((it->it_flags & ITEM_LINKED) != 0) {
+        item_unlink_q(it);
+        item_link_q(it);
+    }
+}
+
 /* TODO: Might be worth a micro-optimization of having bump buffers link
  * themselves back into the central queue when queue goes from zero to
  * non-zero, then remove from list if zero more than N times.
@@ -1358,7 +1401,7 @@ static bool lru_maintainer_bumps(void) {
 
         while (todo) {
             item_lock(be->hv);
-            do_item_update(be->it);
+            do_item_bump_relink(be->it);
             do_item_remove(be->it);
             item_unlock(be->hv);
             be++;
@@ -1373,6 +1416,19 @@ static bool lru_maintainer_bumps(void) {
     return bumped;
 }
 
+static uint64_t lru_total_bumps_queued(void) {
+    uint64_t total = 0;
+    lru_bump_buf *b;
+    pthread_mutex_lock(&bump_buf_lock);
+    for (b = bump_buf_head; b != NULL; b=b->next) {
+        pthread_mutex_lock(&b->mutex);
+        total += bipbuf_used(b->buf) / sizeof(lru_bump_entry);
+        pthread_mutex_unlock(&b->mutex);
+    }
+    pthread_mutex_unlock(&bump_buf_lock);
+    return total;
+}
+
 static uint64_t lru_total_bumps_dropped(void) {
     uint64_t total = 0;
     lru_bump_buf *b;
@@ -1661,7 +1717,7 @@ static void *lru_maintainer_thread(void *arg) {
         }
 
         /* Minimize the sleep if we had async LRU bumps to process */
-        if (settings.lru_segmented && lru_maintainer_bumps() && to_sleep > 1000) {
+        if (lru_maintainer_bumps() && to_sleep > 1000) {
             to_sleep = 1000;
         }
 
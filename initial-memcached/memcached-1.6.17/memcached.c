@@ -273,7 +273,9 @@ static void settings_init(void) {
     settings.temporary_ttl = 61;
     settings.idle_timeout = 0; /* disabled */
     settings.hashpower_init = 0;
+    settings.hash_bucketed = false;
     settings.slab_reassign = true;
+    settings.slab_thread_cache = false;
     settings.slab_automove = 1;
     settings.slab_automove_ratio = 0.8;
     settings.slab_automove_window = 30;
@@ -291,6 +293,9 @@ static void settings_init(void) {
     settings.relaxed_privileges = false;
 #endif
     settings.num_napi_ids = 0;
+    settings.dispatch_load = false;
+    settings.dispatch_rebalance = false;
+    settings.reuseport_listen = false;
     settings.memory_file = NULL;
 #ifdef SOCK_COOKIE_ID
     settings.sock_cookie_id = 0;
@@ -547,6 +552,9 @@ void conn_worker_readd(conn *c) {
             return;
         }
     }
+    // handed over by conn_worker_rebalance().
+    if (!c->thread_linked)
+        conn_thread_link(c);
     c->ev_flags = EV_READ | EV_PERSIST;
     event_set(&c->event, c->sfd, c->ev_flags, event_handler, (void *)c);
     event_base_set(c->thread->base, &c->event);
@@ -595,6 +603,82 @@ void conn_io_queue_setup(conn *c) {
     }
 }
 
+/* Client conns are kept on a list per worker so rebalancing only walks the
+ * worker's own conns. Only called from the owning worker. */
+void conn_thread_link(conn *c) {
+    LIBEVENT_THREAD *t = c->thread;
+    assert(!c->thread_linked);
+    c->thread_prev = NULL;
+    c->thread_next = t->conn_list;
+    if (t->conn_list)
+        t->conn_list->thread_prev = c;
+    t->conn_list = c;
+    c->thread_linked = true;
+}
+
+static void conn_thread_unlink(conn *c) {
+    LIBEVENT_THREAD *t = c->thread;
+    assert(c->thread_linked);
+    if (c->thread_prev)
+        c->thread_prev->thread_next = c->thread_next;
+    else
+        t->conn_list = c->thread_next;
+    if (c->thread_next)
+        c->thread_next->thread_prev = c->thread_prev;
+    c->thread_prev = c->thread_next = NULL;
+    c->thread_linked = false;
+}
+
+/* Moves some idle connections from one worker to another. Called on the
+ * 'from' worker. Only conns parked between commands can move: they hold no
+ * read buffer, responses or IO, so nothing they own is tied to the thread.
+ * The new owner picks them up through conn_worker_readd(). */
+#define REBALANCE_MAX_CONNS 8
+void conn_worker_rebalance(LIBEVENT_THREAD *from, LIBEVENT_THREAD *to) {
+    uint64_t from_conns = __atomic_load_n(&from->conns, __ATOMIC_RELAXED);
+    uint64_t to_conns = __atomic_load_n(&to->conns, __ATOMIC_RELAXED);
+    int todo, moved = 0;
+
+    if (from == to || from_conns <= to_conns + 1)
+        return;
+    todo = (from_conns - to_conns) / 2;
+    if (todo > REBALANCE_MAX_CONNS)
+        todo = REBALANCE_MAX_CONNS;
+
+    conn *next = NULL;
+    for (conn *c = from->conn_list; c != NULL && moved < todo; c = next) {
+        next = c->thread_next;
+        // skip conns that sent a command this second; they're the load.
+        if ((c->state != conn_read && c->state != conn_new_cmd)
+                || c->last_cmd_time == current_time
+                || IS_UDP(c->transport) || c->rbuf != NULL
+                || c->resp_head != NULL || c->io_queues_submitted != 0)
+            continue;
+#ifdef TLS
+        if (c->ssl != NULL)
+            continue;
+#endif
+#ifdef PROXY
+        if (c->protocol == proxy_prot)
+            continue;
+#endif
+        event_del(&c->event);
+        conn_thread_unlink(c);
+        __atomic_fetch_sub(&from->conns, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&to->conns, 1, __ATOMIC_RELAXED);
+        c->thread = to;
+        conn_io_queue_setup(c);
+        redispatch_conn(c);
+        moved++;
+    }
+
+    if (moved) {
+        pthread_mutex_lock(&from->stats.mutex);
+        from->stats.conns_rebalanced += moved;
+        pthread_mutex_unlock(&from->stats.mutex);
+    }
+}
+
 // To be called from conn_release_items to ensure the stack ptrs are reset.
 static void conn_io_queue_reset(conn *c) {
     for (io_queue_t *q = c->io_queues; q->type != IO_QUEUE_NONE; q++) {
@@ -949,6 +1033,11 @@ static void conn_close(conn *c) {
 #endif
     close(c->sfd);
     c->close_reason = 0;
+    // listeners are never counted in thread->conns.
+    if (c->thread_linked) {
+        conn_thread_unlink(c);
+        __atomic_fetch_sub(&c->thread->conns, 1, __ATOMIC_RELAXED);
+    }
     pthread_mutex_lock(&conn_lock);
     allow_new_conns = true;
     pthread_mutex_unlock(&conn_lock);
@@ -1595,7 +1684,7 @@ enum store_item_type do_store_item(item *it, int comm, conn *c, const uint32_t h
         switch (comm) {
             case NREAD_ADD:
                 /* add only adds a nonexistent item, but promote to head of LRU */
-                do_item_update(old_it);
+                do_item_update_async(c, old_it, hv);
                 break;
             case NREAD_CAS:
                 if (cas_res == CAS_MATCH) {
@@ -1808,6 +1897,18 @@ void server_stats(ADD_STAT add_stats, conn *c) {
         APPEND_STAT("proxy_conn_errors", "%llu", (unsigned long long)thread_stats.proxy_conn_errors);
         APPEND_STAT("proxy_conn_oom", "%llu", (unsigned long long)thread_stats.proxy_conn_oom);
         APPEND_STAT("proxy_req_active", "%llu", (unsigned long long)thread_stats.proxy_req_active);
+        APPEND_STAT("proxy_req_coalesced", "%llu", (unsigned long long)thread_stats.proxy_req_coalesced);
+        APPEND_STAT("proxy_l1_hits", "%llu", (unsigned long long)thread_stats.proxy_l1_hits);
+        APPEND_STAT("proxy_l1_misses", "%llu", (unsigned long long)thread_stats.proxy_l1_misses);
+        APPEND_STAT("proxy_l1_admits", "%llu", (unsigned long long)thread_stats.proxy_l1_admits);
+        APPEND_STAT("proxy_l1_rejects", "%llu", (unsigned long long)thread_stats.proxy_l1_rejects);
+        APPEND_STAT("proxy_mget_keys", "%llu", (unsigned long long)thread_stats.proxy_mget_keys);
+        APPEND_STAT("proxy_mget_batches", "%llu", (unsigned long long)thread_stats.proxy_mget_batches);
+        APPEND_STAT("proxy_route_requests", "%llu", (unsigned long long)thread_stats.proxy_route_requests);
+        APPEND_STAT("proxy_route_failovers", "%llu", (unsigned long long)thread_stats.proxy_route_failovers);
+        APPEND_STAT("proxy_hedge_sent", "%llu", (unsigned long long)thread_stats.proxy_hedge_sent);
+        APPEND_STAT("proxy_hedge_wins", "%llu", (unsigned long long)thread_stats.proxy_hedge_wins);
+        APPEND_STAT("proxy_hedge_denied", "%llu", (unsigned long long)thread_stats.proxy_hedge_denied);
     }
 #endif
     APPEND_STAT("cmd_get", "%llu", (unsigned long long)thread_stats.get_cmds);
@@ -1851,6 +1952,9 @@ void server_stats(ADD_STAT add_stats, conn *c) {
     if (settings.idle_timeout) {
         APPEND_STAT("idle_kicks", "%llu", (unsigned long long)thread_stats.idle_kicks);
     }
+    if (settings.dispatch_rebalance) {
+        APPEND_STAT("conns_rebalanced", "%llu", (unsigned long long)thread_stats.conns_rebalanced);
+    }
     APPEND_STAT("bytes_read", "%llu", (unsigned long long)thread_stats.bytes_read);
     APPEND_STAT("bytes_written", "%llu", (unsigned long long)thread_stats.bytes_written);
     APPEND_STAT("limit_maxbytes", "%llu", (unsigned long long)settings.maxbytes);
@@ -1938,7 +2042,9 @@ void process_stat_settings(ADD_STAT add_stats, void *c) {
     APPEND_STAT("item_size_max", "%d", settings.item_size_max);
     APPEND_STAT("maxconns_fast", "%s", settings.maxconns_fast ? "yes" : "no");
     APPEND_STAT("hashpower_init", "%d", settings.hashpower_init);
+    APPEND_STAT("hash_index", "%s", settings.hash_bucketed ? "bucketed" : "chained");
     APPEND_STAT("slab_reassign", "%s", settings.slab_reassign ? "yes" : "no");
+    APPEND_STAT("slab_thread_cache", "%s", settings.slab_thread_cache ? "yes" : "no");
     APPEND_STAT("slab_automove", "%d", settings.slab_automove);
     APPEND_STAT("slab_automove_ratio", "%.2f", settings.slab_automove_ratio);
     APPEND_STAT("slab_automove_window", "%u", settings.slab_automove_window);
@@ -1971,11 +2077,15 @@ void process_stat_settings(ADD_STAT add_stats, void *c) {
     APPEND_STAT("ext_item_size", "%u", settings.ext_item_size);
     APPEND_STAT("ext_item_age", "%u", settings.ext_item_age);
     APPEND_STAT("ext_low_ttl", "%u", settings.ext_low_ttl);
+    APPEND_STAT("ext_ttl_buckets", "%u", settings.ext_ttl_buckets);
     APPEND_STAT("ext_recache_rate", "%u", settings.ext_recache_rate);
     APPEND_STAT("ext_wbuf_size", "%u", settings.ext_wbuf_size);
     APPEND_STAT("ext_compact_under", "%u", settings.ext_compact_under);
     APPEND_STAT("ext_drop_under", "%u", settings.ext_drop_under);
     APPEND_STAT("ext_max_sleep", "%u", settings.ext_max_sleep);
+    APPEND_STAT("ext_compact_streams", "%u", settings.ext_compact_streams);
+    APPEND_STAT("ext_compact_rate", "%u", settings.ext_compact_rate);
+    APPEND_STAT("ext_compact_read_lat", "%u", settings.ext_compact_read_lat);
     APPEND_STAT("ext_max_frag", "%.2f", settings.ext_max_frag);
     APPEND_STAT("slab_automove_freeratio", "%.3f", settings.slab_automove_freeratio);
     APPEND_STAT("ext_drop_unread", "%s", settings.ext_drop_unread ? "yes" : "no");
@@ -1998,6 +2108,9 @@ void process_stat_settings(ADD_STAT add_stats, void *c) {
     APPEND_STAT("proxy_uring_enabled", "%s", settings.proxy_uring ? "yes" : "no");
 #endif
     APPEND_STAT("num_napi_ids", "%s", settings.num_napi_ids);
+    APPEND_STAT("dispatch_mode", "%s", settings.dispatch_load ? "load" : "round_robin");
+    APPEND_STAT("dispatch_rebalance", "%s", settings.dispatch_rebalance ? "yes" : "no");
+    APPEND_STAT("reuseport_listen", "%s", settings.reuseport_listen ? "yes" : "no");
     APPEND_STAT("memory_file", "%s", settings.memory_file);
 }
 
@@ -2029,6 +2142,8 @@ bool get_stats(const char *stat_type, int nkey, ADD_STAT add_stats, void *c) {
             item_stats_sizes_enable(add_stats, c);
         } else if (nz_strcmp(nkey, stat_type, "sizes_disable") == 0) {
             item_stats_sizes_disable(add_stats, c);
+        } else if (nz_strcmp(nkey, stat_type, "threads") == 0) {
+            threads_stats(add_stats, c);
         } else {
             ret = false;
         }
@@ -2333,7 +2448,7 @@ enum delta_result_type do_add_delta(conn *c, const char *key, const size_t nkey,
         item_stats_sizes_add(it);
         memcpy(ITEM_data(it), buf, res);
         memset(ITEM_data(it) + res, ' ', it->nbytes - res - 2);
-        do_item_update(it);
+        do_item_update_async(c, it, hv);
     } else if (it->refcount > 1) {
         item *new_it;
         uint32_t flags;
@@ -2537,13 +2652,16 @@ static bool update_event(conn *c, const int new_flags) {
     return true;
 }
 
-/*
- * Sets whether we are listening for new connections or not.
- */
-void do_accept_new_conns(const bool do_accept) {
+/* Updates the listeners in listen_conn owned by owner; NULL is the main
+ * thread. Each listener's event is only ever touched by its own thread. */
+static void listen_conns_update(LIBEVENT_THREAD *owner, const bool do_accept,
+        struct timeval *entered) {
     conn *next;
 
     for (next = listen_conn; next; next = next->next) {
+        if (next->thread != owner) {
+            continue;
+        }
         if (do_accept) {
             update_event(next, EV_READ | EV_PERSIST);
             if (listen(next->sfd, settings.backlog) != 0) {
@@ -2564,22 +2682,77 @@ void do_accept_new_conns(const bool do_accept) {
         gettimeofday(&maxconns_exited,NULL);
         STATS_LOCK();
         elapsed_us =
-            (maxconns_exited.tv_sec - stats.maxconns_entered.tv_sec) * 1000000
-            + (maxconns_exited.tv_usec - stats.maxconns_entered.tv_usec);
+            (maxconns_exited.tv_sec - entered->tv_sec) * 1000000
+            + (maxconns_exited.tv_usec - entered->tv_usec);
         stats.time_in_listen_disabled_us += elapsed_us;
         stats_state.accepting_conns = true;
         STATS_UNLOCK();
     } else {
         STATS_LOCK();
         stats_state.accepting_conns = false;
-        gettimeofday(&stats.maxconns_entered,NULL);
+        gettimeofday(entered,NULL);
         stats.listen_disabled_num++;
         STATS_UNLOCK();
         allow_new_conns = false;
+    }
+}
+
+/*
+ * Sets whether we are listening for new connections or not.
+ */
+void do_accept_new_conns(const bool do_accept) {
+    listen_conns_update(NULL, do_accept, &stats.maxconns_entered);
+    if (!do_accept) {
         maxconns_handler(-42, 0, 0);
     }
 }
 
+/* Workers poll for a free fd the same way maxconns_handler does for the main
+ * thread, since only the owning thread may touch its listeners' events.
+ */
+static void worker_listen_handler(const evutil_socket_t fd, const short which, void *arg) {
+    LIBEVENT_THREAD *t = arg;
+    struct timeval tv = {.tv_sec = 0, .tv_usec = 10000};
+
+    if (fd == -42 || allow_new_conns == false) {
+        evtimer_set(&t->listen_event, worker_listen_handler, t);
+        event_base_set(t->base, &t->listen_event);
+        evtimer_add(&t->listen_event, &tv);
+    } else {
+        evtimer_del(&t->listen_event);
+        t->listen_paused = false;
+        worker_accept_new_conns(t, true);
+    }
+}
+
+/*
+ * Sets whether a worker's own SO_REUSEPORT listeners accept new connections.
+ * Must be called from that worker.
+ */
+void worker_accept_new_conns(LIBEVENT_THREAD *t, const bool do_accept) {
+    // already polling to resume; asked again by accept_new_conns().
+    if (!do_accept && t->listen_paused)
+        return;
+    pthread_mutex_lock(&conn_lock);
+    listen_conns_update(t, do_accept, &t->listen_disabled);
+    pthread_mutex_unlock(&conn_lock);
+    if (!do_accept) {
+        t->listen_paused = true;
+        worker_listen_handler(-42, 0, t);
+    }
+}
+
+/*
+ * Adds a listener handed to a worker by dispatch_listen_conn() to
+ * listen_conn. Called from the owning worker.
+ */
+void listen_conn_register(conn *c) {
+    pthread_mutex_lock(&conn_lock);
+    c->next = listen_conn;
+    listen_conn = c;
+    pthread_mutex_unlock(&conn_lock);
+}
+
 #define TRANSMIT_ONE_RESP true
 #define TRANSMIT_ALL_RESP false
 static int _transmit_pre(conn *c, struct iovec *iovs, int iovused, bool one_resp) {
@@ -3030,7 +3203,11 @@ static void drive_machine(conn *c) {
                 } else if (errno == EMFILE) {
                     if (settings.verbose > 0)
                         fprintf(stderr, "Too many open connections\n");
-                    accept_new_conns(false);
+                    if (c->thread != NULL) {
+                        worker_accept_new_conns(c->thread, false);
+                    } else {
+                        accept_new_conns(false);
+                    }
                     stop = true;
                 } else {
                     perror("accept()");
@@ -3106,8 +3283,14 @@ static void drive_machine(conn *c) {
                 ssl_v = (void*) ssl;
 #endif
 
-                dispatch_conn_new(sfd, conn_new_cmd, EV_READ | EV_PERSIST,
-                                     READ_BUFFER_CACHED, c->transport, ssl_v, c->tag, c->protocol);
+                if (c->thread != NULL) {
+                    // SO_REUSEPORT listener: the conn stays on this worker.
+                    dispatch_conn_local(c->thread, sfd, conn_new_cmd, EV_READ | EV_PERSIST,
+                                        READ_BUFFER_CACHED, c->transport, ssl_v, c->tag, c->protocol);
+                } else {
+                    dispatch_conn_new(sfd, conn_new_cmd, EV_READ | EV_PERSIST,
+                                      READ_BUFFER_CACHED, c->transport, ssl_v, c->tag, c->protocol);
+                }
             }
 
             stop = true;
@@ -3433,6 +3616,17 @@ void event_handler(const evutil_socket_t fd, const short which, void *arg) {
         return;
     }
 
+    /* main thread listeners aren't counted, and the time is only needed to
+     * pick or rebalance workers by load. */
+    LIBEVENT_THREAD *t = c->thread;
+    if (t != NULL && (settings.dispatch_load || settings.dispatch_rebalance)) {
+        uint64_t start = thread_clock_ns();
+        drive_machine(c);
+        __atomic_store_n(&t->busy_ns, t->busy_ns + (thread_clock_ns() - start),
+                __ATOMIC_RELAXED);
+        return;
+    }
+
     drive_machine(c);
 
     /* wait for next event */
@@ -3495,6 +3689,103 @@ static void maximize_sndbuf(const int sfd) {
         fprintf(stderr, "<%d send buffer was %d, now %d\n", sfd, old_size, last_good);
 }
 
+/*
+ * Applies the socket options every listener gets. Returns non-zero if the
+ * socket can't be used.
+ */
+static int server_socket_opts(int sfd, struct addrinfo *ai,
+                              enum network_transport transport) {
+    struct linger ling = {0, 0};
+    int flags = 1;
+    int error;
+
+#ifdef IPV6_V6ONLY
+    if (ai->ai_family == AF_INET6) {
+        error = setsockopt(sfd, IPPROTO_IPV6, IPV6_V6ONLY, (char *) &flags, sizeof(flags));
+        if (error != 0) {
+            perror("setsockopt");
+            return 1;
+        }
+    }
+#endif
+#ifdef SOCK_COOKIE_ID
+    if (settings.sock_cookie_id != 0) {
+        error = setsockopt(sfd, SOL_SOCKET, SOCK_COOKIE_ID, (void *)&settings.sock_cookie_id, sizeof(uint32_t));
+        if (error != 0)
+            perror("setsockopt");
+    }
+#endif
+
+    setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, (void *)&flags, sizeof(flags));
+    if (IS_UDP(transport)) {
+        maximize_sndbuf(sfd);
+    } else {
+#ifdef SO_REUSEPORT
+        if (settings.reuseport_listen) {
+            error = setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, (void *)&flags, sizeof(flags));
+            if (error != 0) {
+                perror("setsockopt(SO_REUSEPORT)");
+                return 1;
+            }
+        }
+#endif
+        error = setsockopt(sfd, SOL_SOCKET, SO_KEEPALIVE, (void *)&flags, sizeof(flags));
+        if (error != 0)
+            perror("setsockopt");
+
+        error = setsockopt(sfd, SOL_SOCKET, SO_LINGER, (void *)&ling, sizeof(ling));
+        if (error != 0)
+            perror("setsockopt");
+
+        error = setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, (void *)&flags, sizeof(flags));
+        if (error != 0)
+            perror("setsockopt");
+    }
+
+    return 0;
+}
+
+#ifdef SO_REUSEPORT
+/*
+ * Gives every worker thread its own listener on the address sfd is bound to.
+ * sfd goes to the first worker; the rest are bound to its resolved address so
+ * an ephemeral port is shared as well. The kernel then spreads new
+ * connections across the group and no worker waits on the main thread.
+ */
+static void server_socket_reuseport(int sfd, struct addrinfo *ai,
+                                    bool ssl_enabled, uint64_t conntag,
+                                    enum protocol bproto) {
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof(addr);
+
+    if (getsockname(sfd, (struct sockaddr *)&addr, &addrlen) != 0) {
+        perror("getsockname()");
+        exit(EXIT_FAILURE);
+    }
+
+    dispatch_listen_conn(0, sfd, tcp_transport, ssl_enabled, conntag, bproto);
+    for (int tid = 1; tid < settings.num_threads; tid++) {
+        int tfd = new_socket(ai);
+        if (tfd == -1) {
+            perror("server_socket");
+            exit(EX_OSERR);
+        }
+        if (server_socket_opts(tfd, ai, tcp_transport) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        if (bind(tfd, (struct sockaddr *)&addr, addrlen) == -1) {
+            perror("bind()");
+            exit(EXIT_FAILURE);
+        }
+        if (listen(tfd, settings.backlog) == -1) {
+            perror("listen()");
+            exit(EXIT_FAILURE);
+        }
+        dispatch_listen_conn(tid, tfd, tcp_transport, ssl_enabled, conntag, bproto);
+    }
+}
+#endif
+
 /**
  * Create a socket and bind it to a specific port number
  * @param interface the interface to bind to
@@ -3511,7 +3802,6 @@ static int server_socket(const char *interface,
                          uint64_t conntag,
                          enum protocol bproto) {
     int sfd;
-    struct linger ling = {0, 0};
     struct addrinfo *ai;
     struct addrinfo *next;
     struct addrinfo hints = { .ai_flags = AI_PASSIVE,
@@ -3519,7 +3809,6 @@ static int server_socket(const char *interface,
     char port_buf[NI_MAXSERV];
     int error;
     int success = 0;
-    int flags =1;
 
     hints.ai_socktype = IS_UDP(transport) ? SOCK_DGRAM : SOCK_STREAM;
 
@@ -3560,39 +3849,9 @@ static int server_socket(const char *interface,
             }
         }
 
-#ifdef IPV6_V6ONLY
-        if (next->ai_family == AF_INET6) {
-            error = setsockopt(sfd, IPPROTO_IPV6, IPV6_V6ONLY, (char *) &flags, sizeof(flags));
-            if (error != 0) {
-                perror("setsockopt");
-                close(sfd);
-                continue;
-            }
-        }
-#endif
-#ifdef SOCK_COOKIE_ID
-        if (settings.sock_cookie_id != 0) {
-            error = setsockopt(sfd, SOL_SOCKET, SOCK_COOKIE_ID, (void *)&settings.sock_cookie_id, sizeof(uint32_t));
-            if (error != 0)
-                perror("setsockopt");
-        }
-#endif
-
-        setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, (void *)&flags, sizeof(flags));
-        if (IS_UDP(transport)) {
-            maximize_sndbuf(sfd);
-        } else {
-            error = setsockopt(sfd, SOL_SOCKET, SO_KEEPALIVE, (void *)&flags, sizeof(flags));
-            if (error != 0)
-                perror("setsockopt");
-
-            error = setsockopt(sfd, SOL_SOCKET, SO_LINGER, (void *)&ling, sizeof(ling));
-            if (error != 0)
-                perror("setsockopt");
-
-            error = setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, (void *)&flags, sizeof(flags));
-            if (error != 0)
-                perror("setsockopt");
+        if (server_socket_opts(sfd, next, transport) != 0) {
+            close(sfd);
+            continue;
         }
 
         if (bind(sfd, next->ai_addr, next->ai_addrlen) == -1) {
@@ -3660,6 +3919,10 @@ static int server_socket(const char *interface,
                                   EV_READ | EV_PERSIST,
                                   UDP_READ_BUFFER_SIZE, transport, NULL, conntag, bproto);
             }
+#ifdef SO_REUSEPORT
+        } else if (settings.reuseport_listen) {
+            server_socket_reuseport(sfd, next, ssl_enabled, conntag, bproto);
+#endif
         } else {
             if (!(listen_conn_add = conn_new(sfd, conn_listening,
                                              EV_READ | EV_PERSIST, 1,
@@ -3672,8 +3935,10 @@ static int server_socket(const char *interface,
 #else
             assert(ssl_enabled == false);
 #endif
+            pthread_mutex_lock(&conn_lock);
             listen_conn_add->next = listen_conn;
             listen_conn = listen_conn_add;
+            pthread_mutex_unlock(&conn_lock);
         }
     }
 
@@ -3979,6 +4244,8 @@ static void clock_handler(const evutil_socket_t fd, const short which, void *arg
     event_base_set(main_base, &clockevent);
     evtimer_add(&clockevent, &t);
 
+    threads_load_update();
+
 #ifdef MEMCACHED_DEBUG
     if (is_paused) return;
 #endif
@@ -4092,11 +4359,15 @@ static void usage(void) {
            "   - hashpower:           an integer multiplier for how large the hash\n"
            "                          table should be. normally grows at runtime. (default starts at: %d)\n"
            "                          set based on \"STAT hash_power_level\"\n"
+           "   - hash_index:          hash table layout. options: chained, bucketed\n"
+           "                          bucketed uses cache line sized buckets with\n"
+           "                          key tags. (default: chained)\n"
            "   - tail_repair_time:    time in seconds for how long to wait before\n"
            "                          forcefully killing LRU tail item.\n"
            "                          disabled by default; very dangerous option.\n"
            "   - hash_algorithm:      the hash table algorithm\n"
-           "                          default is murmur3 hash. options: jenkins, murmur3, xxh3\n"
+           "                          default is murmur3 hash. options: jenkins, murmur3, xxh3, aes\n"
+           "                          aes uses AES-NI and falls back to xxh3 without it.\n"
            "   - no_lru_crawler:      disable LRU Crawler background thread.\n"
            "   - lru_crawler_sleep:   microseconds to sleep between items\n"
            "                          default is %d.\n"
@@ -4104,6 +4375,7 @@ static void usage(void) {
            "                          default is %u (unlimited)\n",
            flag_enabled_disabled(settings.maxconns_fast), settings.hashpower_init,
            settings.lru_crawler_sleep, settings.lru_crawler_tocrawl);
+    verify_default("hash_index", !settings.hash_bucketed);
     printf("   - read_buf_mem_limit:  limit in megabytes for connection read/response buffers.\n"
            "                          do not adjust unless you have high (20k+) conn. limits.\n"
            "                          0 means unlimited (default: %u)\n",
@@ -4118,7 +4390,12 @@ static void usage(void) {
            "   - warm_max_factor:     items idle > cold lru age * this drop from warm. (default: %.2f)\n"
            "   - temporary_ttl:       TTL's below get separate LRU, can't be evicted.\n"
            "                          (requires lru_maintainer, default: %d)\n"
-           "   - idle_timeout:        timeout for idle connections. (default: %d, no timeout)\n",
+           "   - idle_timeout:        timeout for idle connections. (default: %d, no timeout)\n"
+           "   - dispatch_mode:       how new connections pick a worker thread.\n"
+           "                          options: round_robin, load (default: round_robin)\n"
+           "   - dispatch_rebalance:  move idle connections off overloaded workers.\n"
+           "   - reuseport_listen:    each worker thread accepts TCP connections on its\n"
+           "                          own SO_REUSEPORT socket. (default: disabled)\n",
            settings.hot_lru_pct, settings.warm_lru_pct, settings.hot_max_factor, settings.warm_max_factor,
            settings.temporary_ttl, settings.idle_timeout);
     printf("   - slab_chunk_max:      (EXPERIMENTAL) maximum slab size in kilobytes. use extreme care. (default: %d)\n"
@@ -4127,6 +4404,8 @@ static void usage(void) {
            "                          read by background thread, then written to watchers. (default: %u)\n"
            "   - track_sizes:         enable dynamic reports for 'stats sizes' command.\n"
            "   - no_hashexpand:       disables hash table expansion (dangerous)\n"
+           "   - slab_thread_cache:   keep small per-worker caches of free chunks to\n"
+           "                          cut slab lock contention. (default: disabled)\n"
            "   - modern:              enables options which will be default in future.\n"
            "                          currently: nothing\n"
            "   - no_modern:           uses defaults of previous major version (1.4.x)\n",
@@ -4135,6 +4414,9 @@ static void usage(void) {
     verify_default("tail_repair_time", settings.tail_repair_time == TAIL_REPAIR_TIME_DEFAULT);
     verify_default("lru_crawler_tocrawl", settings.lru_crawler_tocrawl == 0);
     verify_default("idle_timeout", settings.idle_timeout == 0);
+    verify_default("dispatch_mode", !settings.dispatch_load);
+    verify_default("reuseport_listen", !settings.reuseport_listen);
+    verify_default("slab_thread_cache", !settings.slab_thread_cache);
 #ifdef HAVE_DROP_PRIVILEGES
     printf("   - drop_privileges:     enable dropping extra syscall privileges\n"
            "   - no_drop_privileges:  disable drop_privileges in case it causes issues with\n"
@@ -4156,9 +4438,14 @@ static void usage(void) {
            "   - ext_page_size:       size in megabytes of storage pages. (default: %u)\n"
            "   - ext_wbuf_size:       size in megabytes of page write buffers. (default: %u)\n"
            "   - ext_threads:         number of IO threads to run. (default: %u)\n"
+#ifdef EXTSTORE_URING
+           "   - ext_io_uring:        submit extstore IO through io_uring.\n"
+#endif
            "   - ext_item_size:       store items larger than this (bytes, default %u)\n"
            "   - ext_item_age:        store items idle at least this long (seconds, default: no age limit)\n"
            "   - ext_low_ttl:         consider TTLs lower than this specially (default: %u)\n"
+           "   - ext_ttl_buckets:     split items with a TTL into this many sets of pages\n"
+           "                          by remaining TTL, up to 8 (default: %u, disabled)\n"
            "   - ext_drop_unread:     don't re-write unread values during compaction (default: %s)\n"
            "   - ext_recache_rate:    recache an item every N accesses (default: %u)\n"
            "   - ext_compact_under:   compact when fewer than this many free pages\n"
@@ -4167,17 +4454,22 @@ static void usage(void) {
            "                          (default: 1/4th of the assigned storage)\n"
            "   - ext_max_frag:        max page fragmentation to tolerate (default: %.2f)\n"
            "   - ext_max_sleep:       max sleep time of background threads in us (default: %u)\n"
+           "   - ext_compact_streams: pages to compact at the same time (default: %u)\n"
+           "   - ext_compact_rate:    limit compaction reads to this many MB/s (default: no limit)\n"
+           "   - ext_compact_read_lat: slow the compaction rate limit down while reads take\n"
+           "                          longer than this many us on average (default: off)\n"
            "   - slab_automove_freeratio: ratio of memory to hold free as buffer.\n"
            "                          (see doc/storage.txt for more info, default: %.3f)\n",
            settings.ext_page_size / (1 << 20), settings.ext_wbuf_size / (1 << 20), settings.ext_io_threadcount,
-           settings.ext_item_size, settings.ext_low_ttl,
+           settings.ext_item_size, settings.ext_low_ttl, settings.ext_ttl_buckets,
            flag_enabled_disabled(settings.ext_drop_unread), settings.ext_recache_rate,
-           settings.ext_max_frag, settings.ext_max_sleep, settings.slab_automove_freeratio);
+           settings.ext_max_frag, settings.ext_max_sleep, settings.ext_compact_streams,
+           settings.slab_automove_freeratio);
     verify_default("ext_item_age", settings.ext_item_age == UINT_MAX);
 #endif
 #ifdef PROXY
     printf("   - proxy_config:        path to lua config file.\n");
-#ifdef HAVE_LIBURING
+#ifdef EXTSTORE_URING
     printf("   - proxy_uring:         enable IO_URING for proxy backends.\n");
 #endif
 #endif
@@ -4822,8 +5114,10 @@ int main (int argc, char **argv) {
     enum {
         MAXCONNS_FAST = 0,
         HASHPOWER_INIT,
+        HASH_INDEX,
         NO_HASHEXPAND,
         SLAB_REASSIGN,
+        SLAB_THREAD_CACHE,
         SLAB_AUTOMOVE,
         SLAB_AUTOMOVE_RATIO,
         SLAB_AUTOMOVE_WINDOW,
@@ -4839,6 +5133,9 @@ int main (int argc, char **argv) {
         WARM_MAX_FACTOR,
         TEMPORARY_TTL,
         IDLE_TIMEOUT,
+        DISPATCH_MODE,
+        DISPATCH_REBALANCE,
+        REUSEPORT_LISTEN,
         WATCHER_LOGBUF_SIZE,
         WORKER_LOGBUF_SIZE,
         SLAB_SIZES,
@@ -4885,8 +5182,10 @@ int main (int argc, char **argv) {
     char *const subopts_tokens[] = {
         [MAXCONNS_FAST] = "maxconns_fast",
         [HASHPOWER_INIT] = "hashpower",
+        [HASH_INDEX] = "hash_index",
         [NO_HASHEXPAND] = "no_hashexpand",
         [SLAB_REASSIGN] = "slab_reassign",
+        [SLAB_THREAD_CACHE] = "slab_thread_cache",
         [SLAB_AUTOMOVE] = "slab_automove",
         [SLAB_AUTOMOVE_RATIO] = "slab_automove_ratio",
         [SLAB_AUTOMOVE_WINDOW] = "slab_automove_window",
@@ -4902,6 +5201,9 @@ int main (int argc, char **argv) {
         [WARM_MAX_FACTOR] = "warm_max_factor",
         [TEMPORARY_TTL] = "temporary_ttl",
         [IDLE_TIMEOUT] = "idle_timeout",
+        [DISPATCH_MODE] = "dispatch_mode",
+        [DISPATCH_REBALANCE] = "dispatch_rebalance",
+        [REUSEPORT_LISTEN] = "reuseport_listen",
         [WATCHER_LOGBUF_SIZE] = "watcher_logbuf_size",
         [WORKER_LOGBUF_SIZE] = "worker_logbuf_size",
         [SLAB_SIZES] = "slab_sizes",
@@ -5313,12 +5615,29 @@ int main (int argc, char **argv) {
                     return 1;
                 }
                 break;
+            case HASH_INDEX:
+                if (subopts_value == NULL) {
+                    fprintf(stderr, "Missing hash_index argument\n");
+                    return 1;
+                }
+                if (strcmp(subopts_value, "chained") == 0) {
+                    settings.hash_bucketed = false;
+                } else if (strcmp(subopts_value, "bucketed") == 0) {
+                    settings.hash_bucketed = true;
+                } else {
+                    fprintf(stderr, "Unknown hash_index option (chained, bucketed)\n");
+                    return 1;
+                }
+                break;
             case NO_HASHEXPAND:
                 start_assoc_maint = false;
                 break;
             case SLAB_REASSIGN:
                 settings.slab_reassign = true;
                 break;
+            case SLAB_THREAD_CACHE:
+                settings.slab_thread_cache = true;
+                break;
             case SLAB_AUTOMOVE:
                 if (subopts_value == NULL) {
                     settings.slab_automove = 1;
@@ -5374,8 +5693,10 @@ int main (int argc, char **argv) {
                     hash_type = MURMUR3_HASH;
                 } else if (strcmp(subopts_value, "xxh3") == 0) {
                     hash_type = XXH3_HASH;
+                } else if (strcmp(subopts_value, "aes") == 0) {
+                    hash_type = AES_HASH;
                 } else {
-                    fprintf(stderr, "Unknown hash_algorithm option (jenkins, murmur3, xxh3)\n");
+                    fprintf(stderr, "Unknown hash_algorithm option (jenkins, murmur3, xxh3, aes)\n");
                     return 1;
                 }
                 break;
@@ -5467,6 +5788,31 @@ int main (int argc, char **argv) {
                 }
                 settings.idle_timeout = atoi(subopts_value);
                 break;
+            case DISPATCH_MODE:
+                if (subopts_value == NULL) {
+                    fprintf(stderr, "Missing dispatch_mode argument\n");
+                    return 1;
+                }
+                if (strcmp(subopts_value, "round_robin") == 0) {
+                    settings.dispatch_load = false;
+                } else if (strcmp(subopts_value, "load") == 0) {
+                    settings.dispatch_load = true;
+                } else {
+                    fprintf(stderr, "Unknown dispatch_mode option (round_robin, load)\n");
+                    return 1;
+                }
+                break;
+            case DISPATCH_REBALANCE:
+                settings.dispatch_rebalance = true;
+                break;
+            case REUSEPORT_LISTEN:
+#ifdef SO_REUSEPORT
+                settings.reuseport_listen = true;
+#else
+                fprintf(stderr, "reuseport_listen is not supported on this platform\n");
+                return 1;
+#endif
+                break;
             case WATCHER_LOGBUF_SIZE:
                 if (subopts_value == NULL) {
                     fprintf(stderr, "Missing watcher_logbuf_size argument\n");
@@ -5746,6 +6092,24 @@ int main (int argc, char **argv) {
         exit(EX_USAGE);
     }
 
+    if (settings.dispatch_rebalance) {
+        // the idle timeout thread and NAPI dispatch both assume a conn
+        // stays on the worker it was first given to.
+        if (settings.idle_timeout || settings.num_napi_ids) {
+            fprintf(stderr, "dispatch_rebalance cannot be used with idle_timeout or -N\n");
+            exit(EX_USAGE);
+        }
+    }
+
+    if (settings.reuseport_listen) {
+        // the kernel picks the worker for each new conn, so there's nothing
+        // left for these to decide.
+        if (settings.dispatch_load || settings.num_napi_ids) {
+            fprintf(stderr, "reuseport_listen cannot be used with dispatch_mode=load or -N\n");
+            exit(EX_USAGE);
+        }
+    }
+
     if (settings.item_size_max < ITEM_SIZE_MAX_LOWER_LIMIT) {
         fprintf(stderr, "Item max size cannot be less than 1024 bytes.\n");
         exit(EX_USAGE);
@@ -337,7 +337,8 @@ struct slab_stats {
     X(response_obj_bytes) \
     X(read_buf_oom) \
     X(store_too_large) \
-    X(store_no_memory)
+    X(store_no_memory) \
+    X(conns_rebalanced) /* idle conns handed to another worker */
 
 #ifdef EXTSTORE
 #define EXTSTORE_THREAD_STATS_FIELDS \
@@ -354,7 +355,19 @@ struct slab_stats {
     X(proxy_conn_requests) \
     X(proxy_conn_errors) \
     X(proxy_conn_oom) \
-    X(proxy_req_active)
+    X(proxy_req_active) \
+    X(proxy_req_coalesced) \
+    X(proxy_l1_hits) \
+    X(proxy_l1_misses) \
+    X(proxy_l1_admits) \
+    X(proxy_l1_rejects) \
+    X(proxy_mget_keys) \
+    X(proxy_mget_batches) \
+    X(proxy_route_requests) \
+    X(proxy_route_failovers) \
+    X(proxy_hedge_sent) \
+    X(proxy_hedge_wins) \
+    X(proxy_hedge_denied)
 #endif
 
 /**
@@ -405,6 +418,9 @@ struct stats {
     uint64_t      extstore_compact_lost; /* items lost because they were locked */
     uint64_t      extstore_compact_rescues; /* items re-written during compaction */
     uint64_t      extstore_compact_skipped; /* unhit items skipped during compaction */
+    uint64_t      extstore_compact_bytes; /* bytes read back by compaction */
+    uint64_t      extstore_compact_pages; /* pages fully compacted */
+    uint64_t      extstore_compact_throttled; /* compaction reads held by the rate limit */
 #endif
 #ifdef TLS
     uint64_t      ssl_handshake_errors; /* TLS failures at accept/handshake time */
@@ -432,6 +448,10 @@ struct stats_state {
     bool          accepting_conns;  /* whether we are currently accepting */
     bool          slab_reassign_running; /* slab reassign in progress */
     bool          lru_crawler_running; /* crawl in progress */
+#ifdef EXTSTORE
+    unsigned int  extstore_compact_active; /* pages being compacted right now */
+    uint64_t      extstore_compact_rate; /* current compaction limit in bytes/sec */
+#endif
 };
 
 #define MAX_VERBOSITY_LEVEL 2
@@ -474,10 +494,12 @@ struct settings {
     bool lru_maintainer_thread; /* LRU maintainer background thread */
     bool lru_segmented;     /* Use split or flat LRU's */
     bool slab_reassign;     /* Whether or not slab reassignment is allowed */
+    bool slab_thread_cache; /* per-worker caches of free slab chunks */
     int slab_automove;     /* Whether or not to automatically move slabs */
     double slab_automove_ratio; /* youngest must be within pct of oldest */
     unsigned int slab_automove_window; /* window mover for algorithm */
     int hashpower_init;     /* Starting hash power level */
+    bool hash_bucketed;     /* cache line bucketed hash index instead of chains */
     bool shutdown_command; /* allow shutdown command */
     int tail_repair_time;   /* LRU tail refcount leak repair time */
     bool flush_enabled;     /* flush_all enabled */
@@ -506,11 +528,15 @@ struct settings {
     unsigned int ext_item_size; /* minimum size of items to store externally */
     unsigned int ext_item_age; /* max age of tail item before storing ext. */
     unsigned int ext_low_ttl; /* remaining TTL below this uses own pages */
+    unsigned int ext_ttl_buckets; /* bands of remaining TTL given own pages */
     unsigned int ext_recache_rate; /* counter++ % recache_rate == 0 > recache */
     unsigned int ext_wbuf_size; /* read only note for the engine */
     unsigned int ext_compact_under; /* when fewer than this many pages, compact */
     unsigned int ext_drop_under; /* when fewer than this many pages, drop COLD items */
     unsigned int ext_max_sleep; /* maximum sleep time for extstore bg threads, in us */
+    unsigned int ext_compact_streams; /* pages to compact at the same time */
+    unsigned int ext_compact_rate; /* compaction read limit in MB/s, 0 for none */
+    unsigned int ext_compact_read_lat; /* slow compaction when reads take longer, in us */
     double ext_max_frag; /* ideal maximum page fragmentation */
     double slab_automove_freeratio; /* % of memory to hold free as buffer */
     bool ext_drop_unread; /* skip unread items during compaction */
@@ -533,6 +559,9 @@ struct settings {
     int ssl_min_version; /* minimum SSL protocol version to accept */
 #endif
     int num_napi_ids;   /* maximum number of NAPI IDs */
+    bool dispatch_load; /* dispatch new conns to the least loaded worker */
+    bool dispatch_rebalance; /* move idle conns off overloaded workers */
+    bool reuseport_listen; /* each worker accepts on its own SO_REUSEPORT socket */
     char *memory_file;  /* warm restart memory file path */
 #ifdef PROXY
     bool proxy_enabled;
@@ -733,11 +762,23 @@ typedef struct {
     char   *ssl_wbuf;
 #endif
     int napi_id;                /* napi id associated with this thread */
+    uint64_t conns;             /* client connections owned by this thread */
+    uint64_t busy_ns;           /* time spent handling connection events */
+    uint64_t busy_ns_last;      /* busy_ns at the last load sample */
+    unsigned int util;          /* percent busy over the last load sample */
+    struct conn *conn_list;     /* client connections owned by this thread */
+    bool listen_paused;         /* own listeners disabled, listen_event pending */
+    struct event listen_event;  /* re-enables own listeners after EMFILE */
+    struct timeval listen_disabled; /* when own listeners were last disabled */
 #ifdef PROXY
     void *L;
     void *proxy_hooks;
     void *proxy_user_stats;
     void *proxy_int_stats;
+    void *proxy_l1; // near-cache for hot keys, if configured
+    int proxy_hedge_budget; // hedge credit earned per hedgeable read
+    int proxy_hedge_credit; // spent 100 at a time by hedged reads
+    bool proxy_batch_multiget; // route ascii multigets as one request
     uint32_t proxy_rng[4]; // fast per-thread rng for lua.
     // TODO: add ctx object so we can attach to queue.
 #endif
@@ -845,6 +886,7 @@ struct conn {
     io_queue_t io_queues[IO_QUEUE_COUNT]; /* set of deferred IO queues. */
 #ifdef PROXY
     unsigned int proxy_coro_ref; /* lua reference for active coroutine */
+    bool proxy_route_req; /* item is a route table request, not a value */
 #endif
 #ifdef EXTSTORE
     unsigned int recache_counter;
@@ -875,6 +917,9 @@ struct conn {
     int opaque;
     int keylen;
     conn   *next;     /* Used for generating a list of conn structures */
+    conn   *thread_prev; /* client conns owned by thread, see conn_thread_link() */
+    conn   *thread_next;
+    bool   thread_linked;
     LIBEVENT_THREAD *thread; /* Pointer to the thread object serving this connection */
     int (*try_read_command)(conn *c); /* pointer for top level input parser */
     ssize_t (*read)(conn  *c, void *buf, size_t count);
@@ -936,6 +981,8 @@ conn *conn_new(const int sfd, const enum conn_states init_state, const int event
     enum network_transport transport, struct event_base *base, void *ssl, uint64_t conntag, enum protocol bproto);
 
 void conn_worker_readd(conn *c);
+void conn_thread_link(conn *c);
+void conn_worker_rebalance(LIBEVENT_THREAD *from, LIBEVENT_THREAD *to);
 extern int daemonize(int nochdir, int noclose);
 
 #define mutex_lock(x) pthread_mutex_lock(x)
@@ -965,6 +1012,10 @@ void proxy_reload_notify(LIBEVENT_THREAD *t);
 void return_io_pending(io_pending_t *io);
 void dispatch_conn_new(int sfd, enum conn_states init_state, int event_flags, int read_buffer_size,
     enum network_transport transport, void *ssl, uint64_t conntag, enum protocol bproto);
+void dispatch_conn_local(LIBEVENT_THREAD *me, int sfd, enum conn_states init_state, int event_flags,
+    int read_buffer_size, enum network_transport transport, void *ssl, uint64_t conntag, enum protocol bproto);
+void dispatch_listen_conn(int tid, int sfd, enum network_transport transport, bool ssl_enabled,
+    uint64_t conntag, enum protocol bproto);
 void sidethread_conn_close(conn *c);
 
 /* Lock wrappers for cache functions that are called from main loop. */
@@ -973,6 +1024,8 @@ enum delta_result_type add_delta(conn *c, const char *key,
                                  const int64_t delta, char *buf,
                                  uint64_t *cas);
 void accept_new_conns(const bool do_accept);
+void worker_accept_new_conns(LIBEVENT_THREAD *t, const bool do_accept);
+void listen_conn_register(conn *c);
 void  conn_close_idle(conn *c);
 void  conn_close_all(void);
 item *item_alloc(char *key, size_t nkey, int flags, rel_time_t exptime, int nbytes);
@@ -1003,6 +1056,9 @@ void threadlocal_stats_reset(void);
 void threadlocal_stats_aggregate(struct thread_stats *stats);
 void slab_stats_aggregate(struct thread_stats *stats, struct slab_stats *out);
 LIBEVENT_THREAD *get_worker_thread(int id);
+uint64_t thread_clock_ns(void);
+void threads_load_update(void);
+void threads_stats(ADD_STAT add_stats, void *c);
 
 /* Stat processing functions */
 void append_stat(const char *name, ADD_STAT add_stats, conn *c,
@@ -14,6 +14,8 @@
 #define PROCESS_NORMAL false
 static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool multiget);
 static void mcp_queue_io(conn *c, mc_resp *resp, int coro_ref, lua_State *Lc);
+static void proxy_route_submit(conn *c, mc_resp *resp, mcp_route_req_t *rr, int ref);
+static void proxy_route_return(io_pending_proxy_t *p);
 static void proxy_out_errstring(mc_resp *resp, const char *str);
 
 /******** EXTERNAL FUNCTIONS ******/
@@ -73,6 +75,23 @@ void process_proxy_stats(ADD_STAT add_stats, conn *c) {
         snprintf(key_str, STAT_KEY_LEN-1, "user_%s", us->names[x]);
         APPEND_STAT(key_str, "%llu", (unsigned long long)counters[x]);
     }
+
+    // queue depth each backend's requests found when they were sent, in
+    // power of two buckets, and how long the backend takes to answer.
+    // names are cut short so the whole key fits in key_str.
+    mcp_backend_t *be = NULL;
+    STAILQ_FOREACH(be, &ctx->be_all, be_all_next) {
+        for (int x = 0; x < BE_DEPTH_BUCKETS; x++) {
+            snprintf(key_str, STAT_KEY_LEN-1, "backend_%.64s:%s_depth_%d", be->name, be->port, 1 << x);
+            APPEND_STAT(key_str, "%llu", (unsigned long long)__atomic_load_n(&be->depth_hist[x], __ATOMIC_RELAXED));
+        }
+        snprintf(key_str, STAT_KEY_LEN-1, "backend_%.64s:%s_lat_ewma_us", be->name, be->port);
+        APPEND_STAT(key_str, "%u", __atomic_load_n(&be->lat_ewma_us, __ATOMIC_RELAXED));
+        snprintf(key_str, STAT_KEY_LEN-1, "backend_%.64s:%s_lat_p95_us", be->name, be->port);
+        APPEND_STAT(key_str, "%u", __atomic_load_n(&be->lat_p95_us, __ATOMIC_RELAXED));
+        snprintf(key_str, STAT_KEY_LEN-1, "backend_%.64s:%s_lat_p99_us", be->name, be->port);
+        APPEND_STAT(key_str, "%u", __atomic_load_n(&be->lat_p99_us, __ATOMIC_RELAXED));
+    }
     STAT_UL(ctx);
 
     // return proxy counters
@@ -116,16 +135,28 @@ void proxy_init(bool use_uring) {
     // FIXME (v2): default defines.
     ctx->tunables.tcp_keepalive = false;
     ctx->tunables.backend_failure_limit = 3;
+    ctx->tunables.backend_connections = 1;
     ctx->tunables.connect.tv_sec = 5;
     ctx->tunables.retry.tv_sec = 3;
     ctx->tunables.read.tv_sec = 3;
+    ctx->tunables.l1_max_value = 4096;
+    ctx->tunables.l1_ttl = 1000;
+    ctx->tunables.read_min.tv_usec = 100000;
+    ctx->tunables.hedge_budget = 5;
 #ifdef HAVE_LIBURING
     ctx->tunables.connect_ur.tv_sec = 5;
     ctx->tunables.retry_ur.tv_sec = 3;
     ctx->tunables.read_ur.tv_sec = 3;
 #endif // HAVE_LIBURING
 
+    ctx->l1_inval = calloc(L1_INVAL_SLOTS, sizeof(uint64_t));
+    if (ctx->l1_inval == NULL) {
+        fprintf(stderr, "Failed to allocate proxy near-cache\n");
+        exit(EXIT_FAILURE);
+    }
+
     STAILQ_INIT(&ctx->manager_head);
+    STAILQ_INIT(&ctx->be_all);
     lua_State *L = luaL_newstate();
     ctx->proxy_state = L;
     luaL_openlibs(L);
@@ -281,8 +312,25 @@ void proxy_complete_cb(io_queue_t *q) {
 // the worker thread. Do post-IO run and cleanup work.
 void proxy_return_cb(io_pending_t *pending) {
     io_pending_proxy_t *p = (io_pending_proxy_t *)pending;
+    if (p->coalesced) {
+        LIBEVENT_THREAD *t = p->thread;
+        struct proxy_user_stats *tus = t->proxy_user_stats;
+        WSTAT_L(t);
+        t->stats.proxy_req_coalesced++;
+        if (p->coalesce_stat && tus && p->coalesce_stat <= tus->num_stats) {
+            tus->counters[p->coalesce_stat-1]++;
+        }
+        WSTAT_UL(t);
+    }
+
+    if (p->thread->proxy_l1) {
+        proxy_l1_written(settings.proxy_ctx, p->client_resp);
+    }
+
     if (p->is_await) {
         mcplib_await_return(p);
+    } else if (p->route) {
+        proxy_route_return(p);
     } else {
         lua_State *Lc = p->coro;
 
@@ -385,6 +433,7 @@ void proxy_cleanup_conn(conn *c) {
     lua_State *L = thr->L;
     luaL_unref(L, LUA_REGISTRYINDEX, c->proxy_coro_ref);
     c->proxy_coro_ref = 0;
+    c->proxy_route_req = false;
     WSTAT_DECR(c, proxy_req_active, 1);
 }
 
@@ -402,6 +451,28 @@ void complete_nread_proxy(conn *c) {
 
     conn_set_state(c, conn_new_cmd);
 
+    if (c->proxy_route_req) {
+        // Request from a route table: the value was read straight into it,
+        // and the table reference moves on to the IO.
+        mcp_route_req_t *rr = c->item;
+        int ref = c->proxy_coro_ref;
+        c->item = NULL;
+        c->item_malloced = false;
+        c->proxy_coro_ref = 0;
+        c->proxy_route_req = false;
+
+        if (strncmp((char *)rr->pr.vbuf + rr->pr.vlen - 2, "\r\n", 2) != 0) {
+            luaL_unref(L, LUA_REGISTRYINDEX, ref);
+            free(rr);
+            WSTAT_DECR(c, proxy_req_active, 1);
+            out_string(c, "CLIENT_ERROR bad data chunk");
+            return;
+        }
+
+        proxy_route_submit(c, c->resp, rr, ref);
+        return;
+    }
+
     // Grab our coroutine.
     lua_rawgeti(L, LUA_REGISTRYINDEX, c->proxy_coro_ref);
     luaL_unref(L, LUA_REGISTRYINDEX, c->proxy_coro_ref);
@@ -616,6 +687,197 @@ int proxy_run_coroutine(lua_State *Lc, mc_resp *resp, io_pending_proxy_t *p, con
     return 0;
 }
 
+// Requests that a route table sends to a pool skip lua entirely. They're
+// copied into a mcp_route_req_t, which stands in for the request and
+// response objects, and queued straight to the backend. Each IO holds a
+// reference to the route table, so its pools can't go away while the
+// request is in flight.
+static void proxy_route_queue(conn *c, mc_resp *resp, io_pending_proxy_t *p, mcp_route_req_t *rr, mcp_pool_t *pool) {
+    io_queue_t *q = conn_io_queue_get(c, IO_QUEUE_PROXY);
+    mcp_parser_t *pr = &rr->pr;
+    mcp_resp_t *r = &rr->r;
+    mcp_backend_t *be = mcplib_pool_proxy_call_helper(c->thread->L, pool,
+            MCP_PARSER_KEY(rr->pr), pr->klen);
+
+    p->io_queue_type = IO_QUEUE_PROXY;
+    p->thread = c->thread;
+    p->c = c;
+    p->resp = resp;
+    p->client_resp = r;
+    p->flushed = false;
+    p->ascii_multiget = rr->ascii_multiget;
+    p->route = true;
+    if (c->thread->proxy_l1) {
+        proxy_l1_track(pr, r);
+    }
+    p->coro = c->thread->L; // for releasing coro_ref
+    p->backend = be;
+    strncpy(r->be_name, be->name, MAX_NAMELEN+1);
+    strncpy(r->be_port, be->port, MAX_PORTLEN+1);
+
+    p->iov[0].iov_base = rr->request;
+    p->iov[0].iov_len = pr->reqlen;
+    p->iovcnt = 1;
+    p->iovbytes = pr->reqlen;
+    if (pr->vlen != 0) {
+        p->iov[1].iov_base = pr->vbuf;
+        p->iov[1].iov_len = pr->vlen;
+        p->iovcnt = 2;
+        p->iovbytes += pr->vlen;
+    }
+
+    if (pool->coalesce && mcp_request_plain_read(pr)) {
+        p->coalesce = true;
+        p->creqlen = pr->reqlen;
+        p->coalesce_stat = pool->coalesce_stat;
+    }
+
+    resp->io_pending = (io_pending_t *)p;
+    p->next = q->stack_ctx;
+    q->stack_ctx = p;
+}
+
+static void proxy_route_submit(conn *c, mc_resp *resp, mcp_route_req_t *rr, int ref) {
+    io_pending_proxy_t *p = do_cache_alloc(c->thread->io_cache);
+    if (p == NULL) {
+        luaL_unref(c->thread->L, LUA_REGISTRYINDEX, ref);
+        free(rr);
+        WSTAT_INCR(c, proxy_conn_oom, 1);
+        WSTAT_DECR(c, proxy_req_active, 1);
+        proxy_out_errstring(resp, "out of memory");
+        return;
+    }
+    memset(p, 0, sizeof(io_pending_proxy_t));
+    p->coro_ref = ref;
+
+    WSTAT_INCR(c, proxy_route_requests, 1);
+    proxy_route_queue(c, resp, p, rr, rr->e->pool);
+}
+
+static void proxy_route_dispatch(conn *c, mcp_parser_t *pr, struct mcp_route_entry *e,
+        int route_ref, const char *command, size_t cmdlen, bool multiget) {
+    LIBEVENT_THREAD *thr = c->thread;
+    lua_State *L = thr->L;
+
+    if (e == NULL || !pr->keytoken) {
+        WSTAT_DECR(c, proxy_req_active, 1);
+        proxy_out_errstring(c->resp, e == NULL ? "no route for key" : "cannot route commands without key");
+        return;
+    }
+
+    mcp_route_req_t *rr = malloc(sizeof(mcp_route_req_t) + cmdlen + pr->vlen);
+    if (rr == NULL) {
+        WSTAT_INCR(c, proxy_conn_oom, 1);
+        WSTAT_DECR(c, proxy_req_active, 1);
+        proxy_out_errstring(c->resp, "out of memory");
+        return;
+    }
+    memset(rr, 0, sizeof(mcp_route_req_t));
+    memcpy(&rr->pr, pr, sizeof(*pr));
+    memcpy(rr->request, command, cmdlen);
+    rr->pr.request = rr->request;
+    rr->pr.reqlen = cmdlen;
+    rr->e = e;
+    rr->ascii_multiget = multiget;
+    mcp_request_reply_mode(&rr->pr, rr->request, &rr->r);
+
+    if (thr->proxy_l1) {
+        proxy_l1_invalidate(settings.proxy_ctx, &rr->pr, proxy_l1_now());
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, route_ref);
+    int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    if (pr->vlen != 0) {
+        // read the value in directly behind the request line.
+        rr->pr.vbuf = rr->request + cmdlen;
+        c->item = rr;
+        c->item_malloced = true;
+        c->ritem = rr->pr.vbuf;
+        c->rlbytes = pr->vlen;
+        c->proxy_coro_ref = ref;
+        c->proxy_route_req = true;
+
+        conn_set_state(c, conn_nread);
+        return;
+    }
+
+    proxy_route_submit(c, c->resp, rr, ref);
+}
+
+// A backend that couldn't be reached and one that answered with its own
+// SERVER_ERROR are both worth another try on the failover pool.
+static bool proxy_route_failed(mcp_resp_t *r) {
+    if (r->status != MCMC_OK) {
+        return true;
+    }
+    return r->resp.type == MCMC_RESP_GENERIC && r->buf != NULL
+        && r->blen >= 12 && memcmp(r->buf, "SERVER_ERROR", 12) == 0;
+}
+
+static void proxy_route_return(io_pending_proxy_t *p) {
+    mcp_route_req_t *rr = (mcp_route_req_t *)p->client_resp;
+    mcp_resp_t *r = &rr->r;
+    mc_resp *resp = p->resp;
+    conn *c = p->c;
+    io_queue_t *q = conn_io_queue_get(c, p->io_queue_type);
+
+    if (rr->e->failover && !rr->failed_over && proxy_route_failed(r)) {
+        // try once more against the failover pool, reusing the IO.
+        int ref = p->coro_ref;
+        uint8_t cmd = r->cmd;
+        enum mcp_resp_mode mode = r->mode;
+
+        free(r->buf);
+        free(r->mbuf);
+        memset(r, 0, sizeof(mcp_resp_t));
+        r->cmd = cmd;
+        r->mode = mode;
+        rr->failed_over = true;
+
+        memset(p, 0, sizeof(io_pending_proxy_t));
+        p->coro_ref = ref;
+        WSTAT_INCR(c, proxy_route_failovers, 1);
+        proxy_route_queue(c, resp, p, rr, rr->e->failover);
+    } else {
+        WSTAT_DECR(c, proxy_req_active, 1);
+        _set_noreply_mode(resp, r);
+        if (r->buf) {
+            resp->write_and_free = r->buf;
+            resp_add_iov(resp, r->buf, r->blen);
+            r->buf = NULL;
+        } else if (r->status != MCMC_OK) {
+            proxy_out_errstring(resp, "backend failure");
+        }
+        free(r->mbuf);
+        free(rr);
+        p->client_resp = NULL;
+    }
+
+    q->count--;
+    if (q->count == 0) {
+        // call re-add directly since we're already in the worker thread.
+        conn_worker_readd(c);
+    }
+}
+
+// A multiget with more than one key, all of them valid, can be handed to the
+// route as one request. Pools then split it up into a batch per backend.
+static bool proxy_multiget_batchable(mcp_parser_t *pr) {
+    mcp_parser_t tpr = *pr;
+    int keys = 0;
+
+    while (tpr.klen != 0) {
+        if (tpr.klen > KEY_MAX_LENGTH) {
+            return false;
+        }
+        keys++;
+        _process_request_next_key(&tpr);
+    }
+
+    return keys > 1;
+}
+
 static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool multiget) {
     assert(c != NULL);
     LIBEVENT_THREAD *thr = c->thread;
@@ -645,6 +907,8 @@ static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool mu
 
     struct proxy_hook *hook = &hooks[pr.command];
     int hook_ref = hook->lua_ref;
+    mcp_route_t *route = hook->route;
+    bool hook_pool = hook->pool;
     // if client came from a tagged listener, scan for a more specific hook.
     // TODO: (v2) avoiding a hash table lookup here, but maybe some other
     // datastructure would suffice. for 4-8 tags this is perfectly fast.
@@ -653,6 +917,8 @@ static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool mu
         while (pht->lua_ref) {
             if (c->tag == pht->tag) {
                 hook_ref = pht->lua_ref;
+                route = pht->route;
+                hook_pool = pht->pool;
                 break;
             }
             pht++;
@@ -684,7 +950,16 @@ static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool mu
     // might be better to split this function; the below bits turn into a
     // function call, then we don't re-process the above bits in the same way?
     // The way this is detected/passed on is very fragile.
-    if (!multiget && pr.cmd_type == CMD_TYPE_GET && pr.has_space) {
+    // Batching is only safe when the hook is a pool: a lua function or route
+    // only gets to look at the first key before picking where it goes.
+    bool mget_batch = false;
+    if (!multiget && pr.cmd_type == CMD_TYPE_GET && pr.has_space
+            && thr->proxy_batch_multiget && hook_pool
+            && proxy_multiget_batchable(&pr)) {
+        mget_batch = true;
+    }
+
+    if (!multiget && !mget_batch && pr.cmd_type == CMD_TYPE_GET && pr.has_space) {
         uint32_t keyoff = pr.tokens[pr.keytoken];
         while (pr.klen != 0) {
             char temp[KEY_MAX_LENGTH + 30];
@@ -736,7 +1011,7 @@ static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool mu
 
     // We test the command length all the way down here because multigets can
     // be very long, and they're chopped up by now.
-    if (cmdlen >= MCP_REQUEST_MAXLEN) {
+    if (cmdlen >= MCP_REQUEST_MAXLEN && !mget_batch) {
         WSTAT_INCR(c, proxy_conn_errors, 1);
         if (!resp_start(c)) {
             conn_set_state(c, conn_closing);
@@ -762,6 +1037,16 @@ static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool mu
     c->thread->stats.proxy_req_active++;
     WSTAT_UL(c->thread);
 
+    if (route != NULL) {
+        struct mcp_route_entry *e = mcp_route_lookup(route, &pr);
+        if (e == NULL || e->func_ref == 0) {
+            proxy_route_dispatch(c, &pr, e, hook_ref, command, cmdlen, multiget);
+            return;
+        }
+        // needs scripting: run the route's function like any other hook.
+        hook_ref = e->func_ref;
+    }
+
     // start a coroutine.
     // TODO (v2): This can pull a thread from a cache.
     lua_newthread(L);
@@ -774,6 +1059,10 @@ static void proxy_process_command(conn *c, char *command, size_t cmdlen, bool mu
     if (multiget) {
         rq->ascii_multiget = true;
     }
+    rq->mget_batch = mget_batch;
+    if (thr->proxy_l1) {
+        proxy_l1_invalidate(settings.proxy_ctx, &rq->pr, rq->l1_start);
+    }
     // NOTE: option 1) copy c->tag into rq->tag here.
     // add req:listen_tag() to retrieve in top level route.
 
@@ -828,23 +1117,7 @@ static void mcp_queue_io(conn *c, mc_resp *resp, int coro_ref, lua_State *Lc) {
     // the coroutine but the structure doesn't allow that yet.
     // Should also be able to settle this exact mode from the parser so we
     // don't have to re-branch here.
-    if (rq->pr.noreply) {
-        if (rq->pr.cmd_type == CMD_TYPE_META) {
-            r->mode = RESP_MODE_METAQUIET;
-            for (int x = 2; x < rq->pr.ntokens; x++) {
-                if (rq->request[rq->pr.tokens[x]] == 'q') {
-                    rq->request[rq->pr.tokens[x]] = ' ';
-                }
-            }
-        } else {
-            r->mode = RESP_MODE_NOREPLY;
-            rq->request[rq->pr.reqlen - 3] = 'Y';
-        }
-    } else {
-        r->mode = RESP_MODE_NORMAL;
-    }
-
-    r->cmd = rq->pr.command;
+    mcp_request_reply_mode(&rq->pr, rq->request, r);
 
     luaL_getmetatable(Lc, "mcp.response");
     lua_setmetatable(Lc, -2);
@@ -868,6 +1141,9 @@ static void mcp_queue_io(conn *c, mc_resp *resp, int coro_ref, lua_State *Lc) {
     p->flushed = false;
     p->ascii_multiget = rq->ascii_multiget;
     resp->io_pending = (io_pending_t *)p;
+    if (c->thread->proxy_l1) {
+        proxy_l1_track(&rq->pr, r);
+    }
 
     // top of the main thread should be our coroutine.
     // lets grab a reference to it and pop so it doesn't get gc'ed.
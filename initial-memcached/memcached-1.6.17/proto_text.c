@@ -17,6 +17,11 @@
 #endif
 #include <string.h>
 #include <stdlib.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define META_SPACE(p) { \
     *p = ' '; \
@@ -263,6 +268,48 @@ void complete_nread_ascii(conn *c) {
         } \
     } while (0)
 
+/*
+ * Delimiter scan for tokenize_command(). Each call looks at one aligned
+ * block and returns bitmasks of its spaces and NUL bytes, bit N for byte N.
+ * Bytes before 'from' aren't part of the command; the caller masks them.
+ * The vector versions load the whole block; aligned loads never cross a
+ * page, so reading past the terminating NUL of the command can't fault. The
+ * plain C version has no such excuse, so it only reads from 'from' up to
+ * the first NUL.
+ */
+#if defined(__AVX2__)
+#define TOKEN_BLOCK 32
+static inline void token_scan(const char *block, const int from,
+        uint32_t *spaces, uint32_t *ends) {
+    __m256i v = _mm256_load_si256((const __m256i *)block);
+    *spaces = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    *ends = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+}
+#elif defined(__SSE2__)
+#define TOKEN_BLOCK 16
+static inline void token_scan(const char *block, const int from,
+        uint32_t *spaces, uint32_t *ends) {
+    __m128i v = _mm_load_si128((const __m128i *)block);
+    *spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    *ends = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+#else
+#define TOKEN_BLOCK 16
+static inline void token_scan(const char *block, const int from,
+        uint32_t *spaces, uint32_t *ends) {
+    uint32_t sp = 0, nul = 0;
+    for (int x = from; x < TOKEN_BLOCK; x++) {
+        if (block[x] == '\0') {
+            nul = (uint32_t)1 << x;
+            break;
+        }
+        sp |= (uint32_t)(block[x] == ' ') << x;
+    }
+    *spaces = sp;
+    *ends = nul;
+}
+#endif
+
 /*
  * Tokenize the command string by replacing whitespace with '\0' and update
  * the token array tokens with pointer to start of each token and length.
@@ -270,6 +317,10 @@ void complete_nread_ascii(conn *c) {
  * token (value points to the first unprocessed character of the string and
  * length zero).
  *
+ * Token boundaries are found a block at a time with token_scan(), so long
+ * multiget lines aren't walked byte by byte or measured with strlen() on
+ * every refill.
+ *
  * Usage example:
  *
  *  while(tokenize_command(command, ncommand, tokens, max_tokens) > 0) {
@@ -282,28 +333,47 @@ void complete_nread_ascii(conn *c) {
  */
 static size_t tokenize_command(char *command, token_t *tokens, const size_t max_tokens) {
     char *s, *e;
+    char *block;
+    uint32_t spaces, ends;
     size_t ntokens = 0;
     assert(command != NULL && tokens != NULL && max_tokens > 1);
-    size_t len = strlen(command);
-    unsigned int i = 0;
 
-    s = e = command;
-    for (i = 0; i < len; i++) {
-        if (*e == ' ') {
+    s = command;
+    block = (char *)((uintptr_t)command & ~(uintptr_t)(TOKEN_BLOCK - 1));
+    token_scan(block, command - block, &spaces, &ends);
+    // ignore the bytes in front of the command.
+    spaces &= UINT32_MAX << (command - block);
+    ends &= UINT32_MAX << (command - block);
+
+    for (;;) {
+        if (ends) {
+            // only the spaces before the terminator count.
+            spaces &= (ends & -ends) - 1;
+        }
+
+        while (spaces) {
+            e = block + __builtin_ctz(spaces);
+            spaces &= spaces - 1;
             if (s != e) {
                 tokens[ntokens].value = s;
                 tokens[ntokens].length = e - s;
                 ntokens++;
                 *e = '\0';
                 if (ntokens == max_tokens - 1) {
+                    /* so we don't add an extra token */
                     e++;
-                    s = e; /* so we don't add an extra token */
-                    break;
+                    goto done;
                 }
             }
             s = e + 1;
         }
-        e++;
+
+        if (ends) {
+            e = block + __builtin_ctz(ends);
+            break;
+        }
+        block += TOKEN_BLOCK;
+        token_scan(block, 0, &spaces, &ends);
     }
 
     if (s != e) {
@@ -312,6 +382,7 @@ static size_t tokenize_command(char *command, token_t *tokens, const size_t max_
         ntokens++;
     }
 
+done:
     /*
      * If we scanned the whole string, the terminal value pointer is null,
      * otherwise it is the first unprocessed character.
@@ -2238,6 +2309,27 @@ static void process_debugtime_command(conn *c, token_t *tokens, const size_t nto
     }
     out_string(c, "OK");
 }
+
+/* Holds the LRU maintainer so tests can see queued bumps before they're
+ * applied. Pause and resume must come from the same connection. */
+static void process_debuglru_command(conn *c, token_t *tokens, const size_t ntokens) {
+    static bool lru_paused = false;
+    if (strcmp(tokens[1].value, "p") == 0) {
+        if (!lru_paused) {
+            lru_maintainer_pause();
+            lru_paused = true;
+        }
+    } else if (strcmp(tokens[1].value, "r") == 0) {
+        if (lru_paused) {
+            lru_paused = false;
+            lru_maintainer_resume();
+        }
+    } else {
+        out_string(c, "ERROR");
+        return;
+    }
+    out_string(c, "OK");
+}
 #endif
 
 static void process_slabs_automove_command(conn *c, token_t *tokens, const size_t ntokens) {
@@ -2456,6 +2548,12 @@ static void process_extstore_command(conn *c, token_t *tokens, const size_t ntok
     } else if (strcmp(tokens[1].value, "max_sleep") == 0) {
         if (!safe_strtoul(tokens[2].value, &settings.ext_max_sleep))
             ok = false;
+    } else if (strcmp(tokens[1].value, "compact_rate") == 0) {
+        if (!safe_strtoul(tokens[2].value, &settings.ext_compact_rate))
+            ok = false;
+    } else if (strcmp(tokens[1].value, "compact_read_lat") == 0) {
+        if (!safe_strtoul(tokens[2].value, &settings.ext_compact_read_lat))
+            ok = false;
     } else if (strcmp(tokens[1].value, "max_frag") == 0) {
         if (!safe_strtod(tokens[2].value, &settings.ext_max_frag))
             ok = false;
@@ -2874,6 +2972,9 @@ void process_command_ascii(conn *c, char *command) {
         } else if (strcmp(tokens[COMMAND_TOKEN].value, "debugtime") == 0) {
             WANT_TOKENS_MIN(ntokens, 2);
             process_debugtime_command(c, tokens, ntokens);
+        } else if (strcmp(tokens[COMMAND_TOKEN].value, "debuglru") == 0) {
+            WANT_TOKENS_MIN(ntokens, 2);
+            process_debuglru_command(c, tokens, ntokens);
 #endif
         } else {
             out_string(c, "ERROR");
@@ -186,16 +186,25 @@ struct proxy_tunables {
     struct timeval connect;
     struct timeval retry; // wait time before retrying a dead backend
     struct timeval read;
+    struct timeval read_min; // floor for adaptive read timeouts
 #ifdef HAVE_LIBURING
     struct __kernel_timespec connect_ur;
     struct __kernel_timespec retry_ur;
     struct __kernel_timespec read_ur;
 #endif // HAVE_LIBURING
     int backend_failure_limit;
+    int backend_connections; // sockets per backend
+    int l1_items; // per worker thread near-cache size, 0 to disable
+    int l1_max_value; // largest response the near-cache will hold
+    int l1_ttl; // near-cache lifetime in milliseconds
+    int read_adaptive; // read timeout as a multiple of backend p99, 0 to disable
+    int hedge_budget; // hedged reads allowed, as a percent of hedgeable reads
     bool tcp_keepalive;
+    bool batch_multiget; // send ascii multigets to pools attached directly as per-backend batches
 };
 
 typedef STAILQ_HEAD(pool_head_s, mcp_pool_s) pool_head_t;
+typedef STAILQ_HEAD(be_all_head_s, mcp_backend_s) be_all_head_t;
 typedef struct {
     lua_State *proxy_state;
     void *proxy_code;
@@ -209,6 +218,7 @@ typedef struct {
     pthread_mutex_t manager_lock;
     pthread_cond_t manager_cond;
     pool_head_t manager_head; // stack for pool deallocation.
+    be_all_head_t be_all; // every live backend, covered by stats_lock
     bool worker_done; // signal variable for the worker lock/cond system.
     bool worker_failed; // covered by worker_lock as well.
     bool use_uring; // use IO_URING for backend connections.
@@ -216,16 +226,24 @@ typedef struct {
     struct proxy_user_stats user_stats;
     struct proxy_tunables tunables; // NOTE: updates covered by stats_lock
     pthread_mutex_t stats_lock; // used for rare global counters
+    uint64_t *l1_inval; // last write time (monotonic ms) per key hash slot
+    uint64_t l1_flushed; // last flush_all time (monotonic ms)
 } proxy_ctx_t;
 
+typedef struct mcp_route_s mcp_route_t;
+
 struct proxy_hook_tagged {
     uint64_t tag;
     int lua_ref;
+    mcp_route_t *route; // set if lua_ref is a route table
+    bool pool; // lua_ref is a pool, called directly with the request
 };
 
 struct proxy_hook {
     int lua_ref;
     int tagcount;
+    mcp_route_t *route; // set if lua_ref is a route table
+    bool pool; // lua_ref is a pool, called directly with the request
     struct proxy_hook_tagged *tagged; // array of possible tagged hooks.
 };
 
@@ -246,6 +264,7 @@ enum mcp_backend_states {
     mcp_backend_read = 0, // waiting to read any response
     mcp_backend_parse, // have some buffered data to check
     mcp_backend_read_end, // looking for an "END" marker for GET
+    mcp_backend_read_batch, // collect a value from a multi-key GET
     mcp_backend_want_read, // read more data to complete command
     mcp_backend_next, // advance to the next IO
 };
@@ -287,9 +306,13 @@ struct mcp_parser_s {
 struct mcp_request_s {
     mcp_parser_t pr; // non-lua-specific parser handling.
     struct timeval start; // time this object was created.
+    uint64_t l1_start; // monotonic ms this object was created, for the near-cache.
     mcp_backend_t *be; // backend handling this request.
     bool ascii_multiget; // ascii multiget mode. (hide errors/END)
+    bool mget_batch; // holds every key of an ascii multiget
     bool was_modified; // need to rewrite the request
+    bool coalesce; // pool allows identical in-flight reads to be merged
+    int coalesce_stat; // user stat to bump when a request was coalesced
     int tokent_ref; // reference to token table if modified.
     char request[];
 };
@@ -305,8 +328,27 @@ typedef STAILQ_HEAD(io_head_s, _io_pending_proxy_t) io_head_t;
 #else
 #define BE_IOV_MAX IOV_MAX
 #endif
+// in-flight reads that can be coalesced are hashed into a small table per
+// backend. must be a power of two.
+#define BE_COALESCE_BUCKETS 64
+// queue depth histogram buckets: 1, 2-3, 4-7, ... 1024+
+#define BE_DEPTH_BUCKETS 11
+// log-linear latency buckets: four per power of two, up to ~2^31us.
+#define BE_LAT_BUCKETS 128
+#define BE_LAT_RECALC 128 // recompute percentiles every N samples
+#define BE_CONNS_MAX 64
 struct mcp_backend_s {
     int depth;
+    int conncount; // number of extra connections in conns
+    mcp_backend_t *conns; // extra connections to the same server
+    mcp_backend_t *owner; // the lua backend object this connection belongs to
+    STAILQ_ENTRY(mcp_backend_s) be_all_next; // list of all lua backends, for stats
+    uint64_t depth_hist[BE_DEPTH_BUCKETS]; // queue depth seen by new requests
+    uint32_t lat_hist[BE_LAT_BUCKETS]; // decaying response time sketch
+    uint32_t lat_total; // samples currently in lat_hist
+    uint32_t lat_ewma_us; // smoothed response time
+    uint32_t lat_p95_us; // hedge delay
+    uint32_t lat_p99_us; // basis for adaptive read timeouts
     int failed_count; // number of fails (timeouts) in a row
     pthread_mutex_t mutex; // covers stack.
     proxy_event_thread_t *event_thread; // event thread owning this backend.
@@ -320,6 +362,7 @@ struct mcp_backend_s {
     proxy_event_t ur_rd_ev; // liburing.
     proxy_event_t ur_wr_ev; // need a separate event/cb for writing/polling
     proxy_event_t ur_te_ev; // for timeout handling
+    struct __kernel_timespec read_ur; // adaptive read timeout
 #endif
     enum mcp_backend_states state; // readback state machine
     int connect_flags; // flags to pass to mcmc_connect
@@ -327,7 +370,9 @@ struct mcp_backend_s {
     bool can_write; // recently got a WANT_WRITE or are connecting.
     bool stacked; // if backend already queued for syscalls.
     bool bad; // timed out, marked as bad.
+    bool listed; // on the ctx's list of backends.
     struct iovec write_iovs[BE_IOV_MAX]; // iovs to stage batched writes
+    io_pending_proxy_t *coalesce[BE_COALESCE_BUCKETS]; // in-flight reads others can wait on
     char name[MAX_NAMELEN+1];
     char port[MAX_PORTLEN+1];
 };
@@ -370,9 +415,13 @@ typedef struct {
     mcmc_resp_t resp;
     char *buf; // response line + potentially value.
     size_t blen; // total size of the value to read.
+    char *mbuf; // values collected so far for a batched multiget
+    size_t mblen;
     int status; // status code from mcmc_read()
     int bread; // amount of bytes read into value so far.
     uint8_t cmd; // from parser (pr.command)
+    uint8_t l1_write; // near-cache slot to stamp once answered (L1_WRITE_*)
+    uint64_t l1_hv; // key hash for L1_WRITE_KEY
     enum mcp_resp_mode mode; // reply mode (for noreply fixing)
     char be_name[MAX_NAMELEN+1];
     char be_port[MAX_PORTLEN+1];
@@ -386,7 +435,8 @@ struct _io_pending_proxy_t {
     conn *c;
     mc_resp *resp;  // original struct ends here
 
-    struct _io_pending_proxy_t *next; // stack for IO submission
+    struct _io_pending_proxy_t *next; // stack for IO submission, then
+                                      // waiters if coalescing on the backend
     STAILQ_ENTRY(_io_pending_proxy_t) io_next; // stack for backends
     int coro_ref; // lua registry reference to the coroutine
     int mcpres_ref; // mcp.res reference used for await()
@@ -396,11 +446,19 @@ struct _io_pending_proxy_t {
     int iovcnt; // 1 or 2...
     unsigned int iovbytes; // total bytes in the iovec
     int await_ref; // lua reference if we were an await object
+    uint32_t start_us; // when the event thread picked us up, for latency
     mcp_resp_t *client_resp; // reference (currently pointing to a lua object)
+    struct _io_pending_proxy_t *cnext; // chain for the backend coalesce table
+    unsigned int creqlen; // request length, since flushing eats iov_len
+    int coalesce_stat; // passed on from mcp_r_t
     bool flushed; // whether we've fully written this request to a backend.
     bool ascii_multiget; // passed on from mcp_r_t
     bool is_await; // are we an await object?
     bool await_first; // are we the main route for an await object?
+    bool coalesce; // identical in-flight reads may share this response
+    bool coalesced; // we were answered with another request's response
+    bool batch; // multi-key get: read VALUE's until the END
+    bool route; // queued by a route table rather than a coroutine
 };
 
 // Note: does *be have to be a sub-struct? how stable are userdata pointers?
@@ -426,6 +484,8 @@ struct mcp_pool_s {
     int phc_ref;
     int self_ref; // TODO (v2): double check that this is needed.
     int pool_size;
+    int coalesce_stat; // user stat index for coalesced requests, or 0
+    bool coalesce; // merge identical in-flight reads to a backend
     mcp_pool_be_t pool[];
 };
 
@@ -433,6 +493,33 @@ typedef struct {
     mcp_pool_t *main; // ptr to original
 } mcp_pool_proxy_t;
 
+// Route tables map key prefixes to pools, so simple routing can be done
+// without running lua for each request.
+struct mcp_route_entry {
+    mcp_pool_t *pool;
+    mcp_pool_t *failover; // retried once if pool fails or sends SERVER_ERROR
+    int func_ref; // lua route function, for entries that need scripting
+    size_t plen;
+    char *prefix;
+};
+
+struct mcp_route_s {
+    int count;
+    struct mcp_route_entry def; // used if no prefix matches
+    struct mcp_route_entry entries[]; // longest prefix first
+};
+
+// Stands in for the mcp.request and mcp.response objects for a request
+// served by a route table.
+typedef struct {
+    mcp_resp_t r; // must be first: the IO's client_resp points here
+    mcp_parser_t pr;
+    struct mcp_route_entry *e;
+    bool ascii_multiget;
+    bool failed_over;
+    char request[]; // request line, then the value if there is one
+} mcp_route_req_t;
+
 // networking interface
 void proxy_init_evthread_events(proxy_event_thread_t *t);
 void *proxy_event_thread(void *arg);
@@ -443,8 +530,11 @@ enum mcp_await_e {
     AWAIT_ANY, // any response, including errors,
     AWAIT_OK, // any non-error response
     AWAIT_FIRST, // return the result from the first pool
+    AWAIT_HEDGE, // first OK from a primary pool, or a replica sent after its p95
+    AWAIT_MGET, // internal: a batched multiget split across one pool
 };
 int mcplib_await(lua_State *L);
+int mcplib_await_mget(lua_State *L, mcp_request_t *rq);
 int mcplib_await_run(conn *c, mc_resp *resp, lua_State *L, int coro_ref);
 int mcplib_await_return(io_pending_proxy_t *p);
 
@@ -471,12 +561,35 @@ int mcplib_open_dist_jump_hash(lua_State *L);
 int mcplib_open_dist_ring_hash(lua_State *L);
 
 int proxy_run_coroutine(lua_State *Lc, mc_resp *resp, io_pending_proxy_t *p, conn *c);
+uint32_t mcplib_pool_proxy_lookup(lua_State *L, mcp_pool_t *p, const char *key, size_t len);
 mcp_backend_t *mcplib_pool_proxy_call_helper(lua_State *L, mcp_pool_t *p, const char *key, size_t len);
 void mcp_request_attach(lua_State *L, mcp_request_t *rq, io_pending_proxy_t *p);
+bool mcp_request_plain_read(mcp_parser_t *pr);
+void mcp_request_reply_mode(mcp_parser_t *pr, char *request, mcp_resp_t *r);
+void mcp_resp_rebase(mcmc_resp_t *resp, const char *from, size_t len, char *to);
 void proxy_lua_error(lua_State *L, const char *s);
 void proxy_lua_ferror(lua_State *L, const char *fmt, ...);
 int _start_proxy_config_threads(proxy_ctx_t *ctx);
 int proxy_thread_loadconf(LIBEVENT_THREAD *thr);
+int mcplib_route_table(lua_State *L);
+int mcplib_route_table_gc(lua_State *L);
+struct mcp_route_entry *mcp_route_lookup(mcp_route_t *rt, mcp_parser_t *pr);
+
+// near-cache interface
+#define L1_INVAL_SLOTS (1 << 14)
+void proxy_l1_configure(LIBEVENT_THREAD *thr);
+#define L1_WRITE_NONE 0
+#define L1_WRITE_KEY 1
+#define L1_WRITE_FLUSH 2
+uint64_t proxy_l1_now(void);
+void proxy_l1_invalidate(proxy_ctx_t *ctx, mcp_parser_t *pr, uint64_t start);
+void proxy_l1_track(mcp_parser_t *pr, mcp_resp_t *r);
+void proxy_l1_written(proxy_ctx_t *ctx, mcp_resp_t *r);
+int mcplib_l1_size(lua_State *L);
+int mcplib_l1_ttl(lua_State *L);
+int mcplib_l1_get(lua_State *L);
+int mcplib_l1_set(lua_State *L);
+int mcplib_l1_invalidate(lua_State *L);
 
 // TODO (v2): more .h files, perhaps?
 int mcplib_open_hash_xxhash(lua_State *L);
@@ -2,6 +2,39 @@
 
 #include "proxy.h"
 
+// A batched multiget sends one "get k1 k2 ...\r\n" to each backend the keys
+// map to, and remembers which batch each key went out in.
+struct mcp_mget_key {
+    uint32_t off; // offset of the key in the original request
+    uint32_t batch; // index of the batch the key was sent in
+    uint8_t len;
+};
+
+struct mcp_mget_batch {
+    mcp_backend_t *be;
+    mcp_resp_t *r; // response to this batch
+    char *cmd; // request string for this batch
+    size_t len;
+    size_t pos; // how far the merge has read into r->buf
+    int keys;
+};
+
+typedef struct {
+    int nkeys;
+    int nbatch;
+    char *cmds; // holds every batch's request string
+    struct mcp_mget_key *keys;
+    struct mcp_mget_batch batch[];
+} mcp_mget_t;
+
+#define MGET_ERRSTR "SERVER_ERROR backend failure\r\n"
+#define MGET_ERRLEN (sizeof(MGET_ERRSTR) - 1)
+
+// Each hedgeable read earns hedge_budget credits and a hedge costs 100, so
+// hedges stay under that percent of reads. Credit is capped to limit bursts.
+#define HEDGE_COST 100
+#define HEDGE_CREDIT_MAX 1000
+
 typedef struct mcp_await_s {
     int pending;
     int wait_for;
@@ -13,6 +46,12 @@ typedef struct mcp_await_s {
     bool completed; // have we completed the parent coroutine or not
     mcp_request_t *rq;
     mc_resp *resp; // the top level mc_resp to fill in (as if we were an iop)
+    mcp_mget_t *mget; // key layout for AWAIT_MGET
+    conn *c; // connection to queue a hedged read on
+    int await_ref; // reference to ourselves, for the hedged read
+    struct event hedge_ev; // fires once the primary is slower than its p95
+    bool hedge; // replica read not yet sent
+    bool hedge_armed; // hedge_ev is pending
 } mcp_await_t;
 
 // TODO (v2): mcplib_await_gc()
@@ -26,6 +65,9 @@ typedef struct mcp_await_s {
 int mcplib_await(lua_State *L) {
     mcp_request_t *rq = luaL_checkudata(L, 1, "mcp.request");
     luaL_checktype(L, 2, LUA_TTABLE);
+    if (rq->mget_batch) {
+        proxy_lua_error(L, "mcp.await cannot be used with batched multigets");
+    }
     int n = 0; // length of table of pools
     int wait_for = 0; // 0 means wait for all responses
     enum mcp_await_e type = AWAIT_GOOD;
@@ -49,12 +91,17 @@ int mcplib_await(lua_State *L) {
             case AWAIT_ANY:
             case AWAIT_OK:
             case AWAIT_FIRST:
+            case AWAIT_HEDGE:
                 break;
             default:
                 proxy_lua_error(L, "invalid type argument tp mcp.await");
         }
     }
 
+    if (type == AWAIT_HEDGE && n != 2) {
+        proxy_lua_error(L, "mcp.await with AWAIT_HEDGE needs a primary and a replica pool");
+    }
+
     if (lua_isnumber(L, 3)) {
         wait_for = lua_tointeger(L, 3);
         lua_pop(L, 1);
@@ -67,6 +114,11 @@ int mcplib_await(lua_State *L) {
     if (type == AWAIT_FIRST) {
         wait_for = 1;
     }
+    // HEDGE only starts with the primary; the replica is queued later.
+    if (type == AWAIT_HEDGE) {
+        wait_for = 1;
+        n = 1;
+    }
 
     // TODO (v2): quickly loop table once and ensure they're all pools?
     // TODO (v2) in case of newuserdatauv throwing an error, we need to grab
@@ -90,7 +142,26 @@ int mcplib_await(lua_State *L) {
     return lua_yield(L, 1);
 }
 
-static void mcp_queue_await_io(conn *c, lua_State *Lc, mcp_request_t *rq, int await_ref, bool await_first) {
+// pool(r) on a batched multiget. Like mcp.await(), the IO's are only
+// created once the coroutine has yielded.
+// stack: pool, request
+int mcplib_await_mget(lua_State *L, mcp_request_t *rq) {
+    int req_ref = luaL_ref(L, LUA_REGISTRYINDEX); // pops request object.
+    int argtable_ref = luaL_ref(L, LUA_REGISTRYINDEX); // pops the pool.
+
+    mcp_await_t *aw = lua_newuserdatauv(L, sizeof(mcp_await_t), 0);
+    memset(aw, 0, sizeof(mcp_await_t));
+
+    aw->argtable_ref = argtable_ref;
+    aw->rq = rq;
+    aw->req_ref = req_ref;
+    aw->type = AWAIT_MGET;
+
+    return lua_yield(L, 1);
+}
+
+// Fill in an IO from the cache and queue it on the connection.
+static io_pending_proxy_t *_await_io_queue(conn *c, lua_State *Lc, mcp_request_t *rq, io_pending_proxy_t *p, int await_ref, bool await_first) {
     io_queue_t *q = conn_io_queue_get(c, IO_QUEUE_PROXY);
 
     mcp_backend_t *be = rq->be;
@@ -105,34 +176,11 @@ static void mcp_queue_await_io(conn *c, lua_State *Lc, mcp_request_t *rq, int aw
     // the coroutine but the structure doesn't allow that yet.
     // Should also be able to settle this exact mode from the parser so we
     // don't have to re-branch here.
-    if (rq->pr.noreply) {
-        if (rq->pr.cmd_type == CMD_TYPE_META) {
-            r->mode = RESP_MODE_METAQUIET;
-            for (int x = 2; x < rq->pr.ntokens; x++) {
-                if (rq->request[rq->pr.tokens[x]] == 'q') {
-                    rq->request[rq->pr.tokens[x]] = ' ';
-                }
-            }
-        } else {
-            r->mode = RESP_MODE_NOREPLY;
-            rq->request[rq->pr.reqlen - 3] = 'Y';
-        }
-    } else {
-        r->mode = RESP_MODE_NORMAL;
-    }
-
-    r->cmd = rq->pr.command;
+    mcp_request_reply_mode(&rq->pr, rq->request, r);
 
     luaL_getmetatable(Lc, "mcp.response");
     lua_setmetatable(Lc, -2);
 
-    io_pending_proxy_t *p = do_cache_alloc(c->thread->io_cache);
-    if (p == NULL) {
-        WSTAT_INCR(c, proxy_conn_oom, 1);
-        proxy_lua_error(Lc, "out of memory allocating from IO cache");
-        return;
-    }
-
     // this is a re-cast structure, so assert that we never outsize it.
     assert(sizeof(io_pending_t) >= sizeof(io_pending_proxy_t));
     memset(p, 0, sizeof(io_pending_proxy_t));
@@ -144,6 +192,9 @@ static void mcp_queue_await_io(conn *c, lua_State *Lc, mcp_request_t *rq, int aw
     p->client_resp = r;
     p->flushed = false;
     p->ascii_multiget = rq->ascii_multiget;
+    if (c->thread->proxy_l1) {
+        proxy_l1_track(&rq->pr, r);
+    }
 
     // io_p needs to hold onto its own response reference, because we may or
     // may not include it in the final await() result.
@@ -165,14 +216,325 @@ static void mcp_queue_await_io(conn *c, lua_State *Lc, mcp_request_t *rq, int aw
     strncpy(r->be_name, be->name, MAX_NAMELEN+1);
     strncpy(r->be_port, be->port, MAX_PORTLEN+1);
 
-    mcp_request_attach(Lc, rq, p);
+    if (rq->mget_batch) {
+        // caller points the IO at its own slice of the keys.
+        p->batch = true;
+    } else {
+        mcp_request_attach(Lc, rq, p);
+    }
 
     // link into the batch chain.
     p->next = q->stack_ctx;
     q->stack_ctx = p;
     P_DEBUG("%s: queued\n", __func__);
 
-    return;
+    return p;
+}
+
+static io_pending_proxy_t *mcp_queue_await_io(conn *c, lua_State *Lc, mcp_request_t *rq, int await_ref, bool await_first) {
+    io_pending_proxy_t *p = do_cache_alloc(c->thread->io_cache);
+    if (p == NULL) {
+        WSTAT_INCR(c, proxy_conn_oom, 1);
+        proxy_lua_error(Lc, "out of memory allocating from IO cache");
+        return NULL;
+    }
+
+    return _await_io_queue(c, Lc, rq, p, await_ref, await_first);
+}
+
+// Hash each key of a multiget to its backend and queue one request per
+// backend carrying all of its keys, in the order the client sent them.
+// stack: pool
+static void mcp_await_mget_run(conn *c, lua_State *L, mcp_await_t *aw, int await_ref) {
+    mcp_pool_proxy_t *pp = luaL_checkudata(L, -1, "mcp.pool_proxy");
+    mcp_pool_t *pool = pp->main;
+    mcp_request_t *rq = aw->rq;
+    mcp_parser_t pr = rq->pr;
+    uint32_t prefix = pr.tokens[pr.keytoken]; // "get " or "gets "
+    int nkeys = 0;
+
+    while (pr.klen != 0) {
+        nkeys++;
+        _process_request_next_key(&pr);
+    }
+    int nbatch = nkeys < pool->pool_size ? nkeys : pool->pool_size;
+
+    mcp_mget_t *m = calloc(1, sizeof(mcp_mget_t) + sizeof(struct mcp_mget_batch) * nbatch);
+    int *map = malloc(sizeof(int) * pool->pool_size);
+    if (m != NULL) {
+        m->keys = calloc(nkeys, sizeof(struct mcp_mget_key));
+    }
+    if (m == NULL || map == NULL || m->keys == NULL) {
+        if (m != NULL) {
+            free(m->keys);
+        }
+        free(m);
+        free(map);
+        WSTAT_INCR(c, proxy_conn_oom, 1);
+        proxy_lua_error(L, "out of memory splitting multiget");
+        return;
+    }
+    memset(map, -1, sizeof(int) * pool->pool_size);
+    aw->mget = m;
+    m->nkeys = nkeys;
+
+    // first pass: find each key's backend and size up the batches.
+    pr = rq->pr;
+    uint32_t keyoff = prefix;
+    size_t total = 0;
+    for (int x = 0; x < nkeys; x++) {
+        uint32_t lookup = mcplib_pool_proxy_lookup(L, pool, &rq->request[keyoff], pr.klen);
+        if (map[lookup] == -1) {
+            struct mcp_mget_batch *b = &m->batch[m->nbatch];
+            b->be = pool->pool[lookup].be;
+            b->len = prefix + 2; // command and "\r\n"
+            map[lookup] = m->nbatch++;
+        }
+        struct mcp_mget_batch *b = &m->batch[map[lookup]];
+        b->len += pr.klen + (b->keys ? 1 : 0);
+        b->keys++;
+        m->keys[x].off = keyoff;
+        m->keys[x].len = pr.klen;
+        m->keys[x].batch = map[lookup];
+        total += pr.klen + 1;
+
+        keyoff = _process_request_next_key(&pr);
+    }
+    free(map);
+
+    m->cmds = malloc(total + (prefix + 2) * m->nbatch);
+    if (m->cmds == NULL) {
+        WSTAT_INCR(c, proxy_conn_oom, 1);
+        proxy_lua_error(L, "out of memory splitting multiget");
+        return;
+    }
+
+    // second pass: write out the batch requests.
+    char *cur = m->cmds;
+    for (int x = 0; x < m->nbatch; x++) {
+        struct mcp_mget_batch *b = &m->batch[x];
+        b->cmd = cur;
+        memcpy(cur, rq->request, prefix);
+        b->pos = prefix;
+        cur += b->len;
+    }
+    for (int x = 0; x < nkeys; x++) {
+        struct mcp_mget_batch *b = &m->batch[m->keys[x].batch];
+        if (b->pos != prefix) {
+            b->cmd[b->pos++] = ' ';
+        }
+        memcpy(b->cmd + b->pos, &rq->request[m->keys[x].off], m->keys[x].len);
+        b->pos += m->keys[x].len;
+    }
+
+    rq->coalesce = false;
+    for (int x = 0; x < m->nbatch; x++) {
+        struct mcp_mget_batch *b = &m->batch[x];
+        memcpy(b->cmd + b->pos, "\r\n", 2);
+        b->pos = 0;
+
+        rq->be = b->be;
+        io_pending_proxy_t *p = mcp_queue_await_io(c, L, rq, await_ref, x == 0);
+        p->iov[0].iov_base = b->cmd;
+        p->iov[0].iov_len = b->len;
+        p->iovcnt = 1;
+        p->iovbytes = b->len;
+        b->r = p->client_resp;
+    }
+    aw->pending = m->nbatch;
+
+    WSTAT_L(c->thread);
+    c->thread->stats.proxy_mget_keys += nkeys;
+    c->thread->stats.proxy_mget_batches += m->nbatch;
+    WSTAT_UL(c->thread);
+}
+
+// A backend answers a batch with the hits in the order the keys were sent,
+// so a key's value is either next in its batch's buffer or it was a miss.
+// Returns the length of the value for this key, or 0 on a miss.
+static size_t _mget_value_len(struct mcp_mget_batch *b, const char *key, size_t klen) {
+    const char *s = b->r->buf + b->pos;
+    size_t remain = b->r->blen - b->pos;
+
+    if (remain < 7 + klen || memcmp(s, "VALUE ", 6) != 0
+            || memcmp(s + 6, key, klen) != 0 || s[6 + klen] != ' ') {
+        return 0;
+    }
+    const char *el = memchr(s, '\n', remain);
+    if (el == NULL) {
+        return 0;
+    }
+
+    // VALUE <key> <flags> <bytes> [<cas unique>]
+    const char *flags = s + 7 + klen;
+    const char *bytes = memchr(flags, ' ', el - flags);
+    if (bytes == NULL) {
+        return 0;
+    }
+    size_t len = (el + 1 - s) + strtoul(bytes + 1, NULL, 10) + 2;
+
+    return len <= remain ? len : 0;
+}
+
+// Put the batches back together in the order the client asked for the keys,
+// and push the result as an mcp.response.
+static void mcp_await_mget_merge(lua_State *L, mcp_await_t *aw) {
+    mcp_mget_t *m = aw->mget;
+    const char *request = aw->rq->request;
+    size_t total = ENDLEN;
+
+    for (int x = 0; x < m->nbatch; x++) {
+        struct mcp_mget_batch *b = &m->batch[x];
+        if (b->r->status == MCMC_OK && b->r->resp.type == MCMC_RESP_END) {
+            total += b->r->blen;
+        } else {
+            b->r = NULL;
+            total += MGET_ERRLEN * b->keys;
+        }
+    }
+
+    mcp_resp_t *r = lua_newuserdatauv(L, sizeof(mcp_resp_t), 1);
+    memset(r, 0, sizeof(mcp_resp_t));
+    luaL_getmetatable(L, "mcp.response");
+    lua_setmetatable(L, -2);
+    r->cmd = aw->rq->pr.command;
+    r->mode = RESP_MODE_NORMAL;
+
+    r->buf = malloc(total);
+    if (r->buf == NULL) {
+        r->status = MCMC_ERR;
+        return;
+    }
+
+    char *cur = r->buf;
+    for (int x = 0; x < m->nkeys; x++) {
+        struct mcp_mget_key *k = &m->keys[x];
+        struct mcp_mget_batch *b = &m->batch[k->batch];
+        if (b->r == NULL) {
+            memcpy(cur, MGET_ERRSTR, MGET_ERRLEN);
+            cur += MGET_ERRLEN;
+            continue;
+        }
+
+        size_t len = _mget_value_len(b, &request[k->off], k->len);
+        if (len != 0) {
+            memcpy(cur, b->r->buf + b->pos, len);
+            cur += len;
+            b->pos += len;
+        }
+    }
+    memcpy(cur, ENDSTR, ENDLEN);
+    cur += ENDLEN;
+
+    r->blen = cur - r->buf;
+    r->status = MCMC_OK;
+    r->resp.type = MCMC_RESP_END;
+}
+
+static void mcp_await_mget_free(mcp_mget_t *m) {
+    if (m == NULL) {
+        return;
+    }
+    free(m->cmds);
+    free(m->keys);
+    free(m);
+}
+
+// Point rq at the backend for its key in pool idx of the argument table.
+// stack: argtable
+static mcp_backend_t *_await_hedge_pool(lua_State *L, mcp_request_t *rq, int idx) {
+    lua_rawgeti(L, -1, idx);
+    mcp_pool_proxy_t *pp = luaL_testudata(L, -1, "mcp.pool_proxy");
+    if (pp == NULL) {
+        proxy_lua_error(L, "mcp.await must be supplied with a pool");
+    }
+    mcp_pool_t *p = pp->main;
+    rq->be = mcplib_pool_proxy_call_helper(L, p, MCP_PARSER_KEY(rq->pr), rq->pr.klen);
+    rq->coalesce = p->coalesce;
+    rq->coalesce_stat = p->coalesce_stat;
+    lua_pop(L, 1);
+
+    return rq->be;
+}
+
+// Runs from the hedge timer or while returning an IO, neither of which is
+// under lua_pcall(), so failures here must not raise a lua error.
+static void mcp_await_hedge_send(mcp_await_t *aw) {
+    conn *c = aw->c;
+    lua_State *L = c->thread->L;
+    io_queue_t *q = conn_io_queue_get(c, IO_QUEUE_PROXY);
+
+    aw->hedge = false;
+    io_pending_proxy_t *p = do_cache_alloc(c->thread->io_cache);
+    if (p == NULL) {
+        // the hedge is optional: leave the primary to answer on its own.
+        WSTAT_INCR(c, proxy_conn_oom, 1);
+        return;
+    }
+    aw->pending++;
+
+    // submit only the hedge. anything else queued on the connection goes out
+    // when the connection next runs.
+    void *queued = q->stack_ctx;
+    q->stack_ctx = NULL;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, aw->argtable_ref);
+    _await_hedge_pool(L, aw->rq, 2);
+    lua_pop(L, 1);
+    // not the first IO, so it doesn't hold up the connection.
+    _await_io_queue(c, L, aw->rq, p, aw->await_ref, false);
+    proxy_submit_cb(q);
+    q->stack_ctx = queued;
+
+    WSTAT_INCR(c, proxy_hedge_sent, 1);
+}
+
+static void mcp_await_hedge_timer(evutil_socket_t fd, short which, void *arg) {
+    mcp_await_t *aw = arg;
+    LIBEVENT_THREAD *t = aw->c->thread;
+
+    aw->hedge_armed = false;
+    if (t->proxy_hedge_credit < HEDGE_COST) {
+        // still send it if the primary fails outright.
+        WSTAT_INCR(aw->c, proxy_hedge_denied, 1);
+        return;
+    }
+    t->proxy_hedge_credit -= HEDGE_COST;
+    mcp_await_hedge_send(aw);
+}
+
+// Send to the primary pool, and if the backend isn't back within its usual
+// p95, send the same read to the replica pool too.
+// stack: argtable
+static void mcp_await_hedge_run(conn *c, lua_State *L, mcp_await_t *aw, int await_ref) {
+    mcp_request_t *rq = aw->rq;
+    LIBEVENT_THREAD *t = c->thread;
+
+    mcp_backend_t *be = _await_hedge_pool(L, rq, 1);
+    mcp_queue_await_io(c, L, rq, await_ref, true);
+
+    // only duplicate requests that are safe to run twice.
+    if (!mcp_request_plain_read(&rq->pr)) {
+        return;
+    }
+    aw->c = c;
+    aw->await_ref = await_ref;
+    aw->hedge = true;
+
+    t->proxy_hedge_credit += t->proxy_hedge_budget;
+    if (t->proxy_hedge_credit > HEDGE_CREDIT_MAX) {
+        t->proxy_hedge_credit = HEDGE_CREDIT_MAX;
+    }
+
+    // without any samples yet we only fall back to the replica on errors.
+    uint32_t delay = __atomic_load_n(&be->lat_p95_us, __ATOMIC_RELAXED);
+    if (delay == 0) {
+        return;
+    }
+    struct timeval tv = {.tv_sec = delay / 1000000, .tv_usec = delay % 1000000};
+    evtimer_set(&aw->hedge_ev, mcp_await_hedge_timer, aw);
+    event_base_set(t->base, &aw->hedge_ev);
+    evtimer_add(&aw->hedge_ev, &tv);
+    aw->hedge_armed = true;
 }
 
 // TODO (v2): need to get this code running under pcall().
@@ -193,6 +555,21 @@ int mcplib_await_run(conn *c, mc_resp *resp, lua_State *L, int coro_ref) {
     lua_newtable(L); // -> 2
     aw->restable_ref = luaL_ref(L, LUA_REGISTRYINDEX); // pop the result table
 
+    if (aw->type == AWAIT_MGET) {
+        // argtable is the pool itself.
+        mcp_await_mget_run(c, L, aw, await_ref);
+        lua_pop(L, 1);
+        aw->resp = resp;
+        return 0;
+    }
+
+    if (aw->type == AWAIT_HEDGE) {
+        mcp_await_hedge_run(c, L, aw, await_ref);
+        lua_pop(L, 1);
+        aw->resp = resp;
+        return 0;
+    }
+
     // prepare the request key
     const char *key = MCP_PARSER_KEY(rq->pr);
     size_t len = rq->pr.klen;
@@ -212,6 +589,8 @@ int mcplib_await_run(conn *c, mc_resp *resp, lua_State *L, int coro_ref) {
         // NOTE: rq->be is only held to help pass the backend into the IOP in
         // mcp_queue call. Could be a local variable and an argument too.
         rq->be = mcplib_pool_proxy_call_helper(L, p, key, len);
+        rq->coalesce = p->coalesce;
+        rq->coalesce_stat = p->coalesce_stat;
 
         mcp_queue_await_io(c, L, rq, await_ref, await_first);
         await_first = false;
@@ -250,6 +629,16 @@ int mcplib_await_return(io_pending_proxy_t *p) {
     P_DEBUG("%s: start [pending: %d]\n", __func__, aw->pending);
     //dump_stack(L);
 
+    // the primary failed before we hedged: go to the replica right away.
+    // this is a retry rather than extra load, so skip the budget.
+    if (aw->hedge && !aw->completed && p->client_resp->status != MCMC_OK) {
+        if (aw->hedge_armed) {
+            evtimer_del(&aw->hedge_ev);
+            aw->hedge_armed = false;
+        }
+        mcp_await_hedge_send(aw);
+    }
+
     aw->pending--;
     assert(aw->pending >= 0);
     // Await not yet satisfied.
@@ -286,6 +675,14 @@ int mcplib_await_return(io_pending_proxy_t *p) {
                         valid = false;
                     }
                     break;
+                case AWAIT_HEDGE:
+                    if (p->client_resp->status == MCMC_OK) {
+                        is_good = true;
+                    }
+                    break;
+                case AWAIT_MGET:
+                    // waits for every batch, never a count.
+                    break;
             }
 
             if (is_good) {
@@ -330,12 +727,23 @@ int mcplib_await_return(io_pending_proxy_t *p) {
         P_DEBUG("%s: completing\n", __func__);
         assert(p->c->thread == p->thread);
         aw->completed = true;
+        if (aw->hedge_armed) {
+            evtimer_del(&aw->hedge_ev);
+            aw->hedge_armed = false;
+        }
+        if (aw->type == AWAIT_HEDGE && !p->await_first) {
+            WSTAT_INCR(p->c, proxy_hedge_wins, 1);
+        }
         // if we haven't completed yet, the connection reference is still
         // valid. So now we pull it, reduce count, and readd if necessary.
         // here is also the point where we resume the coroutine.
         lua_rawgeti(L, LUA_REGISTRYINDEX, aw->coro_ref);
         lua_State *Lc = lua_tothread(L, -1);
-        lua_rawgeti(Lc, LUA_REGISTRYINDEX, aw->restable_ref); // -> 1
+        if (aw->type == AWAIT_MGET) {
+            mcp_await_mget_merge(Lc, aw); // -> 1
+        } else {
+            lua_rawgeti(Lc, LUA_REGISTRYINDEX, aw->restable_ref); // -> 1
+        }
         proxy_run_coroutine(Lc, aw->resp, NULL, p->c);
         luaL_unref(L, LUA_REGISTRYINDEX, aw->coro_ref);
         luaL_unref(L, LUA_REGISTRYINDEX, aw->restable_ref);
@@ -353,6 +761,8 @@ int mcplib_await_return(io_pending_proxy_t *p) {
         P_DEBUG("%s: cleanup [completed: %d]\n", __func__, aw->completed);
         luaL_unref(L, LUA_REGISTRYINDEX, aw->argtable_ref);
         luaL_unref(L, LUA_REGISTRYINDEX, aw->req_ref);
+        mcp_await_mget_free(aw->mget);
+        aw->mget = NULL;
         luaL_unref(L, LUA_REGISTRYINDEX, p->await_ref);
     }
 
@@ -416,9 +416,151 @@ int proxy_thread_loadconf(LIBEVENT_THREAD *thr) {
         tus->num_stats = us->num_stats;
         pthread_mutex_unlock(&thr->stats.mutex);
     }
+    thr->proxy_batch_multiget = ctx->tunables.batch_multiget;
+    thr->proxy_hedge_budget = ctx->tunables.hedge_budget;
     STAT_UL(ctx);
 
+    proxy_l1_configure(thr);
+
     return 0;
 }
 
 
+
+/*** START route tables ***/
+
+// A route is a pool, a { pool, failover } pair, or a lua function for routes
+// that need scripting. The value is on top of the stack.
+static void _route_entry(lua_State *L, struct mcp_route_entry *e) {
+    if (lua_isfunction(L, -1)) {
+        lua_pushvalue(L, -1);
+        e->func_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+        return;
+    }
+
+    mcp_pool_proxy_t *pp = luaL_testudata(L, -1, "mcp.pool_proxy");
+    if (pp != NULL) {
+        e->pool = pp->main;
+        return;
+    }
+
+    if (lua_istable(L, -1)) {
+        lua_rawgeti(L, -1, 1);
+        lua_rawgeti(L, -2, 2);
+        pp = luaL_testudata(L, -2, "mcp.pool_proxy");
+        mcp_pool_proxy_t *fp = luaL_testudata(L, -1, "mcp.pool_proxy");
+        lua_pop(L, 2);
+        if (pp != NULL && fp != NULL) {
+            e->pool = pp->main;
+            e->failover = fp->main;
+            return;
+        }
+    }
+
+    proxy_lua_error(L, "mcp.route_table: routes must be a pool, { pool, failover_pool } or a function");
+}
+
+static int _route_cmp(const void *a, const void *b) {
+    const struct mcp_route_entry *ea = a;
+    const struct mcp_route_entry *eb = b;
+    return (eb->plen > ea->plen) - (eb->plen < ea->plen);
+}
+
+// mcp.route_table({ ["prefix"] = route, ... }, [default_route])
+// Requests whose key starts with a prefix routed to a pool are hashed and
+// sent to it from C, without running lua. The table and default are held as
+// uservalues, which keeps their pools alive.
+int mcplib_route_table(lua_State *L) {
+    luaL_checktype(L, 1, LUA_TTABLE);
+    bool has_default = !lua_isnoneornil(L, 2);
+    size_t prefix_bytes = 0;
+    int count = 0;
+
+    lua_pushnil(L);
+    while (lua_next(L, 1) != 0) {
+        size_t len = 0;
+        if (lua_type(L, -2) != LUA_TSTRING) {
+            proxy_lua_error(L, "mcp.route_table: prefixes must be strings");
+            return 0;
+        }
+        lua_tolstring(L, -2, &len);
+        if (len == 0 || len > KEY_MAX_LENGTH) {
+            proxy_lua_error(L, "mcp.route_table: bad prefix length");
+            return 0;
+        }
+        prefix_bytes += len;
+        count++;
+        lua_pop(L, 1);
+    }
+
+    size_t size = sizeof(mcp_route_t) + sizeof(struct mcp_route_entry) * count;
+    mcp_route_t *rt = lua_newuserdatauv(L, size + prefix_bytes, 2);
+    memset(rt, 0, size);
+    luaL_getmetatable(L, "mcp.route_table");
+    lua_setmetatable(L, -2);
+
+    lua_pushvalue(L, 1);
+    lua_setiuservalue(L, -2, 1);
+    if (has_default) {
+        lua_pushvalue(L, 2);
+        lua_setiuservalue(L, -2, 2);
+    }
+
+    char *prefix = (char *)rt + size;
+    lua_pushnil(L);
+    while (lua_next(L, 1) != 0) {
+        struct mcp_route_entry *e = &rt->entries[rt->count++];
+        const char *p = lua_tolstring(L, -2, &e->plen);
+        memcpy(prefix, p, e->plen);
+        e->prefix = prefix;
+        prefix += e->plen;
+        _route_entry(L, e);
+        lua_pop(L, 1);
+    }
+    // longest prefix wins.
+    qsort(rt->entries, rt->count, sizeof(struct mcp_route_entry), _route_cmp);
+
+    if (has_default) {
+        lua_pushvalue(L, 2);
+        _route_entry(L, &rt->def);
+        lua_pop(L, 1);
+    }
+
+    return 1;
+}
+
+int mcplib_route_table_gc(lua_State *L) {
+    mcp_route_t *rt = luaL_checkudata(L, -1, "mcp.route_table");
+
+    for (int x = 0; x < rt->count; x++) {
+        if (rt->entries[x].func_ref) {
+            luaL_unref(L, LUA_REGISTRYINDEX, rt->entries[x].func_ref);
+        }
+    }
+    if (rt->def.func_ref) {
+        luaL_unref(L, LUA_REGISTRYINDEX, rt->def.func_ref);
+    }
+
+    return 0;
+}
+
+// Returns the route for a request, or NULL if nothing matches.
+struct mcp_route_entry *mcp_route_lookup(mcp_route_t *rt, mcp_parser_t *pr) {
+    if (pr->keytoken) {
+        const char *key = &pr->request[pr->tokens[pr->keytoken]];
+        for (int x = 0; x < rt->count; x++) {
+            struct mcp_route_entry *e = &rt->entries[x];
+            if (e->plen <= pr->klen && memcmp(e->prefix, key, e->plen) == 0) {
+                return e;
+            }
+        }
+    }
+
+    if (rt->def.pool != NULL || rt->def.func_ref) {
+        return &rt->def;
+    }
+
+    return NULL;
+}
+
+/*** END route tables ***/
@@ -0,0 +1,471 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+// Near-cache ("L1") for hot keys.
+//
+// Each worker thread owns a small set-associative table, so lookups take no
+// locks. Entries are only admitted if a count-min sketch says the key is
+// requested more often than whatever it would evict, which keeps one-off
+// keys from churning the table.
+//
+// Writes and deletes routed through the proxy stamp a table of key hash
+// slots shared by all threads; an entry fetched before its slot was last
+// stamped is treated as stale. A write stamps its slot when it arrives and
+// again when the backend answers it, so a read that raced the write and
+// fetched the old value can't outlive the write's reply. Writes that land on
+// a backend by other means are only bounded by the (short) TTL.
+
+#include "proxy.h"
+
+#define L1_WAYS 4
+#define L1_SKETCH_ROWS 4
+#define L1_COUNT_MAX 15
+
+struct l1_entry {
+    uint64_t hv; // key hash.
+    uint64_t born; // start time of the request that fetched this.
+    uint64_t expires;
+    char *data; // request line followed by the response.
+    size_t blen; // length of the response.
+    mcmc_resp_t resp;
+    uint32_t reqlen;
+    bool ascii_multiget;
+};
+
+struct proxy_l1 {
+    struct l1_entry *table;
+    uint32_t mask; // number of buckets - 1
+    int items;
+    int max_value;
+    int ttl;
+    uint8_t *sketch; // L1_SKETCH_ROWS rows of saturating counters.
+    uint32_t sketch_mask;
+    uint32_t sketch_adds;
+    uint32_t sketch_reset; // age the sketch after this many adds.
+};
+
+// Times here are monotonic ms, so a wall clock step can't make a write look
+// older than a read that raced it.
+uint64_t proxy_l1_now(void) {
+    return thread_clock_ns() / 1000000;
+}
+
+static inline uint64_t _l1_hash(mcp_request_t *rq) {
+    return XXH3_64bits(MCP_PARSER_KEY(rq->pr), rq->pr.klen);
+}
+
+static inline uint32_t _sketch_slot(struct proxy_l1 *l1, uint64_t hv, int row) {
+    uint32_t h1 = hv;
+    uint32_t h2 = (hv >> 32) | 1;
+    return row * (l1->sketch_mask + 1) + ((h1 + row * h2) & l1->sketch_mask);
+}
+
+static int _sketch_estimate(struct proxy_l1 *l1, uint64_t hv) {
+    int est = L1_COUNT_MAX;
+    for (int x = 0; x < L1_SKETCH_ROWS; x++) {
+        int c = l1->sketch[_sketch_slot(l1, hv, x)];
+        if (c < est) {
+            est = c;
+        }
+    }
+    return est;
+}
+
+static void _sketch_add(struct proxy_l1 *l1, uint64_t hv) {
+    for (int x = 0; x < L1_SKETCH_ROWS; x++) {
+        uint8_t *c = &l1->sketch[_sketch_slot(l1, hv, x)];
+        if (*c < L1_COUNT_MAX) {
+            (*c)++;
+        }
+    }
+
+    // halve everything now and then so old hot keys fade out.
+    if (++l1->sketch_adds >= l1->sketch_reset) {
+        size_t len = (size_t)(l1->sketch_mask + 1) * L1_SKETCH_ROWS;
+        for (size_t x = 0; x < len; x++) {
+            l1->sketch[x] >>= 1;
+        }
+        l1->sketch_adds /= 2;
+    }
+}
+
+static bool _l1_stale(proxy_ctx_t *ctx, uint64_t hv, uint64_t born) {
+    uint64_t written = __atomic_load_n(&ctx->l1_inval[hv & (L1_INVAL_SLOTS - 1)], __ATOMIC_RELAXED);
+    uint64_t flushed = __atomic_load_n(&ctx->l1_flushed, __ATOMIC_RELAXED);
+    return born <= written || born <= flushed;
+}
+
+static void _l1_stamp(uint64_t *slot, uint64_t now) {
+    uint64_t old = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (old < now && !__atomic_compare_exchange_n(slot, &old, now, false,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void _l1_entry_free(struct l1_entry *e) {
+    free(e->data);
+    memset(e, 0, sizeof(*e));
+}
+
+static void _l1_free(struct proxy_l1 *l1) {
+    if (l1 == NULL) {
+        return;
+    }
+    for (uint32_t x = 0; x < (l1->mask + 1) * L1_WAYS; x++) {
+        free(l1->table[x].data);
+    }
+    free(l1->table);
+    free(l1->sketch);
+    free(l1);
+}
+
+// Only plain reads that go out to the backend exactly as the client sent
+// them are cached. noreply would have the request rewritten under us.
+// Batched multigets are skipped since invalidation only sees the first key.
+static bool _l1_cacheable(mcp_request_t *rq) {
+    return rq->pr.keytoken && !rq->pr.noreply && !rq->was_modified
+        && !rq->mget_batch && mcp_request_plain_read(&rq->pr);
+}
+
+static struct l1_entry *_l1_find(struct proxy_l1 *l1, mcp_request_t *rq, uint64_t hv) {
+    struct l1_entry *bucket = &l1->table[(hv & l1->mask) * L1_WAYS];
+    for (int x = 0; x < L1_WAYS; x++) {
+        struct l1_entry *e = &bucket[x];
+        if (e->data != NULL && e->hv == hv && e->reqlen == rq->pr.reqlen
+                && e->ascii_multiget == rq->ascii_multiget
+                && memcmp(e->data, rq->request, e->reqlen) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Called by each worker after loading a config, since that's the only time
+// the sizing can change.
+void proxy_l1_configure(LIBEVENT_THREAD *thr) {
+    proxy_ctx_t *ctx = settings.proxy_ctx;
+    struct proxy_l1 *l1 = thr->proxy_l1;
+
+    STAT_L(ctx);
+    int items = ctx->tunables.l1_items;
+    int max_value = ctx->tunables.l1_max_value;
+    int ttl = ctx->tunables.l1_ttl;
+    STAT_UL(ctx);
+
+    if (l1 != NULL && l1->items == items) {
+        l1->max_value = max_value;
+        l1->ttl = ttl;
+        return;
+    }
+
+    _l1_free(l1);
+    thr->proxy_l1 = NULL;
+    if (items == 0) {
+        return;
+    }
+
+    l1 = calloc(1, sizeof(struct proxy_l1));
+    if (l1 == NULL) {
+        fprintf(stderr, "Failed to allocate proxy near-cache\n");
+        return;
+    }
+    uint32_t buckets = 1;
+    while (buckets * L1_WAYS < items) {
+        buckets <<= 1;
+    }
+    uint32_t width = 64;
+    while (width < buckets * L1_WAYS * 2) {
+        width <<= 1;
+    }
+    l1->table = calloc(buckets * L1_WAYS, sizeof(struct l1_entry));
+    l1->sketch = calloc(width, L1_SKETCH_ROWS);
+    if (l1->table == NULL || l1->sketch == NULL) {
+        fprintf(stderr, "Failed to allocate proxy near-cache\n");
+        _l1_free(l1);
+        return;
+    }
+    l1->mask = buckets - 1;
+    l1->sketch_mask = width - 1;
+    l1->sketch_reset = width * 8;
+    l1->items = items;
+    l1->max_value = max_value;
+    l1->ttl = ttl;
+
+    thr->proxy_l1 = l1;
+}
+
+// Which slot a request writes to, if any.
+static int _l1_write_slot(mcp_parser_t *pr, uint64_t *hv) {
+    switch (pr->command) {
+        case CMD_SET:
+        case CMD_ADD:
+        case CMD_CAS:
+        case CMD_REPLACE:
+        case CMD_APPEND:
+        case CMD_PREPEND:
+        case CMD_INCR:
+        case CMD_DECR:
+        case CMD_DELETE:
+        case CMD_MS:
+        case CMD_MD:
+        case CMD_MA:
+            if (pr->keytoken) {
+                *hv = XXH3_64bits(&pr->request[pr->tokens[pr->keytoken]], pr->klen);
+                return L1_WRITE_KEY;
+            }
+            return L1_WRITE_NONE;
+        case CMD_FLUSH_ALL:
+            return L1_WRITE_FLUSH;
+        default:
+            return L1_WRITE_NONE;
+    }
+}
+
+static void _l1_written(proxy_ctx_t *ctx, int write, uint64_t hv, uint64_t now) {
+    if (write == L1_WRITE_KEY) {
+        _l1_stamp(&ctx->l1_inval[hv & (L1_INVAL_SLOTS - 1)], now);
+    } else if (write == L1_WRITE_FLUSH) {
+        _l1_stamp(&ctx->l1_flushed, now);
+    }
+}
+
+// Called for every request with a route, before the route runs.
+void proxy_l1_invalidate(proxy_ctx_t *ctx, mcp_parser_t *pr, uint64_t start) {
+    uint64_t hv = 0;
+    // hv is only set by _l1_write_slot().
+    int write = _l1_write_slot(pr, &hv);
+    _l1_written(ctx, write, hv, start);
+}
+
+// Called as a request is queued to a backend.
+void proxy_l1_track(mcp_parser_t *pr, mcp_resp_t *r) {
+    r->l1_write = _l1_write_slot(pr, &r->l1_hv);
+}
+
+// Called on the worker thread once the backend has answered (or failed) a
+// request, before the answer can reach the client. Until then the write may
+// not have been applied, so reads from before now are stale.
+void proxy_l1_written(proxy_ctx_t *ctx, mcp_resp_t *r) {
+    if (r->l1_write != L1_WRITE_NONE) {
+        _l1_written(ctx, r->l1_write, r->l1_hv, proxy_l1_now());
+    }
+}
+
+// mcp.l1_size(items, [max_value])
+// near-cache entries per worker thread; 0 (the default) disables it.
+int mcplib_l1_size(lua_State *L) {
+    int items = luaL_checkinteger(L, 1);
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+
+    if (items < 0) {
+        proxy_lua_error(L, "l1_size must be >= 0");
+        return 0;
+    }
+
+    STAT_L(ctx);
+    int max_value = luaL_optinteger(L, 2, ctx->tunables.l1_max_value);
+    if (max_value < 1) {
+        STAT_UL(ctx);
+        proxy_lua_error(L, "l1_size max_value must be > 0");
+        return 0;
+    }
+    ctx->tunables.l1_items = items;
+    ctx->tunables.l1_max_value = max_value;
+    STAT_UL(ctx);
+
+    return 0;
+}
+
+// mcp.l1_ttl(seconds)
+int mcplib_l1_ttl(lua_State *L) {
+    lua_Number secondsf = luaL_checknumber(L, 1);
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+
+    if (secondsf < 0.001) {
+        proxy_lua_error(L, "l1_ttl must be at least a millisecond");
+        return 0;
+    }
+
+    STAT_L(ctx);
+    ctx->tunables.l1_ttl = secondsf * 1000 + 0.5;
+    STAT_UL(ctx);
+
+    return 0;
+}
+
+// res = mcp.l1_get(r)
+// returns a response for the request if the near-cache has a fresh one,
+// otherwise nil. Also counts the key as requested for admission purposes.
+int mcplib_l1_get(lua_State *L) {
+    LIBEVENT_THREAD *t = lua_touserdata(L, lua_upvalueindex(MCP_THREAD_UPVALUE));
+    if (t == NULL) {
+        proxy_lua_error(L, "l1_get must be called from router handlers");
+        return 0;
+    }
+    mcp_request_t *rq = luaL_checkudata(L, 1, "mcp.request");
+    struct proxy_l1 *l1 = t->proxy_l1;
+
+    if (l1 == NULL || !_l1_cacheable(rq)) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    uint64_t hv = _l1_hash(rq);
+    _sketch_add(l1, hv);
+
+    struct l1_entry *e = _l1_find(l1, rq, hv);
+    if (e != NULL && (e->expires <= rq->l1_start
+                || _l1_stale(settings.proxy_ctx, hv, e->born))) {
+        _l1_entry_free(e);
+        e = NULL;
+    }
+
+    char *buf = NULL;
+    if (e != NULL) {
+        buf = malloc(e->blen);
+    }
+    if (buf == NULL) {
+        WSTAT_L(t);
+        t->stats.proxy_l1_misses++;
+        WSTAT_UL(t);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    mcp_resp_t *r = lua_newuserdatauv(L, sizeof(mcp_resp_t), 1);
+    memset(r, 0, sizeof(mcp_resp_t));
+    memcpy(buf, e->data + e->reqlen, e->blen);
+    r->buf = buf;
+    r->blen = e->blen;
+    r->bread = e->blen;
+    r->resp = e->resp;
+    mcp_resp_rebase(&r->resp, e->data + e->reqlen, e->blen, r->buf);
+    r->status = MCMC_OK;
+    r->cmd = rq->pr.command;
+    r->mode = RESP_MODE_NORMAL;
+    luaL_getmetatable(L, "mcp.response");
+    lua_setmetatable(L, -2);
+
+    WSTAT_L(t);
+    t->stats.proxy_l1_hits++;
+    WSTAT_UL(t);
+
+    return 1;
+}
+
+// mcp.l1_set(r, res, [ttl])
+// offers a backend response to the near-cache. Only hits are kept, and only
+// if the key is requested more often than the entry it would displace.
+// ttl (seconds) can shorten but not extend mcp.l1_ttl().
+// returns true if the response was stored.
+int mcplib_l1_set(lua_State *L) {
+    LIBEVENT_THREAD *t = lua_touserdata(L, lua_upvalueindex(MCP_THREAD_UPVALUE));
+    if (t == NULL) {
+        proxy_lua_error(L, "l1_set must be called from router handlers");
+        return 0;
+    }
+    mcp_request_t *rq = luaL_checkudata(L, 1, "mcp.request");
+    mcp_resp_t *r = luaL_checkudata(L, 2, "mcp.response");
+    struct proxy_l1 *l1 = t->proxy_l1;
+
+    if (l1 == NULL || !_l1_cacheable(rq) || r->cmd != rq->pr.command
+            || r->status != MCMC_OK || r->resp.code == MCMC_CODE_MISS
+            || (r->resp.type != MCMC_RESP_GET && r->resp.type != MCMC_RESP_META)
+            || r->buf == NULL || r->blen > l1->max_value) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    int ttl = l1->ttl;
+    if (lua_gettop(L) > 2) {
+        lua_Number secondsf = luaL_checknumber(L, 3);
+        if (secondsf * 1000 < ttl) {
+            ttl = secondsf * 1000;
+        }
+    }
+
+    uint64_t hv = _l1_hash(rq);
+    uint64_t born = rq->l1_start;
+    // written to since this request went out.
+    if (ttl <= 0 || _l1_stale(settings.proxy_ctx, hv, born)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    struct l1_entry *e = _l1_find(l1, rq, hv);
+    if (e == NULL) {
+        struct l1_entry *bucket = &l1->table[(hv & l1->mask) * L1_WAYS];
+        int vfreq = L1_COUNT_MAX + 1;
+        for (int x = 0; x < L1_WAYS; x++) {
+            struct l1_entry *v = &bucket[x];
+            if (v->data == NULL || v->expires <= born) {
+                e = v;
+                break;
+            }
+            int freq = _sketch_estimate(l1, v->hv);
+            if (freq < vfreq) {
+                vfreq = freq;
+                e = v;
+            }
+        }
+
+        if (e->data != NULL && e->expires > born
+                && _sketch_estimate(l1, hv) <= vfreq) {
+            WSTAT_L(t);
+            t->stats.proxy_l1_rejects++;
+            WSTAT_UL(t);
+            lua_pushboolean(L, 0);
+            return 1;
+        }
+    }
+
+    char *data = malloc(rq->pr.reqlen + r->blen);
+    if (data == NULL) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+    _l1_entry_free(e);
+
+    memcpy(data, rq->request, rq->pr.reqlen);
+    memcpy(data + rq->pr.reqlen, r->buf, r->blen);
+    e->hv = hv;
+    e->born = born;
+    e->expires = born + ttl;
+    e->data = data;
+    e->reqlen = rq->pr.reqlen;
+    e->blen = r->blen;
+    e->ascii_multiget = rq->ascii_multiget;
+    e->resp = r->resp;
+    mcp_resp_rebase(&e->resp, r->buf, r->blen, data + rq->pr.reqlen);
+
+    WSTAT_L(t);
+    t->stats.proxy_l1_admits++;
+    WSTAT_UL(t);
+
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// mcp.l1_invalidate(key|r)
+// drop a key from every worker's near-cache, for writes that don't pass
+// through a route.
+int mcplib_l1_invalidate(lua_State *L) {
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+    const char *key = NULL;
+    size_t len = 0;
+
+    mcp_request_t *rq = luaL_testudata(L, 1, "mcp.request");
+    if (rq != NULL) {
+        if (!rq->pr.keytoken) {
+            proxy_lua_error(L, "l1_invalidate: request has no key");
+            return 0;
+        }
+        key = MCP_PARSER_KEY(rq->pr);
+        len = rq->pr.klen;
+    } else {
+        key = luaL_checklstring(L, 1, &len);
+    }
+
+    uint64_t hv = XXH3_64bits(key, len);
+    _l1_stamp(&ctx->l1_inval[hv & (L1_INVAL_SLOTS - 1)], proxy_l1_now());
+
+    return 0;
+}
@@ -79,6 +79,9 @@ static int mcplib_response_gc(lua_State *L) {
     if (r->buf != NULL) {
         free(r->buf);
     }
+    if (r->mbuf != NULL) {
+        free(r->mbuf);
+    }
 
     return 0;
 }
@@ -90,21 +93,77 @@ static int mcplib_response_gc(lua_State *L) {
 // To free a backend: All proxies for a pool are collected, then the central
 // pool is collected, which releases backend references, which allows backend
 // to be collected.
+static void _mcplib_backend_conn_free(mcp_backend_t *be) {
+    assert(STAILQ_EMPTY(&be->io_head));
+
+    if (be->client) {
+        mcmc_disconnect(be->client);
+        free(be->client);
+    }
+    free(be->rbuf);
+}
+
 static int mcplib_backend_gc(lua_State *L) {
     mcp_backend_t *be = luaL_checkudata(L, -1, "mcp.backend");
 
-    assert(STAILQ_EMPTY(&be->io_head));
-
-    mcmc_disconnect(be->client);
-    free(be->client);
+    _mcplib_backend_conn_free(be);
+    for (int x = 0; x < be->conncount; x++) {
+        _mcplib_backend_conn_free(&be->conns[x]);
+    }
+    free(be->conns);
 
     // FIXME (v2): upvalue for global ctx.
     proxy_ctx_t *ctx = settings.proxy_ctx;
-    STAT_DECR(ctx, backend_total, 1);
+    STAT_L(ctx);
+    if (be->listed) {
+        STAILQ_REMOVE(&ctx->be_all, be, mcp_backend_s, be_all_next);
+        ctx->global_stats.backend_total--;
+    }
+    STAT_UL(ctx);
 
     return 0;
 }
 
+// Sets up one socket's worth of a backend: read buffer, client, and a
+// non-blocking connect. Returns an error string on failure.
+static const char *_mcplib_backend_conn(mcp_backend_t *be, int flags) {
+    STAILQ_INIT(&be->io_head);
+    be->state = mcp_backend_read;
+    be->connecting = false;
+    be->can_write = false;
+    be->stacked = false;
+    be->bad = false;
+
+    // this leaves a permanent buffer on the backend, which is fine
+    // unless you have billions of backends.
+    // we can later optimize for pulling buffers from idle backends.
+    be->rbuf = malloc(READ_BUFFER_SIZE);
+    if (be->rbuf == NULL) {
+        return "out of memory allocating backend";
+    }
+
+    // initialize the client
+    be->client = malloc(mcmc_size(MCMC_OPTION_BLANK));
+    if (be->client == NULL) {
+        return "out of memory allocating backend";
+    }
+
+    be->connect_flags = flags;
+    int status = mcmc_connect(be->client, be->name, be->port, flags);
+    if (status == MCMC_CONNECTED) {
+        // FIXME (v2): is this possible? do we ever want to allow blocking
+        // connections?
+        return "unexpectedly connected to backend early";
+    } else if (status == MCMC_CONNECTING) {
+        be->connecting = true;
+        be->can_write = false;
+    } else {
+        return "failed to connect to backend";
+    }
+
+    return NULL;
+}
+
 static int mcplib_backend(lua_State *L) {
     luaL_checkstring(L, -3); // label for indexing backends.
     size_t nlen = 0;
@@ -142,34 +201,12 @@ static int mcplib_backend(lua_State *L) {
     memset(be, 0, sizeof(mcp_backend_t));
     strncpy(be->name, name, MAX_NAMELEN);
     strncpy(be->port, port, MAX_PORTLEN);
-    be->depth = 0;
-    be->rbufused = 0;
-    be->failed_count = 0;
-    STAILQ_INIT(&be->io_head);
-    be->state = mcp_backend_read;
-    be->connecting = false;
-    be->can_write = false;
-    be->stacked = false;
-    be->bad = false;
-
-    // this leaves a permanent buffer on the backend, which is fine
-    // unless you have billions of backends.
-    // we can later optimize for pulling buffers from idle backends.
-    be->rbuf = malloc(READ_BUFFER_SIZE);
-    if (be->rbuf == NULL) {
-        proxy_lua_error(L, "out of memory allocating backend");
-        return 0;
-    }
-
-    // initialize libevent.
-    memset(&be->event, 0, sizeof(be->event));
+    be->owner = be;
+    // set the metatable before connecting so __gc frees whatever was set up
+    // if we error out partway.
+    luaL_getmetatable(L, "mcp.backend");
+    lua_setmetatable(L, -2); // set metatable to userdata.
 
-    // initialize the client
-    be->client = malloc(mcmc_size(MCMC_OPTION_BLANK));
-    if (be->client == NULL) {
-        proxy_lua_error(L, "out of memory allocating backend");
-        return 0;
-    }
     // TODO (v2): connect elsewhere. When there're multiple backend owners, or
     // sockets per backend, etc. We'll want to kick off connects as use time.
     // TODO (v2): no way to change the TCP_KEEPALIVE state post-construction.
@@ -183,24 +220,37 @@ static int mcplib_backend(lua_State *L) {
     if (ctx->tunables.tcp_keepalive) {
         flags |= MCMC_OPTION_TCP_KEEPALIVE;
     }
+    int conncount = ctx->tunables.backend_connections;
     STAT_UL(ctx);
-    be->connect_flags = flags;
-    int status = mcmc_connect(be->client, be->name, be->port, flags);
-    if (status == MCMC_CONNECTED) {
-        // FIXME (v2): is this possible? do we ever want to allow blocking
-        // connections?
-        proxy_lua_ferror(L, "unexpectedly connected to backend early: %s:%s\n", be->name, be->port);
-        return 0;
-    } else if (status == MCMC_CONNECTING) {
-        be->connecting = true;
-        be->can_write = false;
-    } else {
-        proxy_lua_ferror(L, "failed to connect to backend: %s:%s\n", be->name, be->port);
+
+    const char *err = _mcplib_backend_conn(be, flags);
+    if (err != NULL) {
+        proxy_lua_ferror(L, "%s: %s:%s\n", err, be->name, be->port);
         return 0;
     }
 
-    luaL_getmetatable(L, "mcp.backend");
-    lua_setmetatable(L, -2); // set metatable to userdata.
+    // the userdata is the first connection, any others hang off of it.
+    // requests go to whichever connection has the fewest outstanding.
+    if (conncount > 1) {
+        be->conns = calloc(conncount - 1, sizeof(mcp_backend_t));
+        if (be->conns == NULL) {
+            proxy_lua_error(L, "out of memory allocating backend");
+            return 0;
+        }
+        for (int x = 0; x < conncount - 1; x++) {
+            mcp_backend_t *bc = &be->conns[x];
+            memcpy(bc->name, be->name, sizeof(bc->name));
+            memcpy(bc->port, be->port, sizeof(bc->port));
+            bc->owner = be;
+            // count as we go so __gc only cleans up what was set up.
+            be->conncount++;
+            err = _mcplib_backend_conn(bc, flags);
+            if (err != NULL) {
+                proxy_lua_ferror(L, "%s: %s:%s\n", err, be->name, be->port);
+                return 0;
+            }
+        }
+    }
 
     lua_pushvalue(L, 1); // put the label at the top for settable later.
     lua_pushvalue(L, -2); // copy the backend reference to the top.
@@ -208,7 +258,11 @@ static int mcplib_backend(lua_State *L) {
     lua_settable(L, lua_upvalueindex(MCP_BACKEND_UPVALUE));
     // stack is back to having backend on the top.
 
-    STAT_INCR(ctx, backend_total, 1);
+    STAT_L(ctx);
+    STAILQ_INSERT_TAIL(&ctx->be_all, be, be_all_next);
+    be->listed = true;
+    ctx->global_stats.backend_total++;
+    STAT_UL(ctx);
 
     return 1;
 }
@@ -335,7 +389,11 @@ static void _mcplib_pool_dist(lua_State *L, mcp_pool_t *p) {
     // UD now popped from stack.
 }
 
-// p = mcp.pool(backends, { dist = f, hashfilter = f, seed = "a", hash = f })
+// p = mcp.pool(backends, { dist = f, hashfilter = f, seed = "a", hash = f,
+//                         coalesce = true, coalesce_stat = n })
+// coalesce: identical gets/mg's in flight to the same backend share a single
+// backend request and response. coalesce_stat: mcp.add_stat() index to count
+// requests routed through this pool that were answered that way.
 static int mcplib_pool(lua_State *L) {
     int argc = lua_gettop(L);
     luaL_checktype(L, 1, LUA_TTABLE);
@@ -447,6 +505,22 @@ static int mcplib_pool(lua_State *L) {
         lua_pop(L, 1); // pop the nil.
     }
 
+    if (lua_getfield(L, 2, "coalesce") != LUA_TNIL) {
+        luaL_checktype(L, -1, LUA_TBOOLEAN);
+        p->coalesce = lua_toboolean(L, -1);
+    }
+    lua_pop(L, 1);
+
+    if (lua_getfield(L, 2, "coalesce_stat") != LUA_TNIL) {
+        int idx = luaL_checkinteger(L, -1);
+        // same limits as mcp.add_stat()
+        if (idx < 1 || idx > 1024) {
+            proxy_lua_error(L, "coalesce_stat must be a stat index between 1 and 1024");
+        }
+        p->coalesce_stat = idx;
+    }
+    lua_pop(L, 1);
+
     if (p->phc.selector_func == NULL) {
         proxy_lua_error(L, "cannot create pool missing 'dist' argument");
     }
@@ -471,7 +545,8 @@ static int mcplib_pool_proxy_gc(lua_State *L) {
     return 0;
 }
 
-mcp_backend_t *mcplib_pool_proxy_call_helper(lua_State *L, mcp_pool_t *p, const char *key, size_t len) {
+// returns the index into p->pool for a key.
+uint32_t mcplib_pool_proxy_lookup(lua_State *L, mcp_pool_t *p, const char *key, size_t len) {
     if (p->key_filter) {
         key = p->key_filter(p->key_filter_conf, key, len, &len);
         P_DEBUG("%s: filtered key for hashing (%.*s)\n", __func__, (int)len, key);
@@ -487,7 +562,11 @@ mcp_backend_t *mcplib_pool_proxy_call_helper(lua_State *L, mcp_pool_t *p, const
         proxy_lua_error(L, "key dist hasher tried to use out of bounds index");
     }
 
-    return p->pool[lookup].be;
+    return lookup;
+}
+
+mcp_backend_t *mcplib_pool_proxy_call_helper(lua_State *L, mcp_pool_t *p, const char *key, size_t len) {
+    return p->pool[mcplib_pool_proxy_lookup(L, p, key, len)].be;
 }
 
 // hashfunc(request) -> backend(request)
@@ -504,9 +583,15 @@ static int mcplib_pool_proxy_call(lua_State *L) {
         proxy_lua_error(L, "cannot route commands without key");
         return 0;
     }
+    if (rq->mget_batch) {
+        // keys may live on different backends: split them up in C.
+        return mcplib_await_mget(L, rq);
+    }
     const char *key = MCP_PARSER_KEY(rq->pr);
     size_t len = rq->pr.klen;
     rq->be = mcplib_pool_proxy_call_helper(L, p, key, len);
+    rq->coalesce = p->coalesce;
+    rq->coalesce_stat = p->coalesce_stat;
 
     // now yield request, pool up.
     return lua_yield(L, 2);
@@ -524,6 +609,18 @@ static int mcplib_tcp_keepalive(lua_State *L) {
     return 0;
 }
 
+static int mcplib_batch_multiget(lua_State *L) {
+    luaL_checktype(L, -1, LUA_TBOOLEAN);
+    int state = lua_toboolean(L, -1);
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+
+    STAT_L(ctx);
+    ctx->tunables.batch_multiget = state;
+    STAT_UL(ctx);
+
+    return 0;
+}
+
 static int mcplib_backend_failure_limit(lua_State *L) {
     int limit = luaL_checkinteger(L, -1);
     proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
@@ -540,6 +637,24 @@ static int mcplib_backend_failure_limit(lua_State *L) {
     return 0;
 }
 
+// Connections opened to each backend created after this is called. Requests
+// go to whichever connection has the fewest outstanding.
+static int mcplib_backend_connections(lua_State *L) {
+    int count = luaL_checkinteger(L, -1);
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+
+    if (count < 1 || count > BE_CONNS_MAX) {
+        proxy_lua_ferror(L, "backend_connections must be between 1 and %d", BE_CONNS_MAX);
+        return 0;
+    }
+
+    STAT_L(ctx);
+    ctx->tunables.backend_connections = count;
+    STAT_UL(ctx);
+
+    return 0;
+}
+
 // sad, I had to look this up...
 #define NANOSECONDS(x) ((x) * 1E9 + 0.5)
 #define MICROSECONDS(x) ((x) * 1E6 + 0.5)
@@ -598,8 +713,55 @@ static int mcplib_backend_read_timeout(lua_State *L) {
     return 0;
 }
 
+// mcp.backend_read_timeout_adaptive(multiplier, [min_seconds])
+// Scale each backend's read timeout to a multiple of its observed p99, never
+// going below min_seconds or above the fixed backend_read_timeout.
+static int mcplib_backend_read_timeout_adaptive(lua_State *L) {
+    int mult = luaL_checkinteger(L, 1);
+    lua_Number secondsf = luaL_optnumber(L, 2, 0.1);
+    lua_Integer secondsi = (lua_Integer) secondsf;
+    lua_Number subseconds = secondsf - secondsi;
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+
+    if (mult < 0 || mult > 1000) {
+        proxy_lua_error(L, "backend_read_timeout_adaptive multiplier must be between 0 and 1000");
+        return 0;
+    }
+    if (secondsf < 0) {
+        proxy_lua_error(L, "backend_read_timeout_adaptive minimum must be >= 0");
+        return 0;
+    }
+
+    STAT_L(ctx);
+    ctx->tunables.read_adaptive = mult;
+    ctx->tunables.read_min.tv_sec = secondsi;
+    ctx->tunables.read_min.tv_usec = MICROSECONDS(subseconds);
+    STAT_UL(ctx);
+
+    return 0;
+}
+
+// Hedged reads from mcp.await(..., mcp.AWAIT_HEDGE) may add at most this
+// percent of extra load.
+static int mcplib_hedge_budget(lua_State *L) {
+    int pct = luaL_checkinteger(L, -1);
+    proxy_ctx_t *ctx = settings.proxy_ctx; // FIXME (v2): get global ctx reference in thread/upvalue.
+
+    if (pct < 0 || pct > 100) {
+        proxy_lua_error(L, "hedge_budget must be between 0 and 100");
+        return 0;
+    }
+
+    STAT_L(ctx);
+    ctx->tunables.hedge_budget = pct;
+    STAT_UL(ctx);
+
+    return 0;
+}
+
 // mcp.attach(mcp.HOOK_NAME, function)
 // fill hook structure: if lua function, use luaL_ref() to store the func
+// A pool or route table may be attached in place of a function.
 static int mcplib_attach(lua_State *L) {
     // Pull the original worker thread out of the shared mcplib upvalue.
     LIBEVENT_THREAD *t = lua_touserdata(L, lua_upvalueindex(MCP_THREAD_UPVALUE));
@@ -620,7 +782,10 @@ static int mcplib_attach(lua_State *L) {
         loop_end = hook + 1;
     }
 
-    if (lua_isfunction(L, 2)) {
+    mcp_route_t *route = luaL_testudata(L, 2, "mcp.route_table");
+    // a bare pool sees every key of a request, so multigets can be batched.
+    bool pool = luaL_testudata(L, 2, "mcp.pool_proxy") != NULL;
+    if (lua_isfunction(L, 2) || route != NULL || pool) {
         struct proxy_hook *hooks = t->proxy_hooks;
         uint64_t tag = 0; // listener socket tag
 
@@ -661,12 +826,16 @@ static int mcplib_attach(lua_State *L) {
                         }
 
                         pht->lua_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+                        pht->route = route;
+                        pht->pool = pool;
                         assert(pht->lua_ref != 0);
                         found = true;
                         break;
                     } else if (pht->tag == 0) {
                         // no tag in this slot, so we use it.
                         pht->lua_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+                        pht->route = route;
+                        pht->pool = pool;
                         pht->tag = tag;
                         assert(pht->lua_ref != 0);
                         found = true;
@@ -684,6 +853,8 @@ static int mcplib_attach(lua_State *L) {
                     }
 
                     pht[h->tagcount].lua_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+                    pht[h->tagcount].route = route;
+                    pht[h->tagcount].pool = pool;
                     pht[h->tagcount].tag = tag;
 
                     h->tagcount++;
@@ -698,11 +869,13 @@ static int mcplib_attach(lua_State *L) {
 
                 // pops the function from the stack and leaves us a ref. for later.
                 h->lua_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+                h->route = route;
+                h->pool = pool;
                 assert(h->lua_ref != 0);
             }
         }
     } else {
-        proxy_lua_error(L, "Must pass a function to mcp.attach");
+        proxy_lua_error(L, "Must pass a function, pool or route table to mcp.attach");
         return 0;
     }
 
@@ -861,6 +1034,7 @@ static void proxy_register_defines(lua_State *L) {
     X(AWAIT_ANY);
     X(AWAIT_OK);
     X(AWAIT_FIRST);
+    X(AWAIT_HEDGE);
     CMD_FIELDS
 #undef X
 }
@@ -910,11 +1084,17 @@ int proxy_register_libs(LIBEVENT_THREAD *t, void *ctx) {
         {NULL, NULL}
     };
 
+    const struct luaL_Reg mcplib_route_table_m[] = {
+        {"__gc", mcplib_route_table_gc},
+        {NULL, NULL}
+    };
+
     const struct luaL_Reg mcplib_f [] = {
         {"pool", mcplib_pool},
         {"backend", mcplib_backend},
         {"request", mcplib_request},
         {"attach", mcplib_attach},
+        {"route_table", mcplib_route_table},
         {"add_stat", mcplib_add_stat},
         {"stat", mcplib_stat},
         {"await", mcplib_await},
@@ -925,7 +1105,16 @@ int proxy_register_libs(LIBEVENT_THREAD *t, void *ctx) {
         {"backend_retry_timeout", mcplib_backend_retry_timeout},
         {"backend_read_timeout", mcplib_backend_read_timeout},
         {"backend_failure_limit", mcplib_backend_failure_limit},
+        {"backend_connections", mcplib_backend_connections},
         {"tcp_keepalive", mcplib_tcp_keepalive},
+        {"batch_multiget", mcplib_batch_multiget},
+        {"backend_read_timeout_adaptive", mcplib_backend_read_timeout_adaptive},
+        {"hedge_budget", mcplib_hedge_budget},
+        {"l1_size", mcplib_l1_size},
+        {"l1_ttl", mcplib_l1_ttl},
+        {"l1_get", mcplib_l1_get},
+        {"l1_set", mcplib_l1_set},
+        {"l1_invalidate", mcplib_l1_invalidate},
         {NULL, NULL}
     };
 
@@ -960,6 +1149,12 @@ int proxy_register_libs(LIBEVENT_THREAD *t, void *ctx) {
     luaL_setfuncs(L, mcplib_pool_proxy_m, 0); // register methods
     lua_pop(L, 1); // drop the hash selector metatable
 
+    luaL_newmetatable(L, "mcp.route_table");
+    lua_pushvalue(L, -1); // duplicate metatable.
+    lua_setfield(L, -2, "__index"); // mt.__index = mt
+    luaL_setfuncs(L, mcplib_route_table_m, 0); // register methods
+    lua_pop(L, 1);
+
     // create main library table.
     //luaL_newlib(L, mcplib_f);
     // TODO (v2): luaL_newlibtable() just pre-allocs the exact number of things
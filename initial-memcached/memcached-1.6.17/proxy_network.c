@@ -10,6 +10,169 @@ static int _flush_pending_write(mcp_backend_t *be);
 static int _reset_bad_backend(mcp_backend_t *be, enum proxy_be_failures err);
 static void _set_event(mcp_backend_t *be, struct event_base *base, int flags, struct timeval t, event_callback_fn callback);
 static int proxy_backend_drive_machine(mcp_backend_t *be);
+static void _coalesce_release(mcp_backend_t *be, io_pending_proxy_t *io);
+static int _batch_append(mcp_resp_t *r);
+
+// Coalescable requests are a single iov. Partial writes advance its base, so
+// walk back to the start of the request.
+static inline const char *_coalesce_req(io_pending_proxy_t *io) {
+    return (const char *)io->iov[0].iov_base - (io->creqlen - io->iov[0].iov_len);
+}
+
+// the table lives on the owning backend, so requests can be coalesced no
+// matter which of its connections they went out on.
+static inline io_pending_proxy_t **_coalesce_bucket(mcp_backend_t *be, io_pending_proxy_t *io) {
+    uint64_t hv = XXH3_64bits(_coalesce_req(io), io->creqlen);
+    return &be->owner->coalesce[hv & (BE_COALESCE_BUCKETS - 1)];
+}
+
+// If an identical read is already in flight to this backend, hang the IO off
+// of it and return true; it gets a copy of that response instead of being
+// sent. Otherwise the IO becomes the request others can wait on.
+static bool _coalesce_attach(mcp_backend_t *be, io_pending_proxy_t *io) {
+    io_pending_proxy_t **bucket = _coalesce_bucket(be, io);
+    io_pending_proxy_t *lead = NULL;
+
+    for (lead = *bucket; lead != NULL; lead = lead->cnext) {
+        if (lead->creqlen == io->creqlen
+                && lead->ascii_multiget == io->ascii_multiget
+                && memcmp(_coalesce_req(lead), io->iov[0].iov_base, io->creqlen) == 0) {
+            break;
+        }
+    }
+
+    if (lead != NULL) {
+        io->coalesced = true;
+        io->next = lead->next;
+        lead->next = io;
+        return true;
+    }
+
+    // the submission stack pointer is stale by now; reuse it for waiters.
+    io->next = NULL;
+    io->cnext = *bucket;
+    *bucket = io;
+    return false;
+}
+
+// Pick the connection with the fewest outstanding requests, skipping any
+// that are marked bad. NULL if they all are.
+static mcp_backend_t *_backend_conn_select(mcp_backend_t *be) {
+    mcp_backend_t *best = be->bad ? NULL : be;
+    for (int x = 0; x < be->conncount; x++) {
+        mcp_backend_t *bc = &be->conns[x];
+        if (bc->bad) {
+            continue;
+        }
+        if (best == NULL || bc->depth < best->depth) {
+            best = bc;
+        }
+    }
+    return best;
+}
+
+static inline void _backend_depth_sample(mcp_backend_t *be, int depth) {
+    int b = 31 - __builtin_clz(depth);
+    if (b >= BE_DEPTH_BUCKETS) {
+        b = BE_DEPTH_BUCKETS - 1;
+    }
+    // only this thread writes; stats reads it without a lock.
+    __atomic_store_n(&be->depth_hist[b], be->depth_hist[b] + 1, __ATOMIC_RELAXED);
+}
+
+// monotonic, so wall clock steps don't turn into bogus latencies.
+static inline uint32_t _lat_now_us(void) {
+    return (uint32_t)(thread_clock_ns() / 1000);
+}
+
+// four buckets per power of two, so percentiles are within ~25%.
+static inline int _lat_bucket(uint32_t us) {
+    if (us < 8) {
+        return us;
+    }
+    int msb = 31 - __builtin_clz(us);
+    int b = msb * 4 + ((us >> (msb - 2)) & 3);
+    return b < BE_LAT_BUCKETS ? b : BE_LAT_BUCKETS - 1;
+}
+
+// upper edge of a bucket, in microseconds.
+static inline uint32_t _lat_bucket_us(int b) {
+    if (b < 8) {
+        return b;
+    }
+    int msb = b / 4;
+    uint64_t us = (uint64_t)(4 + (b & 3) + 1) << (msb - 2);
+    return us > UINT32_MAX ? UINT32_MAX : us;
+}
+
+static void _backend_lat_recalc(mcp_backend_t *be) {
+    uint32_t p95 = be->lat_total - be->lat_total / 20;
+    uint32_t p99 = be->lat_total - be->lat_total / 100;
+    uint32_t seen = 0;
+    int b95 = -1;
+    int b;
+
+    for (b = 0; b < BE_LAT_BUCKETS; b++) {
+        seen += be->lat_hist[b];
+        if (b95 == -1 && seen >= p95) {
+            b95 = b;
+        }
+        if (seen >= p99) {
+            break;
+        }
+    }
+    // stats and the workers read these without a lock.
+    __atomic_store_n(&be->lat_p95_us, _lat_bucket_us(b95), __ATOMIC_RELAXED);
+    __atomic_store_n(&be->lat_p99_us, _lat_bucket_us(b), __ATOMIC_RELAXED);
+
+    // decay, so the sketch follows the backend as it speeds up or slows down.
+    if (be->lat_total >= BE_LAT_RECALC * 64) {
+        be->lat_total = 0;
+        for (b = 0; b < BE_LAT_BUCKETS; b++) {
+            be->lat_hist[b] /= 2;
+            be->lat_total += be->lat_hist[b];
+        }
+    }
+}
+
+static void _backend_lat_sample(mcp_backend_t *be, uint32_t us) {
+    uint32_t ewma = be->lat_ewma_us;
+    ewma = ewma == 0 ? us : ewma + ((int64_t)us - ewma) / 8;
+    __atomic_store_n(&be->lat_ewma_us, ewma, __ATOMIC_RELAXED);
+
+    be->lat_hist[_lat_bucket(us)]++;
+    be->lat_total++;
+    if ((be->lat_total & (BE_LAT_RECALC - 1)) == 0) {
+        _backend_lat_recalc(be);
+    }
+}
+
+// With an adaptive read timeout, wait a multiple of the backend's p99
+// instead of the fixed timeout, which becomes the ceiling.
+static struct timeval _backend_read_timeout(mcp_backend_t *be) {
+    struct proxy_tunables *tun = &be->event_thread->tunables;
+    struct timeval tv = tun->read;
+    uint32_t p99 = be->owner->lat_p99_us;
+
+    if (tun->read_adaptive != 0 && p99 != 0) {
+        uint64_t us = (uint64_t)p99 * tun->read_adaptive;
+        uint64_t min = (uint64_t)tun->read_min.tv_sec * 1000000 + tun->read_min.tv_usec;
+        uint64_t max = (uint64_t)tun->read.tv_sec * 1000000 + tun->read.tv_usec;
+        if (us < min) {
+            us = min;
+        }
+        if (us > max) {
+            us = max;
+        }
+        tv.tv_sec = us / 1000000;
+        tv.tv_usec = us % 1000000;
+    }
+#ifdef HAVE_LIBURING
+    be->read_ur.tv_sec = tv.tv_sec;
+    be->read_ur.tv_nsec = tv.tv_usec * 1000;
+#endif
+    return tv;
+}
 
 static int _proxy_event_handler_dequeue(proxy_event_thread_t *t) {
     io_head_t head;
@@ -24,26 +187,34 @@ static int _proxy_event_handler_dequeue(proxy_event_thread_t *t) {
 
     int io_count = 0;
     int be_count = 0;
+    uint32_t now = STAILQ_EMPTY(&head) ? 0 : _lat_now_us();
     while (!STAILQ_EMPTY(&head)) {
         io_pending_proxy_t *io = STAILQ_FIRST(&head);
         io->flushed = false;
-        mcp_backend_t *be = io->backend;
-        // So the backend can retrieve its event base.
-        be->event_thread = t;
+        io->start_us = now;
+        mcp_backend_t *owner = io->backend;
 
         // _no_ mutex on backends. they are owned by the event thread.
         STAILQ_REMOVE_HEAD(&head, io_next);
         // paranoia about moving items between lists.
         io->io_next.stqe_next = NULL;
 
-        if (be->bad) {
+        mcp_backend_t *be = _backend_conn_select(owner);
+        if (be == NULL) {
             P_DEBUG("%s: fast failing request to bad backend\n", __func__);
             io->client_resp->status = MCMC_ERR;
             return_io_pending((io_pending_t *)io);
             continue;
         }
+        if (io->coalesce && _coalesce_attach(owner, io)) {
+            continue;
+        }
+        // So the backend can retrieve its event base.
+        be->event_thread = t;
+        io->backend = be;
         STAILQ_INSERT_TAIL(&be->io_head, io, io_next);
         be->depth++;
+        _backend_depth_sample(owner, be->depth);
         io_count++;
         if (!be->stacked) {
             be->stacked = true;
@@ -58,6 +229,11 @@ static int _proxy_event_handler_dequeue(proxy_event_thread_t *t) {
 }
 
 #ifdef HAVE_LIBURING
+static inline struct __kernel_timespec *_backend_read_timeout_ur(mcp_backend_t *be) {
+    _backend_read_timeout(be);
+    return &be->read_ur;
+}
+
 static void _proxy_evthr_evset_be_read(mcp_backend_t *be, char *buf, size_t len, struct __kernel_timespec *ts);
 static void _proxy_evthr_evset_be_wrpoll(mcp_backend_t *be, struct __kernel_timespec *ts);
 static void _proxy_evthr_evset_be_retry(mcp_backend_t *be);
@@ -136,7 +312,7 @@ static void proxy_backend_handler_ur(void *udata, struct io_uring_cqe *cqe) {
     int res = proxy_backend_drive_machine(be);
 
     if (res > 0) {
-        _proxy_evthr_evset_be_read(be, be->rbuf+be->rbufused, READ_BUFFER_SIZE-be->rbufused, &be->event_thread->tunables.read_ur);
+        _proxy_evthr_evset_be_read(be, be->rbuf+be->rbufused, READ_BUFFER_SIZE-be->rbufused, _backend_read_timeout_ur(be));
         return;
     } else if (res == -1) {
         _reset_bad_backend(be, P_BE_FAIL_DISCONNECTED);
@@ -145,7 +321,7 @@ static void proxy_backend_handler_ur(void *udata, struct io_uring_cqe *cqe) {
 
     // TODO (v2): when exactly do we need to reset the backend handler?
     if (!STAILQ_EMPTY(&be->io_head)) {
-        _proxy_evthr_evset_be_read(be, be->rbuf+be->rbufused, READ_BUFFER_SIZE-be->rbufused, &be->event_thread->tunables.read_ur);
+        _proxy_evthr_evset_be_read(be, be->rbuf+be->rbufused, READ_BUFFER_SIZE-be->rbufused, _backend_read_timeout_ur(be));
     }
 }
 
@@ -182,7 +358,7 @@ static void proxy_backend_wrhandler_ur(void *udata, struct io_uring_cqe *cqe) {
         _proxy_evthr_evset_be_wrpoll(be, &be->event_thread->tunables.connect_ur);
     }
 
-    _proxy_evthr_evset_be_read(be, be->rbuf, READ_BUFFER_SIZE, &be->event_thread->tunables.read_ur);
+    _proxy_evthr_evset_be_read(be, be->rbuf, READ_BUFFER_SIZE, _backend_read_timeout_ur(be));
 }
 
 static void proxy_event_handler_ur(void *udata, struct io_uring_cqe *cqe) {
@@ -237,7 +413,7 @@ static void proxy_event_handler_ur(void *udata, struct io_uring_cqe *cqe) {
                 _proxy_evthr_evset_be_wrpoll(be, &t->tunables.connect_ur);
             }
             if (flags & EV_READ) {
-                _proxy_evthr_evset_be_read(be, be->rbuf, READ_BUFFER_SIZE, &t->tunables.read_ur);
+                _proxy_evthr_evset_be_read(be, be->rbuf, READ_BUFFER_SIZE, _backend_read_timeout_ur(be));
             }
         }
     }
@@ -434,7 +610,6 @@ static void proxy_event_handler(evutil_socket_t fd, short which, void *arg) {
 
     // Re-walk each backend and check set event as required.
     mcp_backend_t *be = NULL;
-    struct timeval tmp_time = t->tunables.read;
 
     // FIXME (v2): _set_event() is buggy, see notes on function.
     STAILQ_FOREACH(be, &t->be_head, be_next) {
@@ -451,7 +626,7 @@ static void proxy_event_handler(evutil_socket_t fd, short which, void *arg) {
             _reset_bad_backend(be, P_BE_FAIL_WRITING);
         } else {
             flags = be->can_write ? EV_READ|EV_TIMEOUT : EV_READ|EV_WRITE|EV_TIMEOUT;
-            _set_event(be, t->base, flags, tmp_time, proxy_backend_handler);
+            _set_event(be, t->base, flags, _backend_read_timeout(be), proxy_backend_handler);
         }
     }
 
@@ -506,6 +681,7 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
     bool stop = false;
     io_pending_proxy_t *p = NULL;
     int flags = 0;
+    uint32_t now = 0; // fetched once per read, for latency samples
 
     p = STAILQ_FIRST(&be->io_head);
     if (p == NULL) {
@@ -551,8 +727,10 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
                 case MCMC_RESP_GET:
                     // We're in GET mode. we only support one key per
                     // GET in the proxy backends, so we need to later check
-                    // for an END.
-                    extra_space = ENDLEN;
+                    // for an END. Batches keep reading values until one.
+                    if (!p->batch) {
+                        extra_space = ENDLEN;
+                    }
                     break;
                 case MCMC_RESP_END:
                     // this is a MISS from a GET request
@@ -582,6 +760,25 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
                     break;
                 }
 
+                if (p->batch && r->resp.type == MCMC_RESP_END) {
+                    // end of a batch: the values collected so far become
+                    // the response. the worker adds its own END.
+                    be->rbufused -= r->resp.reslen;
+                    if (be->rbufused > 0) {
+                        memmove(be->rbuf, be->rbuf+r->resp.reslen, be->rbufused);
+                    }
+                    r->buf = r->mbuf;
+                    r->blen = r->mblen;
+                    r->mbuf = NULL;
+                    r->mblen = 0;
+                    // the END line is gone from rbuf; don't leave the parsed
+                    // response pointing into it.
+                    memset(&r->resp, 0, sizeof(r->resp));
+                    r->resp.type = MCMC_RESP_END;
+                    be->state = mcp_backend_next;
+                    break;
+                }
+
                 // r->resp.reslen + r->resp.vlen is the total length of the response.
                 // TODO (v2): need to associate a buffer with this response...
                 // for now lets abuse write_and_free on mc_resp and simply malloc the
@@ -603,6 +800,7 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
                     P_DEBUG("%s: got a short read, moving to want_read\n", __func__);
                     // copy the partial and advance mcmc's buffer digestion.
                     memcpy(r->buf, be->rbuf, r->resp.reslen + r->resp.vlen_read);
+                    mcp_resp_rebase(&r->resp, be->rbuf, r->blen, r->buf);
                     r->bread = r->resp.reslen + r->resp.vlen_read;
                     be->rbufused = 0;
                     be->state = mcp_backend_want_read;
@@ -613,6 +811,7 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
                     // mcmc's already counted the value as read if it fit in
                     // the original buffer...
                     memcpy(r->buf, be->rbuf, r->resp.reslen+r->resp.vlen_read);
+                    mcp_resp_rebase(&r->resp, be->rbuf, r->blen, r->buf);
                 }
             } else {
                 // TODO (v2): no response read?
@@ -631,11 +830,22 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
             }
 
             if (r->resp.type == MCMC_RESP_GET) {
-                be->state = mcp_backend_read_end;
+                be->state = p->batch ? mcp_backend_read_batch : mcp_backend_read_end;
             } else {
                 be->state = mcp_backend_next;
             }
 
+            break;
+        case mcp_backend_read_batch:
+            r = p->client_resp;
+            // tack the value onto the rest of the batch, then look for
+            // another value or the END.
+            if (_batch_append(r) != 0) {
+                flags = -1;
+                stop = true;
+                break;
+            }
+            be->state = mcp_backend_parse;
             break;
         case mcp_backend_read_end:
             r = p->client_resp;
@@ -688,7 +898,7 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
             if (r->bread >= r->resp.vlen) {
                 // all done copying data.
                 if (r->resp.type == MCMC_RESP_GET) {
-                    be->state = mcp_backend_read_end;
+                    be->state = p->batch ? mcp_backend_read_batch : mcp_backend_read_end;
                 } else {
                     be->state = mcp_backend_next;
                 }
@@ -711,6 +921,13 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
             // set the head here. when we break the head will be correct.
             STAILQ_REMOVE_HEAD(&be->io_head, io_next);
             be->depth--;
+            if (p->client_resp->status == MCMC_OK) {
+                if (now == 0) {
+                    now = _lat_now_us();
+                }
+                _backend_lat_sample(be->owner, now - p->start_us);
+            }
+            _coalesce_release(be, p);
             // have to do the q->count-- and == 0 and redispatch_conn()
             // stuff here. The moment we call return_io here we
             // don't own *p anymore.
@@ -755,6 +972,79 @@ static int proxy_backend_drive_machine(mcp_backend_t *be) {
     return flags;
 }
 
+// Move a finished value in a batched multiget into the collected response.
+static int _batch_append(mcp_resp_t *r) {
+    char *mbuf = realloc(r->mbuf, r->mblen + r->blen);
+    if (mbuf == NULL) {
+        return -1;
+    }
+    memcpy(mbuf + r->mblen, r->buf, r->blen);
+    r->mbuf = mbuf;
+    r->mblen += r->blen;
+    free(r->buf);
+    r->buf = NULL;
+    r->blen = 0;
+    return 0;
+}
+
+// The parser leaves the value and response line pointing into whichever
+// buffer it was handed. Point them at the same offsets in a copy of that
+// buffer instead, so they stay valid once the original moves on.
+void mcp_resp_rebase(mcmc_resp_t *resp, const char *from, size_t len, char *to) {
+    const char *end = from + len;
+    if (resp->value >= from && resp->value < end) {
+        resp->value = to + (resp->value - from);
+    }
+    // key/stat share this slot for other response types.
+    if (resp->rline >= from && resp->rline < end) {
+        resp->rline = to + (resp->rline - from);
+    }
+}
+
+// Called as a request leaves the backend queue: stop others from attaching to
+// it and hand each waiter its own copy of the response, since the original
+// is freed by whichever worker thread owns it.
+static void _coalesce_release(mcp_backend_t *be, io_pending_proxy_t *io) {
+    if (!io->coalesce) {
+        return;
+    }
+
+    io_pending_proxy_t **bucket = _coalesce_bucket(be, io);
+    while (*bucket != io) {
+        assert(*bucket != NULL);
+        bucket = &(*bucket)->cnext;
+    }
+    *bucket = io->cnext;
+    io->cnext = NULL;
+
+    mcp_resp_t *r = io->client_resp;
+    io_pending_proxy_t *w = io->next;
+    io->next = NULL;
+    while (w) {
+        io_pending_proxy_t *next = w->next;
+        mcp_resp_t *wr = w->client_resp;
+
+        wr->status = r->status;
+        if (r->status == MCMC_OK) {
+            wr->resp = r->resp;
+            wr->bread = r->bread;
+            if (r->buf != NULL) {
+                wr->buf = malloc(r->blen);
+                if (wr->buf != NULL) {
+                    memcpy(wr->buf, r->buf, r->blen);
+                    wr->blen = r->blen;
+                    mcp_resp_rebase(&wr->resp, r->buf, r->blen, wr->buf);
+                } else {
+                    wr->status = MCMC_ERR;
+                }
+            }
+        }
+
+        return_io_pending((io_pending_t *)w);
+        w = next;
+    }
+}
+
 // All we need to do here is schedule the backend to attempt to connect again.
 static void proxy_backend_retry_handler(const int fd, const short which, void *arg) {
     mcp_backend_t *be = arg;
@@ -818,6 +1108,7 @@ static int _reset_bad_backend(mcp_backend_t *be, enum proxy_be_failures err) {
         // but will do for V1.
         io->client_resp->status = MCMC_ERR;
         be->depth--;
+        _coalesce_release(be, io);
         return_io_pending((io_pending_t *)io);
     }
 
@@ -851,19 +1142,19 @@ static int _reset_bad_backend(mcp_backend_t *be, enum proxy_be_failures err) {
     return 0;
 }
 
-static int _prep_pending_write(mcp_backend_t *be, unsigned int *tosend) {
+static int _prep_pending_write(mcp_backend_t *be, unsigned int *tosend, bool *more) {
     struct iovec *iovs = be->write_iovs;
     io_pending_proxy_t *io = NULL;
     int iovused = 0;
+    *more = false;
     STAILQ_FOREACH(io, &be->io_head, io_next) {
         if (io->flushed)
             continue;
 
         if (io->iovcnt + iovused > BE_IOV_MAX) {
-            // Signal to caller that we need to keep writing, if writeable.
-            // FIXME (v2): can certainly refactor this to loop instead of waiting
-            // for a writeable event.
-            *tosend += 1;
+            // Signal to caller that there's more to write once this batch
+            // is out.
+            *more = true;
             break;
         }
 
@@ -874,58 +1165,70 @@ static int _prep_pending_write(mcp_backend_t *be, unsigned int *tosend) {
     return iovused;
 }
 
+// Everything queued since the last flush goes out in as few writev()'s as
+// the iov limit allows: we keep going until the socket pushes back.
 static int _flush_pending_write(mcp_backend_t *be) {
     int flags = 0;
-    unsigned int tosend = 0;
-    int iovcnt = _prep_pending_write(be, &tosend);
+    bool more = true;
 
-    ssize_t sent = writev(mcmc_fd(be->client), be->write_iovs, iovcnt);
-    if (sent > 0) {
-        io_pending_proxy_t *io = NULL;
-        if (sent < tosend) {
-            flags |= EV_WRITE;
+    while (more) {
+        unsigned int tosend = 0;
+        int iovcnt = _prep_pending_write(be, &tosend, &more);
+        if (iovcnt == 0) {
+            break;
         }
 
-        STAILQ_FOREACH(io, &be->io_head, io_next) {
-            bool flushed = true;
-            if (io->flushed)
-                continue;
+        ssize_t sent = writev(mcmc_fd(be->client), be->write_iovs, iovcnt);
+        if (sent > 0) {
+            io_pending_proxy_t *io = NULL;
+            if (sent < tosend) {
+                flags |= EV_WRITE;
+                more = false;
+            }
 
-            if (sent >= io->iovbytes) {
-                // short circuit for common case.
-                sent -= io->iovbytes;
-            } else {
-                io->iovbytes -= sent;
-                for (int x = 0; x < io->iovcnt; x++) {
-                    struct iovec *iov = &io->iov[x];
-                    if (sent >= iov->iov_len) {
-                        sent -= iov->iov_len;
-                        iov->iov_len = 0;
-                    } else {
-                        iov->iov_len -= sent;
-                        sent = 0;
-                        flushed = false;
-                        break;
+            STAILQ_FOREACH(io, &be->io_head, io_next) {
+                bool flushed = true;
+                if (io->flushed)
+                    continue;
+
+                if (sent >= io->iovbytes) {
+                    // short circuit for common case.
+                    sent -= io->iovbytes;
+                } else {
+                    io->iovbytes -= sent;
+                    for (int x = 0; x < io->iovcnt; x++) {
+                        struct iovec *iov = &io->iov[x];
+                        if (sent >= iov->iov_len) {
+                            sent -= iov->iov_len;
+                            iov->iov_len = 0;
+                        } else {
+                            iov->iov_base = (char *)iov->iov_base + sent;
+                            iov->iov_len -= sent;
+                            sent = 0;
+                            flushed = false;
+                            break;
+                        }
                     }
                 }
-            }
-            io->flushed = flushed;
+                io->flushed = flushed;
 
-            if (flushed) {
-                flags |= EV_READ;
-            }
-            if (sent <= 0) {
-                // really shouldn't be negative, though.
-                assert(sent >= 0);
-                break;
+                if (flushed) {
+                    flags |= EV_READ;
+                }
+                if (sent <= 0) {
+                    // really shouldn't be negative, though.
+                    assert(sent >= 0);
+                    break;
+                }
+            } // STAILQ_FOREACH
+        } else if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                be->can_write = false;
+                flags |= EV_WRITE;
+            } else {
+                flags = -1;
             }
-        } // STAILQ_FOREACH
-    } else if (sent == -1) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) {
-            be->can_write = false;
-            flags |= EV_WRITE;
-        } else {
-            flags = -1;
+            break;
         }
     }
 
@@ -938,7 +1241,7 @@ static int _flush_pending_write(mcp_backend_t *be) {
 static void proxy_backend_handler(const int fd, const short which, void *arg) {
     mcp_backend_t *be = arg;
     int flags = EV_TIMEOUT;
-    struct timeval tmp_time = be->event_thread->tunables.read;
+    struct timeval tmp_time = _backend_read_timeout(be);
 
     if (which & EV_TIMEOUT) {
         P_DEBUG("%s: timeout received, killing backend queue\n", __func__);
@@ -439,8 +439,11 @@ int process_request(mcp_parser_t *pr, const char *command, size_t cmdlen) {
 
 // FIXME (v2): any reason to pass in command/cmdlen separately?
 mcp_request_t *mcp_new_request(lua_State *L, mcp_parser_t *pr, const char *command, size_t cmdlen) {
+    // only batched multigets go over the max length. they're never
+    // re-serialized, so don't need more than their own space.
+    size_t extra = cmdlen > MCP_REQUEST_MAXLEN ? cmdlen - MCP_REQUEST_MAXLEN : 0;
     // reserving an upvalue for key.
-    mcp_request_t *rq = lua_newuserdatauv(L, sizeof(mcp_request_t) + MCP_REQUEST_MAXLEN * 2 + KEY_MAX_LENGTH, 1);
+    mcp_request_t *rq = lua_newuserdatauv(L, sizeof(mcp_request_t) + MCP_REQUEST_MAXLEN * 2 + KEY_MAX_LENGTH + extra, 1);
     // TODO (v2): memset only the non-data part? as the rest gets memcpy'd
     // over.
     memset(rq, 0, sizeof(mcp_request_t));
@@ -450,6 +453,7 @@ mcp_request_t *mcp_new_request(lua_State *L, mcp_parser_t *pr, const char *comma
     rq->pr.request = rq->request;
     rq->pr.reqlen = cmdlen;
     gettimeofday(&rq->start, NULL);
+    rq->l1_start = proxy_l1_now();
 
     luaL_getmetatable(L, "mcp.request");
     lua_setmetatable(L, -2);
@@ -459,6 +463,49 @@ mcp_request_t *mcp_new_request(lua_State *L, mcp_parser_t *pr, const char *comma
     return rq;
 }
 
+// Only plain reads can share or reuse a response: the backend answers
+// identical requests identically, and nothing is changed by skipping one.
+// mg's that touch or autovivify have a side effect (and a win flag) per
+// request, so those always go to the backend.
+bool mcp_request_plain_read(mcp_parser_t *pr) {
+    switch (pr->command) {
+        case CMD_GET:
+        case CMD_GETS:
+            return true;
+        case CMD_MG:
+            if (pr->t.meta.flags & (((uint64_t)1 << ('N' - 65)) |
+                                    ((uint64_t)1 << ('T' - 65)))) {
+                return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Responses for noreply/quiet requests are still needed to keep the backend
+// stream in sync, so ask the backend for one and hide it from the client
+// based on the response mode.
+void mcp_request_reply_mode(mcp_parser_t *pr, char *request, mcp_resp_t *r) {
+    if (pr->noreply) {
+        if (pr->cmd_type == CMD_TYPE_META) {
+            r->mode = RESP_MODE_METAQUIET;
+            for (int x = 2; x < pr->ntokens; x++) {
+                if (request[pr->tokens[x]] == 'q') {
+                    request[pr->tokens[x]] = ' ';
+                }
+            }
+        } else {
+            r->mode = RESP_MODE_NOREPLY;
+            request[pr->reqlen - 3] = 'Y';
+        }
+    } else {
+        r->mode = RESP_MODE_NORMAL;
+    }
+
+    r->cmd = pr->command;
+}
+
 // TODO (v2):
 // if modified, this will re-serialize every time it's accessed.
 // a simple opt could copy back over the original space
@@ -530,6 +577,11 @@ void mcp_request_attach(lua_State *L, mcp_request_t *rq, io_pending_proxy_t *p)
         p->iovbytes += pr->vlen;
     }
 
+    if (rq->coalesce && mcp_request_plain_read(pr)) {
+        p->coalesce = true;
+        p->creqlen = len;
+        p->coalesce_stat = rq->coalesce_stat;
+    }
 }
 
 // second argument is optional, for building set requests.
@@ -585,6 +637,7 @@ int mcplib_request(lua_State *L) {
         memcpy(rq->pr.vbuf, val, vlen);
     }
     gettimeofday(&rq->start, NULL);
+    rq->l1_start = proxy_l1_now();
 
     // rq is now created, parsed, and on the stack.
     return 1;
@@ -31,18 +31,37 @@
 
 #include "proxy.h"
 #include "md5.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define DEFAULT_BUCKET_SIZE 160
 
+// jump table size limits, in bits of the hash used to index it.
+#define JUMP_BITS_MIN 1
+#define JUMP_BITS_MAX 20
+// points past the end of the continuum, so the final scan can read a whole
+// vector without bounds checks.
+#define POINTS_PAD 4
+
 typedef struct {
     unsigned int point; // continuum point.
     unsigned int id; // server id.
 } cpoint;
 
+// The continuum is kept sorted as split arrays of points and ids. A lookup
+// indexes the jump table with the top bits of the hash to find the first
+// point at or after the start of that slice of the ring, then scans forward
+// from there; slices average under one point, so a lookup touches a couple
+// of cache lines instead of every level of a binary search.
 typedef struct {
     struct proxy_hash_caller phc; // passed back to the proxy API.
-    unsigned int total_buckets;
-    cpoint continuum[]; // points to server ids.
+    unsigned int total_buckets; // points in the continuum.
+    unsigned int jump_shift; // hash >> jump_shift indexes jump.
+    uint32_t *jump; // index of the first point >= each slice start.
+    uint32_t *points; // sorted points, padded with UINT32_MAX.
+    uint32_t *ids; // server id for each point.
+    uint32_t data[]; // storage for the arrays above.
 } ketama_t;
 
 static uint64_t ketama_key_hasher(const void *key, size_t len, uint64_t seed);
@@ -86,8 +105,48 @@ static uint64_t ketama_key_hasher(const void *key, size_t len, uint64_t seed) {
 }
 
 // Note: must return lookupas as zero-indexed.
+// Returns the server with the next biggest point at or after what this key
+// hashes to, rolling back to the zeroth point past the end. This is the same
+// choice the binary search from ketama.c made over the sorted continuum.
 static uint32_t ketama_get_server(uint64_t hash, void *ctx) {
     ketama_t *kt = (ketama_t *)ctx;
+    unsigned int h = hash;
+    uint32_t i;
+
+    if (kt->total_buckets == 0)
+        return 0;
+
+    // points from here on are sorted and the slice's end is bounded by
+    // the next slice (or the padding), so the scan always stops.
+    i = kt->jump[h >> kt->jump_shift];
+#ifdef __SSE2__
+    // no unsigned compare in SSE2: flip the sign bits and compare signed.
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    const __m128i key = _mm_xor_si128(_mm_set1_epi32((int)h), bias);
+    for (;;) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&kt->points[i]), bias);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, key)));
+        if (mask != 0xf) {
+            i += __builtin_ctz(~mask);
+            break;
+        }
+        i += 4;
+    }
+#else
+    while (kt->points[i] < h)
+        i++;
+#endif
+
+    if (i >= kt->total_buckets)
+        i = 0; // if at the end, roll back to zeroth
+
+    return kt->ids[i]-1;
+}
+
+#ifdef MEMCACHED_DEBUG
+// The binary search ketama_get_server() replaced, kept for checking the jump
+// table in debug builds.
+static uint32_t ketama_get_server_bsearch(uint64_t hash, ketama_t *kt) {
     unsigned int h = hash;
     int highp = kt->total_buckets;
     int lowp = 0, midp;
@@ -100,13 +159,13 @@ static uint32_t ketama_get_server(uint64_t hash, void *ctx) {
         midp = (int)( ( lowp+highp ) / 2 );
 
         if ( midp == kt->total_buckets )
-            return kt->continuum[0].id-1; // if at the end, roll back to zeroth
+            return kt->ids[0]-1; // if at the end, roll back to zeroth
 
-        midval = kt->continuum[midp].point;
-        midval1 = midp == 0 ? 0 : kt->continuum[midp-1].point;
+        midval = kt->points[midp];
+        midval1 = midp == 0 ? 0 : kt->points[midp-1];
 
         if ( h <= midval && h > midval1 )
-            return kt->continuum[midp].id-1;
+            return kt->ids[midp]-1;
 
         if ( midval < h )
             lowp = midp + 1;
@@ -114,11 +173,33 @@ static uint32_t ketama_get_server(uint64_t hash, void *ctx) {
             highp = midp - 1;
 
         if ( lowp > highp )
-            return kt->continuum[0].id-1;
+            return kt->ids[0]-1;
     }
 }
+#endif
 /* END FROM ketama.c */
 
+#ifdef MEMCACHED_DEBUG
+// Lookups only change server at a point, so checking both sides of every
+// point, every slice start and the ends of the ring covers them all.
+static void ketama_check(ketama_t *kt) {
+    uint64_t slices = (uint64_t)1 << (32 - kt->jump_shift);
+    if (kt->total_buckets == 0)
+        return;
+    for (unsigned int x = 0; x < kt->total_buckets; x++) {
+        uint32_t p = kt->points[x];
+        assert(ketama_get_server(p, kt) == ketama_get_server_bsearch(p, kt));
+        assert(ketama_get_server(p - 1, kt) == ketama_get_server_bsearch(p - 1, kt));
+        assert(ketama_get_server(p + 1, kt) == ketama_get_server_bsearch(p + 1, kt));
+    }
+    for (uint64_t x = 0; x < slices; x++) {
+        uint32_t start = x << kt->jump_shift;
+        assert(ketama_get_server(start, kt) == ketama_get_server_bsearch(start, kt));
+    }
+    assert(ketama_get_server(UINT32_MAX, kt) == ketama_get_server_bsearch(UINT32_MAX, kt));
+}
+#endif
+
 // not much to be done about this without making the interface unusable.
 #define MODE_DEFAULT 0 // uses xxhash
 #define MODE_KETAMA 1 // uses md5
@@ -127,20 +208,21 @@ static uint32_t ketama_get_server(uint64_t hash, void *ctx) {
 
 // Not sure the hash algo used here matters all that much given the low number
 // of points... but it might be better to let it be overrideable.
-static void _add_server_default(ketama_t *kt, size_t hashstring_size, const char **parts,
+static void _add_server_default(cpoint *continuum, size_t hashstring_size, const char **parts,
         lua_Integer bucket_size, lua_Integer id, unsigned int *cont) {
     char *hashstring = malloc(hashstring_size);
 
     for (int k = 0; k < bucket_size; k++) {
         size_t len = snprintf(hashstring, hashstring_size, "%s:%s-%d", parts[0], parts[1], k);
-        kt->continuum[*cont].point = (unsigned int) XXH3_64bits(hashstring, len);
-        kt->continuum[*cont].id = id;
+        continuum[*cont].point = (unsigned int) XXH3_64bits(hashstring, len);
+        continuum[*cont].id = id;
+        (*cont)++;
     }
 
     free(hashstring);
 }
 
-static void _add_server_ketama(ketama_t *kt, size_t hashstring_size, const char **parts,
+static void _add_server_ketama(cpoint *continuum, size_t hashstring_size, const char **parts,
         lua_Integer bucket_size, lua_Integer id, unsigned int *cont) {
     char *hashstring = malloc(hashstring_size);
 
@@ -158,11 +240,11 @@ static void _add_server_ketama(ketama_t *kt, size_t hashstring_size, const char
          * for the points on the circle: */
         for(int h = 0; h < 4; h++ )
         {
-            kt->continuum[*cont].point = ( digest[3+h*4] << 24 )
-                                  | ( digest[2+h*4] << 16 )
-                                  | ( digest[1+h*4] <<  8 )
-                                  |   digest[h*4];
-            kt->continuum[*cont].id = id;
+            continuum[*cont].point = ( digest[3+h*4] << 24 )
+                               | ( digest[2+h*4] << 16 )
+                               | ( digest[1+h*4] <<  8 )
+                               |   digest[h*4];
+            continuum[*cont].id = id;
             (*cont)++;
         }
 
@@ -171,7 +253,7 @@ static void _add_server_ketama(ketama_t *kt, size_t hashstring_size, const char
     free(hashstring);
 }
 
-static void _add_server_twemproxy(ketama_t *kt, size_t hashstring_size, const char **parts,
+static void _add_server_twemproxy(cpoint *continuum, size_t hashstring_size, const char **parts,
         lua_Integer bucket_size, lua_Integer id, unsigned int *cont) {
     char *hashstring = malloc(hashstring_size);
 
@@ -195,11 +277,11 @@ static void _add_server_twemproxy(ketama_t *kt, size_t hashstring_size, const ch
          * for the points on the circle: */
         for(int h = 0; h < 4; h++ )
         {
-            kt->continuum[*cont].point = ( digest[3+h*4] << 24 )
-                                  | ( digest[2+h*4] << 16 )
-                                  | ( digest[1+h*4] <<  8 )
-                                  |   digest[h*4];
-            kt->continuum[*cont].id = id;
+            continuum[*cont].point = ( digest[3+h*4] << 24 )
+                               | ( digest[2+h*4] << 16 )
+                               | ( digest[1+h*4] <<  8 )
+                               |   digest[h*4];
+            continuum[*cont].id = id;
             (*cont)++;
         }
 
@@ -208,7 +290,7 @@ static void _add_server_twemproxy(ketama_t *kt, size_t hashstring_size, const ch
     free(hashstring);
 }
 
-static void _add_server_evcache(ketama_t *kt, size_t hashstring_size, const char **parts,
+static void _add_server_evcache(cpoint *continuum, size_t hashstring_size, const char **parts,
         lua_Integer bucket_size, lua_Integer id, unsigned int *cont) {
     char *hashstring = malloc(hashstring_size);
 
@@ -225,11 +307,11 @@ static void _add_server_evcache(ketama_t *kt, size_t hashstring_size, const char
          * for the points on the circle: */
         for(int h = 0; h < 4; h++ )
         {
-            kt->continuum[*cont].point = ( digest[3+h*4] << 24 )
-                                  | ( digest[2+h*4] << 16 )
-                                  | ( digest[1+h*4] <<  8 )
-                                  |   digest[h*4];
-            kt->continuum[*cont].id = id;
+            continuum[*cont].point = ( digest[3+h*4] << 24 )
+                               | ( digest[2+h*4] << 16 )
+                               | ( digest[1+h*4] <<  8 )
+                               |   digest[h*4];
+            continuum[*cont].id = id;
             (*cont)++;
         }
 
@@ -285,11 +367,9 @@ static int ketama_new(lua_State *L) {
         lua_pop(L, 1);
     }
 
-    // newuserdatauv() sized for pool*
-    size_t size = sizeof(ketama_t) + sizeof(cpoint) * (total * bucket_size);
-    ketama_t *kt = lua_newuserdatauv(L, size, 0);
-    // TODO: check *kt.
-    kt->total_buckets = bucket_size * total;
+    // points are built and sorted here, then copied into the lookup layout.
+    // kept as userdata on the stack so lua frees it if anything below raises.
+    cpoint *continuum = lua_newuserdatauv(L, sizeof(cpoint) * (total * bucket_size), 0);
 
     // loop over pool
     unsigned int cont = 0;
@@ -323,19 +403,19 @@ static int ketama_new(lua_State *L) {
 
         switch (makemode) {
             case MODE_DEFAULT:
-                _add_server_default(kt, hashstring_size, parts, bucket_size, id, &cont);
+                _add_server_default(continuum, hashstring_size, parts, bucket_size, id, &cont);
                 break;
             case MODE_KETAMA:
-                _add_server_ketama(kt, hashstring_size, parts, bucket_size, id, &cont);
+                _add_server_ketama(continuum, hashstring_size, parts, bucket_size, id, &cont);
                 break;
             case MODE_TWEMPROXY:
-                _add_server_twemproxy(kt, hashstring_size, parts, bucket_size, id, &cont);
+                _add_server_twemproxy(continuum, hashstring_size, parts, bucket_size, id, &cont);
                 break;
             case MODE_EVCACHE:
                 // EVCache uses the ipaddress couple of times, we need to factor that in
                 // when calculating the hashstring_size
                 hashstring_size += partlens[0];
-                _add_server_evcache(kt, hashstring_size, parts, bucket_size, id, &cont);
+                _add_server_evcache(continuum, hashstring_size, parts, bucket_size, id, &cont);
                 break;
         }
 
@@ -343,7 +423,45 @@ static int ketama_new(lua_State *L) {
     }
 
     // - qsort the points
-    qsort( &kt->continuum, cont, sizeof(cpoint), ketama_compare);
+    qsort( continuum, cont, sizeof(cpoint), ketama_compare);
+
+    // - size the jump table for about one point per slice
+    unsigned int jump_bits = JUMP_BITS_MIN;
+    while (jump_bits < JUMP_BITS_MAX && ((uint64_t)1 << jump_bits) < cont)
+        jump_bits++;
+    uint64_t slices = (uint64_t)1 << jump_bits;
+
+    // newuserdatauv() sized for the jump table, points and ids.
+    size_t size = sizeof(ketama_t)
+        + sizeof(uint32_t) * (slices + 1 + cont + POINTS_PAD + cont);
+    // raises on allocation failure rather than returning NULL.
+    ketama_t *kt = lua_newuserdatauv(L, size, 0);
+    kt->total_buckets = cont;
+    kt->jump_shift = 32 - jump_bits;
+    kt->jump = kt->data;
+    kt->points = kt->jump + slices + 1;
+    kt->ids = kt->points + cont + POINTS_PAD;
+
+    for (unsigned int x = 0; x < cont; x++) {
+        kt->points[x] = continuum[x].point;
+        kt->ids[x] = continuum[x].id;
+    }
+    for (int x = 0; x < POINTS_PAD; x++) {
+        kt->points[cont + x] = UINT32_MAX;
+    }
+
+    // - point each slice at the first point at or after its start
+    unsigned int p = 0;
+    for (uint64_t x = 0; x < slices; x++) {
+        uint64_t start = x << kt->jump_shift;
+        while (p < cont && kt->points[p] < start)
+            p++;
+        kt->jump[x] = p;
+    }
+    kt->jump[slices] = cont;
+#ifdef MEMCACHED_DEBUG
+    ketama_check(kt);
+#endif
 
     // set the hash/fetch function and the context ptr.
     kt->phc.ctx = kt;
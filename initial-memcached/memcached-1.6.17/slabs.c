@@ -59,6 +59,43 @@ static void *storage  = NULL;
 static pthread_mutex_t slabs_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t slabs_rebalance_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * Per-worker-thread caches of free chunks (-o slab_thread_cache).
+ *
+ * Each worker keeps a short list of free chunks per slab class. Allocs and
+ * frees only take the thread's own cache lock, which is uncontended except
+ * when the slab mover drains the cache. Chunks move to and from the global
+ * freelists in batches under slabs_lock.
+ *
+ * Cached chunks keep ITEM_SLABBED set, so the restart code treats them as
+ * free memory. The slab mover must never see one, so before it starts on a
+ * class it pauses caching for that class and drains every cache.
+ *
+ * Lock order: slab_caches_lock -> slab_cache_t.lock -> slabs_lock
+ */
+#define SLAB_CACHE_BYTES (16 * 1024)
+#define SLAB_CACHE_MAX 32
+
+typedef struct {
+    item *head;
+    unsigned int count;
+} slab_cache_class_t;
+
+typedef struct _slab_cache_t slab_cache_t;
+struct _slab_cache_t {
+    pthread_mutex_t lock;
+    slab_cache_t *next;
+    slab_cache_class_t cls[MAX_NUMBER_OF_SLAB_CLASSES];
+};
+
+static pthread_key_t slab_cache_key;
+static pthread_mutex_t slab_caches_lock = PTHREAD_MUTEX_INITIALIZER;
+static slab_cache_t *slab_caches = NULL;
+/* max chunks cached per class. 0 disables caching for the class. */
+static unsigned int slab_cache_max[MAX_NUMBER_OF_SLAB_CLASSES];
+/* class the slab mover is working on; caching is bypassed for it. */
+static volatile unsigned int slab_cache_paused = 0;
+
 /*
  * Forward Declarations
  */
@@ -293,6 +330,39 @@ void slabs_init(const size_t limit, const double factor, const bool prealloc, co
             slabs_preallocate(power_largest);
         }
     }
+
+    pthread_key_create(&slab_cache_key, NULL);
+    if (settings.slab_thread_cache) {
+        /* Large chunks aren't worth stranding in a thread's cache. */
+        for (i = POWER_SMALLEST; i < power_largest; i++) {
+            unsigned int max = SLAB_CACHE_BYTES / slabclass[i].size;
+            if (max > SLAB_CACHE_MAX)
+                max = SLAB_CACHE_MAX;
+            slab_cache_max[i] = max >= 4 ? max : 0;
+        }
+    }
+}
+
+/* Called by each worker thread as it starts up. */
+void slabs_cache_thread_init(void) {
+    slab_cache_t *c;
+
+    if (!settings.slab_thread_cache)
+        return;
+
+    c = calloc(1, sizeof(slab_cache_t));
+    if (c == NULL) {
+        fprintf(stderr, "Failed to allocate slab thread cache\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&c->lock, NULL);
+
+    pthread_mutex_lock(&slab_caches_lock);
+    c->next = slab_caches;
+    __atomic_store_n(&slab_caches, c, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&slab_caches_lock);
+
+    pthread_setspecific(slab_cache_key, c);
 }
 
 void slabs_prefill_global(void) {
@@ -522,6 +592,160 @@ static void do_slabs_free(void *ptr, const size_t size, unsigned int id) {
     return;
 }
 
+/* Moves up to 'count' chunks from the global freelist into a thread cache.
+ * The chunks stay flagged as ITEM_SLABBED.
+ * CALLED WITH slabs_lock HELD */
+static void do_slabs_alloc_batch(slab_cache_class_t *cc, unsigned int id,
+        unsigned int count, unsigned int flags) {
+    slabclass_t *p = &slabclass[id];
+    item *it;
+
+    if (p->sl_curr == 0 && flags != SLABS_ALLOC_NO_NEWPAGE) {
+        do_slabs_newslab(id);
+    }
+
+    while (p->sl_curr != 0 && count-- > 0) {
+        it = (item *)p->slots;
+        p->slots = it->next;
+        if (it->next) it->next->prev = 0;
+        p->sl_curr--;
+
+        it->next = cc->head;
+        cc->head = it;
+        cc->count++;
+    }
+}
+
+/* Returns up to 'count' chunks from a thread cache to the global freelist.
+ * CALLED WITH slabs_lock HELD */
+static void do_slabs_free_batch(slab_cache_class_t *cc, unsigned int id,
+        unsigned int count) {
+    slabclass_t *p = &slabclass[id];
+    item *it;
+
+    while (cc->count != 0 && count-- > 0) {
+        it = cc->head;
+        cc->head = it->next;
+        cc->count--;
+
+        it->prev = 0;
+        it->next = p->slots;
+        if (it->next) it->next->prev = it;
+        p->slots = it;
+        p->sl_curr++;
+    }
+}
+
+/* Returns the calling thread's cache for a class, locked, or NULL if the
+ * caller should use the global freelist. */
+static slab_cache_t *slab_cache_lock(unsigned int id) {
+    slab_cache_t *c;
+
+    if (id < POWER_SMALLEST || id > power_largest || slab_cache_max[id] == 0)
+        return NULL;
+    c = pthread_getspecific(slab_cache_key);
+    if (c == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&c->lock);
+    if (id == slab_cache_paused) {
+        pthread_mutex_unlock(&c->lock);
+        return NULL;
+    }
+    return c;
+}
+
+/* CALLED WITH c->lock HELD */
+static void *do_slab_cache_alloc(slab_cache_t *c, const size_t size,
+        unsigned int id, unsigned int flags) {
+    slab_cache_class_t *cc = &c->cls[id];
+    item *it = NULL;
+
+    if (cc->count == 0) {
+        pthread_mutex_lock(&slabs_lock);
+        do_slabs_alloc_batch(cc, id, slab_cache_max[id] / 2, flags);
+        pthread_mutex_unlock(&slabs_lock);
+    }
+
+    if (cc->count != 0) {
+        it = cc->head;
+        cc->head = it->next;
+        cc->count--;
+        it->next = 0;
+        /* Caching is paused while the slab mover looks at this class, so
+         * the flag can change under our own lock. */
+        it->it_flags &= ~ITEM_SLABBED;
+        it->refcount = 1;
+        MEMCACHED_SLABS_ALLOCATE(size, id, slabclass[id].size, it);
+    } else {
+        MEMCACHED_SLABS_ALLOCATE_FAILED(size, id);
+    }
+
+    return it;
+}
+
+/* CALLED WITH c->lock HELD */
+static void do_slab_cache_free(slab_cache_t *c, void *ptr, const size_t size,
+        unsigned int id) {
+    slab_cache_class_t *cc = &c->cls[id];
+    item *it = (item *)ptr;
+
+    MEMCACHED_SLABS_FREE(size, id, ptr);
+    it->it_flags = ITEM_SLABBED;
+    it->slabs_clsid = id;
+    it->prev = 0;
+    it->next = cc->head;
+    cc->head = it;
+    cc->count++;
+
+    if (cc->count > slab_cache_max[id]) {
+        pthread_mutex_lock(&slabs_lock);
+        do_slabs_free_batch(cc, id, slab_cache_max[id] / 2);
+        pthread_mutex_unlock(&slabs_lock);
+    }
+}
+
+/* Stops caching chunks of a class and returns every cached chunk of it to
+ * the global freelist. Must not be called with slabs_lock held. */
+static void slab_cache_pause(unsigned int id) {
+    slab_cache_t *c;
+
+    if (id < POWER_SMALLEST || id > power_largest || slab_cache_max[id] == 0)
+        return;
+
+    /* Any thread taking its cache lock after we've drained it will see the
+     * paused class. */
+    slab_cache_paused = id;
+    pthread_mutex_lock(&slab_caches_lock);
+    for (c = slab_caches; c != NULL; c = c->next) {
+        pthread_mutex_lock(&c->lock);
+        pthread_mutex_lock(&slabs_lock);
+        do_slabs_free_batch(&c->cls[id], id, c->cls[id].count);
+        pthread_mutex_unlock(&slabs_lock);
+        pthread_mutex_unlock(&c->lock);
+    }
+    pthread_mutex_unlock(&slab_caches_lock);
+}
+
+static void slab_cache_resume(void) {
+    slab_cache_paused = 0;
+}
+
+/* Free chunks held in thread caches for a class. Counts are read without
+ * the cache locks, so this is only a hint; fine for stats and the automover.
+ * May be called with slabs_lock held. */
+static unsigned int slab_cache_count(unsigned int id) {
+    slab_cache_t *c;
+    unsigned int count = 0;
+
+    if (slab_cache_max[id] == 0)
+        return 0;
+    for (c = __atomic_load_n(&slab_caches, __ATOMIC_ACQUIRE); c != NULL; c = c->next) {
+        count += __atomic_load_n(&c->cls[id].count, __ATOMIC_RELAXED);
+    }
+    return count;
+}
+
 /* With refactoring of the various stats code the automover won't need a
  * custom function here.
  */
@@ -532,7 +756,7 @@ void fill_slab_stats_automove(slab_stats_automove *am) {
         slabclass_t *p = &slabclass[n];
         slab_stats_automove *cur = &am[n];
         cur->chunks_per_page = p->perslab;
-        cur->free_chunks = p->sl_curr;
+        cur->free_chunks = p->sl_curr + slab_cache_count(n);
         cur->total_pages = p->slabs;
         cur->chunk_size = p->size;
     }
@@ -563,9 +787,10 @@ static void do_slabs_stats(ADD_STAT add_stats, void *c) {
     for(i = POWER_SMALLEST; i <= power_largest; i++) {
         slabclass_t *p = &slabclass[i];
         if (p->slabs != 0) {
-            uint32_t perslab, slabs;
+            uint32_t perslab, slabs, free_chunks;
             slabs = p->slabs;
             perslab = p->perslab;
+            free_chunks = p->sl_curr + slab_cache_count(i);
 
             char key_str[STAT_KEY_LEN];
             char val_str[STAT_VAL_LEN];
@@ -576,8 +801,8 @@ static void do_slabs_stats(ADD_STAT add_stats, void *c) {
             APPEND_NUM_STAT(i, "total_pages", "%u", slabs);
             APPEND_NUM_STAT(i, "total_chunks", "%u", slabs * perslab);
             APPEND_NUM_STAT(i, "used_chunks", "%u",
-                            slabs*perslab - p->sl_curr);
-            APPEND_NUM_STAT(i, "free_chunks", "%u", p->sl_curr);
+                            slabs*perslab - free_chunks);
+            APPEND_NUM_STAT(i, "free_chunks", "%u", free_chunks);
             /* Stat is dead, but displaying zero instead of removing it. */
             APPEND_NUM_STAT(i, "free_chunks_end", "%u", 0);
             APPEND_NUM_STAT(i, "get_hits", "%llu",
@@ -660,6 +885,13 @@ static void memory_release() {
 void *slabs_alloc(size_t size, unsigned int id,
         unsigned int flags) {
     void *ret;
+    slab_cache_t *c;
+
+    if ((c = slab_cache_lock(id)) != NULL) {
+        ret = do_slab_cache_alloc(c, size, id, flags);
+        pthread_mutex_unlock(&c->lock);
+        return ret;
+    }
 
     pthread_mutex_lock(&slabs_lock);
     ret = do_slabs_alloc(size, id, flags);
@@ -668,6 +900,16 @@ void *slabs_alloc(size_t size, unsigned int id,
 }
 
 void slabs_free(void *ptr, size_t size, unsigned int id) {
+    slab_cache_t *c;
+
+    /* chunked items span several classes; they go back the slow way. */
+    if ((((item *)ptr)->it_flags & ITEM_CHUNKED) == 0
+            && (c = slab_cache_lock(id)) != NULL) {
+        do_slab_cache_free(c, ptr, size, id);
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+
     pthread_mutex_lock(&slabs_lock);
     do_slabs_free(ptr, size, id);
     pthread_mutex_unlock(&slabs_lock);
@@ -705,7 +947,7 @@ unsigned int slabs_available_chunks(const unsigned int id, bool *mem_flag,
 
     pthread_mutex_lock(&slabs_lock);
     p = &slabclass[id];
-    ret = p->sl_curr;
+    ret = p->sl_curr + slab_cache_count(id);
     if (mem_flag != NULL)
         *mem_flag = mem_malloced >= mem_limit ? true : false;
     if (chunks_perslab != NULL)
@@ -735,6 +977,9 @@ static int slab_rebalance_start(void) {
     slabclass_t *s_cls;
     int no_go = 0;
 
+    /* Cached chunks must be back on the freelist before the page scan. */
+    slab_cache_pause(slab_rebal.s_clsid);
+
     pthread_mutex_lock(&slabs_lock);
 
     if (slab_rebal.s_clsid < SLAB_GLOBAL_PAGE_POOL ||
@@ -755,6 +1000,7 @@ static int slab_rebalance_start(void) {
 
     if (no_go != 0) {
         pthread_mutex_unlock(&slabs_lock);
+        slab_cache_resume();
         return no_go; /* Should use a wrapper function... */
     }
 
@@ -1184,6 +1430,7 @@ static void slab_rebalance_finish(void) {
 
     free(slab_rebal.completed);
     pthread_mutex_unlock(&slabs_lock);
+    slab_cache_resume();
 
     STATS_LOCK();
     stats.slabs_moved++;
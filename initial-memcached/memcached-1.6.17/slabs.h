@@ -46,6 +46,9 @@ void slabs_stats(ADD_STAT add_stats, void *c);
 /* Hints as to freespace in slab class */
 unsigned int slabs_available_chunks(unsigned int id, bool *mem_flag, unsigned int *chunks_perslab);
 
+/** Set up the calling worker thread's cache of free chunks */
+void slabs_cache_thread_init(void);
+
 void slabs_mlock(void);
 void slabs_munlock(void);
 
@@ -6,57 +6,88 @@
 #include <string.h>
 #include <assert.h>
 
-/* Hash table that uses the global hash function */
-static PREFIX_STATS *prefix_stats[PREFIX_HASH_SIZE];
+/* Hash table that uses the global hash function. */
+typedef struct _prefix_table PREFIX_TABLE;
+struct _prefix_table {
+    PREFIX_STATS *buckets[PREFIX_HASH_SIZE];
+    int num_prefixes;
+    int total_prefix_size;
+    pthread_mutex_t mutex;  /* only used by per-thread tables */
+    PREFIX_TABLE *next;
+};
+
+/* Used by threads without their own table. Protected by STATS_LOCK. */
+static PREFIX_TABLE global_prefixes;
+
+/* Worker threads count into their own tables, so the request path never
+ * takes STATS_LOCK. Tables are merged when dumped. */
+static pthread_key_t prefix_table_key;
+static pthread_mutex_t prefix_tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static PREFIX_TABLE *prefix_tables = NULL;
 
 static char prefix_delimiter;
-static int num_prefixes = 0;
-static int total_prefix_size = 0;
 
 void stats_prefix_init(char delimiter) {
     prefix_delimiter = delimiter;
-    memset(prefix_stats, 0, sizeof(prefix_stats));
+    memset(&global_prefixes, 0, sizeof(global_prefixes));
+    pthread_key_create(&prefix_table_key, NULL);
 }
 
-void stats_prefix_clear(void) {
+void stats_prefix_thread_init(void) {
+    PREFIX_TABLE *t = calloc(1, sizeof(PREFIX_TABLE));
+    if (t == NULL) {
+        fprintf(stderr, "Failed to allocate prefix stats table\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&t->mutex, NULL);
+
+    pthread_mutex_lock(&prefix_tables_lock);
+    t->next = prefix_tables;
+    prefix_tables = t;
+    pthread_mutex_unlock(&prefix_tables_lock);
+
+    pthread_setspecific(prefix_table_key, t);
+}
+
+static void prefix_table_clear(PREFIX_TABLE *t) {
     int i;
 
     for (i = 0; i < PREFIX_HASH_SIZE; i++) {
         PREFIX_STATS *cur, *next;
-        for (cur = prefix_stats[i]; cur != NULL; cur = next) {
+        for (cur = t->buckets[i]; cur != NULL; cur = next) {
             next = cur->next;
             free(cur->prefix);
             free(cur);
         }
-        prefix_stats[i] = NULL;
+        t->buckets[i] = NULL;
     }
-    num_prefixes = 0;
-    total_prefix_size = 0;
+    t->num_prefixes = 0;
+    t->total_prefix_size = 0;
 }
 
-PREFIX_STATS *stats_prefix_find(const char *key, const size_t nkey) {
-    PREFIX_STATS *pfs;
-    uint32_t hashval;
-    size_t length;
-    bool bailout = true;
+void stats_prefix_clear(void) {
+    PREFIX_TABLE *t;
 
-    assert(key != NULL);
+    prefix_table_clear(&global_prefixes);
 
-    for (length = 0; length < nkey && key[length] != '\0'; length++) {
-        if (key[length] == prefix_delimiter) {
-            bailout = false;
-            break;
-        }
+    pthread_mutex_lock(&prefix_tables_lock);
+    for (t = prefix_tables; t != NULL; t = t->next) {
+        pthread_mutex_lock(&t->mutex);
+        prefix_table_clear(t);
+        pthread_mutex_unlock(&t->mutex);
     }
+    pthread_mutex_unlock(&prefix_tables_lock);
+}
 
-    if (bailout) {
-        return NULL;
-    }
+static PREFIX_STATS *prefix_table_find(PREFIX_TABLE *t, const char *key,
+        const size_t length) {
+    PREFIX_STATS *pfs;
+    uint32_t hashval;
 
     hashval = hash(key, length) % PREFIX_HASH_SIZE;
 
-    for (pfs = prefix_stats[hashval]; NULL != pfs; pfs = pfs->next) {
-        if (strncmp(pfs->prefix, key, length) == 0)
+    for (pfs = t->buckets[hashval]; NULL != pfs; pfs = pfs->next) {
+        if (pfs->prefix_len == length && strncmp(pfs->prefix, key, length) == 0)
             return pfs;
     }
 
@@ -77,81 +108,177 @@ PREFIX_STATS *stats_prefix_find(const char *key, const size_t nkey) {
     pfs->prefix[length] = '\0';      /* because strncpy() sucks */
     pfs->prefix_len = length;
 
-    pfs->next = prefix_stats[hashval];
-    prefix_stats[hashval] = pfs;
+    pfs->next = t->buckets[hashval];
+    t->buckets[hashval] = pfs;
 
-    num_prefixes++;
-    total_prefix_size += length;
+    t->num_prefixes++;
+    t->total_prefix_size += length;
 
     return pfs;
 }
 
+/* Finds the length of the key's prefix. Returns false if it has none. */
+static bool prefix_length(const char *key, const size_t nkey, size_t *length) {
+    size_t x;
+
+    assert(key != NULL);
+
+    for (x = 0; x < nkey && key[x] != '\0'; x++) {
+        if (key[x] == prefix_delimiter) {
+            *length = x;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+PREFIX_STATS *stats_prefix_find(const char *key, const size_t nkey) {
+    size_t length;
+
+    if (!prefix_length(key, nkey, &length)) {
+        return NULL;
+    }
+
+    return prefix_table_find(&global_prefixes, key, length);
+}
+
+/* Returns the caller's table, locked, and the prefix entry for the key. */
+static PREFIX_STATS *prefix_lock_find(const char *key, const size_t nkey,
+        PREFIX_TABLE **locked) {
+    PREFIX_TABLE *t = pthread_getspecific(prefix_table_key);
+    PREFIX_STATS *pfs;
+
+    if (t == NULL) {
+        STATS_LOCK();
+        pfs = stats_prefix_find(key, nkey);
+    } else {
+        size_t length;
+        pthread_mutex_lock(&t->mutex);
+        if (prefix_length(key, nkey, &length)) {
+            pfs = prefix_table_find(t, key, length);
+        } else {
+            pfs = NULL;
+        }
+    }
+
+    *locked = t;
+    return pfs;
+}
+
+static void prefix_unlock(PREFIX_TABLE *t) {
+    if (t == NULL) {
+        STATS_UNLOCK();
+    } else {
+        pthread_mutex_unlock(&t->mutex);
+    }
+}
+
 void stats_prefix_record_get(const char *key, const size_t nkey, const bool is_hit) {
     PREFIX_STATS *pfs;
+    PREFIX_TABLE *t;
 
-    STATS_LOCK();
-    pfs = stats_prefix_find(key, nkey);
+    pfs = prefix_lock_find(key, nkey, &t);
     if (NULL != pfs) {
         pfs->num_gets++;
         if (is_hit) {
             pfs->num_hits++;
         }
     }
-    STATS_UNLOCK();
+    prefix_unlock(t);
 }
 
 void stats_prefix_record_delete(const char *key, const size_t nkey) {
     PREFIX_STATS *pfs;
+    PREFIX_TABLE *t;
 
-    STATS_LOCK();
-    pfs = stats_prefix_find(key, nkey);
+    pfs = prefix_lock_find(key, nkey, &t);
     if (NULL != pfs) {
         pfs->num_deletes++;
     }
-    STATS_UNLOCK();
+    prefix_unlock(t);
 }
 
 void stats_prefix_record_set(const char *key, const size_t nkey) {
     PREFIX_STATS *pfs;
+    PREFIX_TABLE *t;
 
-    STATS_LOCK();
-    pfs = stats_prefix_find(key, nkey);
+    pfs = prefix_lock_find(key, nkey, &t);
     if (NULL != pfs) {
         pfs->num_sets++;
     }
-    STATS_UNLOCK();
+    prefix_unlock(t);
+}
+
+/* Adds every entry of src into dst. */
+static bool prefix_table_merge(PREFIX_TABLE *dst, PREFIX_TABLE *src) {
+    PREFIX_STATS *pfs, *d;
+    int i;
+
+    for (i = 0; i < PREFIX_HASH_SIZE; i++) {
+        for (pfs = src->buckets[i]; NULL != pfs; pfs = pfs->next) {
+            d = prefix_table_find(dst, pfs->prefix, pfs->prefix_len);
+            if (d == NULL)
+                return false;
+            d->num_gets += pfs->num_gets;
+            d->num_hits += pfs->num_hits;
+            d->num_sets += pfs->num_sets;
+            d->num_deletes += pfs->num_deletes;
+        }
+    }
+    return true;
 }
 
 char *stats_prefix_dump(int *length) {
     const char *format = "PREFIX %s get %llu hit %llu set %llu del %llu\r\n";
     PREFIX_STATS *pfs;
+    PREFIX_TABLE merged, *t;
+    bool ok;
     char *buf;
     int i, pos;
     size_t size = 0, written = 0;
 #ifndef NDEBUG
     size_t total_written = 0;
 #endif
+
+    memset(&merged, 0, sizeof(merged));
+    STATS_LOCK();
+    ok = prefix_table_merge(&merged, &global_prefixes);
+    STATS_UNLOCK();
+
+    pthread_mutex_lock(&prefix_tables_lock);
+    for (t = prefix_tables; t != NULL && ok; t = t->next) {
+        pthread_mutex_lock(&t->mutex);
+        ok = prefix_table_merge(&merged, t);
+        pthread_mutex_unlock(&t->mutex);
+    }
+    pthread_mutex_unlock(&prefix_tables_lock);
+
+    if (!ok) {
+        prefix_table_clear(&merged);
+        return NULL;
+    }
+
     /*
      * Figure out how big the buffer needs to be. This is the sum of the
      * lengths of the prefixes themselves, plus the size of one copy of
      * the per-prefix output with 20-digit values for all the counts,
      * plus space for the "END" at the end.
      */
-    STATS_LOCK();
-    size = strlen(format) + total_prefix_size +
-           num_prefixes * (strlen(format) - 2 /* %s */
+    size = strlen(format) + merged.total_prefix_size +
+           merged.num_prefixes * (strlen(format) - 2 /* %s */
                            + 4 * (20 - 4)) /* %llu replaced by 20-digit num */
                            + sizeof("END\r\n");
     buf = malloc(size);
     if (NULL == buf) {
         perror("Can't allocate stats response: malloc");
-        STATS_UNLOCK();
+        prefix_table_clear(&merged);
         return NULL;
     }
 
     pos = 0;
     for (i = 0; i < PREFIX_HASH_SIZE; i++) {
-        for (pfs = prefix_stats[i]; NULL != pfs; pfs = pfs->next) {
+        for (pfs = merged.buckets[i]; NULL != pfs; pfs = pfs->next) {
             written = snprintf(buf + pos, size-pos, format,
                            pfs->prefix, pfs->num_gets, pfs->num_hits,
                            pfs->num_sets, pfs->num_deletes);
@@ -163,7 +290,7 @@ char *stats_prefix_dump(int *length) {
         }
     }
 
-    STATS_UNLOCK();
+    prefix_table_clear(&merged);
     memcpy(buf + pos, "END\r\n", 6);
 
     *length = pos + 5;
@@ -16,8 +16,13 @@
  */
 void stats_prefix_init(char prefix_delimiter);
 
-/* Clear previously collected stats. Requires you to have the acquired
- * the STATS_LOCK() first.
+/* Give the calling worker thread its own table, so recording doesn't need
+ * STATS_LOCK(). Threads that don't call this share a global table.
+ */
+void stats_prefix_thread_init(void);
+
+/* Clear previously collected stats, including every thread's table.
+ * Requires you to have the acquired the STATS_LOCK() first.
  */
 void stats_prefix_clear(void);
 
@@ -49,8 +54,8 @@ struct _prefix_stats {
     PREFIX_STATS *next;
 };
 
-/* Return the PREFIX_STATS structure for the specified key, creating it if
- * it does not already exist. Returns NULL if the key does not contain
+/* Return the PREFIX_STATS structure for the specified key from the global
+ * table, creating it if it does not already exist. Returns NULL if the key does not contain
  * prefix delimiter, or if there was an error. Requires you to have acquired
  * STATS_LOCK() first.
  */
@@ -15,6 +15,8 @@
 #define PAGE_BUCKET_COMPACT 1
 #define PAGE_BUCKET_CHUNKED 2
 #define PAGE_BUCKET_LOWTTL  3
+#define PAGE_BUCKET_TTL     4 /* first of ext_ttl_buckets bands */
+#define MAX_STORAGE_TTL_BUCKETS 8
 
 /*
  * API functions
@@ -34,8 +36,24 @@ typedef struct _io_pending_storage_t {
     bool miss;                /* signal a miss to unlink hdr_it */
     bool badcrc;              /* signal a crc failure */
     bool active;              /* tells if IO was dispatched or not */
+    uint64_t start_us;        /* when the read was submitted */
 } io_pending_storage_t;
 
+// Smoothed latency of foreground reads, written by the IO threads. Used to
+// back compaction off when reads slow down.
+static uint64_t storage_read_lat_us = 0;
+
+static uint64_t storage_now_us(void) {
+    return thread_clock_ns() / 1000;
+}
+
+static void storage_read_lat_sample(uint64_t us) {
+    uint64_t lat = __atomic_load_n(&storage_read_lat_us, __ATOMIC_RELAXED);
+    // 1/16th weight. racing IO threads can lose a sample, which is fine.
+    lat = lat == 0 ? us : lat - lat / 16 + us / 16;
+    __atomic_store_n(&storage_read_lat_us, lat, __ATOMIC_RELAXED);
+}
+
 // Only call this if item has ITEM_HDR
 bool storage_validate_item(void *e, item *it) {
     item_hdr *hdr = (item_hdr *)ITEM_data(it);
@@ -97,7 +115,14 @@ void storage_stats(ADD_STAT add_stats, conn *c) {
         APPEND_STAT("extstore_compact_lost", "%llu", (unsigned long long)stats.extstore_compact_lost);
         APPEND_STAT("extstore_compact_rescues", "%llu", (unsigned long long)stats.extstore_compact_rescues);
         APPEND_STAT("extstore_compact_skipped", "%llu", (unsigned long long)stats.extstore_compact_skipped);
+        APPEND_STAT("extstore_compact_bytes", "%llu", (unsigned long long)stats.extstore_compact_bytes);
+        APPEND_STAT("extstore_compact_pages", "%llu", (unsigned long long)stats.extstore_compact_pages);
+        APPEND_STAT("extstore_compact_throttled", "%llu", (unsigned long long)stats.extstore_compact_throttled);
+        APPEND_STAT("extstore_compact_active", "%u", stats_state.extstore_compact_active);
+        APPEND_STAT("extstore_compact_rate", "%llu", (unsigned long long)stats_state.extstore_compact_rate);
         STATS_UNLOCK();
+        APPEND_STAT("extstore_read_latency_us", "%llu",
+                (unsigned long long)__atomic_load_n(&storage_read_lat_us, __ATOMIC_RELAXED));
         extstore_get_stats(c->thread->storage, &st);
         APPEND_STAT("extstore_page_allocs", "%llu", (unsigned long long)st.page_allocs);
         APPEND_STAT("extstore_page_evictions", "%llu", (unsigned long long)st.page_evictions);
@@ -107,10 +132,13 @@ void storage_stats(ADD_STAT add_stats, conn *c) {
         APPEND_STAT("extstore_objects_evicted", "%llu", (unsigned long long)st.objects_evicted);
         APPEND_STAT("extstore_objects_read", "%llu", (unsigned long long)st.objects_read);
         APPEND_STAT("extstore_objects_written", "%llu", (unsigned long long)st.objects_written);
+        APPEND_STAT("extstore_write_batches", "%llu", (unsigned long long)st.write_batches);
         APPEND_STAT("extstore_objects_used", "%llu", (unsigned long long)st.objects_used);
         APPEND_STAT("extstore_bytes_evicted", "%llu", (unsigned long long)st.bytes_evicted);
         APPEND_STAT("extstore_bytes_written", "%llu", (unsigned long long)st.bytes_written);
         APPEND_STAT("extstore_bytes_read", "%llu", (unsigned long long)st.bytes_read);
+        APPEND_STAT("extstore_reads_skipped", "%llu", (unsigned long long)st.reads_skipped);
+        APPEND_STAT("extstore_bytes_skipped", "%llu", (unsigned long long)st.bytes_skipped);
         APPEND_STAT("extstore_bytes_used", "%llu", (unsigned long long)st.bytes_used);
         APPEND_STAT("extstore_bytes_fragmented", "%llu", (unsigned long long)st.bytes_fragmented);
         APPEND_STAT("extstore_limit_maxbytes", "%llu", (unsigned long long)(st.page_count * st.page_size));
@@ -138,6 +166,7 @@ static void _storage_get_item_cb(void *e, obj_io *io, int ret) {
     if (ret < 1) {
         miss = true;
     } else {
+        storage_read_lat_sample(storage_now_us() - p->start_us);
         uint32_t crc2;
         uint32_t crc = (uint32_t) read_it->exptime;
         int x;
@@ -369,8 +398,29 @@ int storage_get_item(conn *c, item *it, mc_resp *resp) {
 }
 
 void storage_submit_cb(io_queue_t *q) {
-    // Don't need to do anything special for extstore.
-    extstore_submit(q->ctx, q->stack_ctx);
+    // stamp the batch so the callbacks can measure read latency.
+    uint64_t now = storage_now_us();
+    obj_io *live = NULL;
+    obj_io **tail = &live;
+    obj_io *io = q->stack_ctx;
+    while (io != NULL) {
+        obj_io *next = io->next;
+        if (extstore_check_read(q->ctx, io) == 0) {
+            ((io_pending_storage_t *)io->data)->start_us = now;
+            *tail = io;
+            tail = &io->next;
+        } else {
+            // header points at a recycled page or garbage: answer with a
+            // miss right here instead of sending it through an IO thread.
+            io->next = NULL;
+            io->cb(q->ctx, io, -2);
+        }
+        io = next;
+    }
+    *tail = NULL;
+    if (live != NULL) {
+        extstore_submit(q->ctx, live);
+    }
 }
 
 static void recache_or_free(io_pending_t *pending) {
@@ -473,99 +523,194 @@ void storage_finalize_cb(io_pending_t *pending) {
  * WRITE FLUSH THREAD
  */
 
+// Items pulled from the tail per pass. Items being flushed stay locked in the
+// tail and lru_pull_tail() only searches a few deep, so keep this small.
+#define STORAGE_WRITE_BATCH 4
+// Width of the first TTL band; each band after it is this many times wider.
+#define STORAGE_TTL_BUCKET_BASE 3600
+#define STORAGE_TTL_BUCKET_SCALE 4
+
+struct storage_write_item {
+    item *it;
+    item *hdr_it;
+    uint32_t hv;
+    int bucket;
+    bool queued;
+    bool written;
+    obj_io io;
+};
+
+// Pick a page bucket so objects sharing a page tend to die together.
+static int storage_write_bucket(item *it) {
+    if (it->it_flags & ITEM_CHUNKED)
+        return PAGE_BUCKET_CHUNKED;
+    if (it->exptime == 0)
+        return PAGE_BUCKET_DEFAULT;
+
+    rel_time_t ttl = it->exptime - current_time;
+    // Compress soon to expire items into similar pages.
+    if (ttl < settings.ext_low_ttl)
+        return PAGE_BUCKET_LOWTTL;
+    if (settings.ext_ttl_buckets == 0)
+        return PAGE_BUCKET_DEFAULT;
+
+    unsigned int band = 0;
+    uint64_t limit = STORAGE_TTL_BUCKET_BASE;
+    while (band < settings.ext_ttl_buckets - 1 && ttl >= limit) {
+        band++;
+        limit *= STORAGE_TTL_BUCKET_SCALE;
+    }
+    return PAGE_BUCKET_TTL + band;
+}
+
+static void storage_write_copy(item *it, uint32_t hv, obj_io *io) {
+    size_t orig_ntotal = io->len;
+    // cuddle the hash value into the time field so we don't have
+    // to recalculate it.
+    item *buf_it = (item *) io->buf;
+    buf_it->time = hv;
+    // copy from past the headers + time headers.
+    // TODO: should be in items.c
+    if (it->it_flags & ITEM_CHUNKED) {
+        // Need to loop through the item and copy
+        item_chunk *sch = (item_chunk *) ITEM_schunk(it);
+        int remain = orig_ntotal;
+        int copied = 0;
+        // copy original header
+        int hdrtotal = ITEM_ntotal(it) - it->nbytes;
+        memcpy((char *)io->buf+STORE_OFFSET, (char *)it+STORE_OFFSET, hdrtotal - STORE_OFFSET);
+        copied = hdrtotal;
+        // copy data in like it were one large object.
+        while (sch && remain) {
+            assert(remain >= sch->used);
+            memcpy((char *)io->buf+copied, sch->data, sch->used);
+            // FIXME: use one variable?
+            remain -= sch->used;
+            copied += sch->used;
+            sch = sch->next;
+        }
+    } else {
+        memcpy((char *)io->buf+STORE_OFFSET, (char *)it+STORE_OFFSET, io->len-STORE_OFFSET);
+    }
+    // crc what we copied so we can do it sequentially.
+    buf_it->it_flags &= ~ITEM_LINKED;
+    buf_it->exptime = crc32c(0, (char*)io->buf+STORE_OFFSET, orig_ntotal-STORE_OFFSET);
+}
+
+// Returns the number of items moved to storage.
 static int storage_write(void *storage, const int clsid, const int item_age) {
+    struct storage_write_item wi[STORAGE_WRITE_BATCH];
+    int count = 0;
     int did_moves = 0;
-    struct lru_pull_tail_return it_info;
 
-    it_info.it = NULL;
-    lru_pull_tail(clsid, COLD_LRU, 0, LRU_PULL_RETURN_ITEM, 0, &it_info);
-    /* Item is locked, and we have a reference to it. */
-    if (it_info.it == NULL) {
-        return did_moves;
-    }
+    // Read ahead a few items so small ones can share a page lock. Each one
+    // is locked and we hold a reference to it.
+    while (count < STORAGE_WRITE_BATCH) {
+        struct lru_pull_tail_return it_info;
+        item *hdr_it = NULL;
+
+        it_info.it = NULL;
+        lru_pull_tail(clsid, COLD_LRU, 0, LRU_PULL_RETURN_ITEM, 0, &it_info);
+        if (it_info.it == NULL) {
+            break;
+        }
+
+        item *it = it_info.it;
+        uint32_t flags;
+        if ((it->it_flags & ITEM_HDR) == 0 &&
+                (item_age == 0 || current_time - it->time > item_age)) {
+            FLAGS_CONV(it, flags);
+            hdr_it = do_item_alloc(ITEM_key(it), it->nkey, flags, it->exptime, sizeof(item_hdr));
+        }
+        if (hdr_it == NULL) {
+            do_item_remove(it);
+            item_unlock(it_info.hv);
+            break;
+        }
 
-    obj_io io;
-    item *it = it_info.it;
-    /* First, storage for the header object */
-    size_t orig_ntotal = ITEM_ntotal(it);
-    uint32_t flags;
-    if ((it->it_flags & ITEM_HDR) == 0 &&
-            (item_age == 0 || current_time - it->time > item_age)) {
-        FLAGS_CONV(it, flags);
-        item *hdr_it = do_item_alloc(ITEM_key(it), it->nkey, flags, it->exptime, sizeof(item_hdr));
         /* Run the storage write understanding the start of the item is dirty.
          * We will fill it (time/exptime/etc) from the header item on read.
          */
-        if (hdr_it != NULL) {
-            int bucket = (it->it_flags & ITEM_CHUNKED) ?
-                PAGE_BUCKET_CHUNKED : PAGE_BUCKET_DEFAULT;
-            // Compress soon to expire items into similar pages.
-            if (it->exptime - current_time < settings.ext_low_ttl) {
-                bucket = PAGE_BUCKET_LOWTTL;
+        hdr_it->it_flags |= ITEM_HDR;
+        // NOTE: when the item is read back in, the slab mover
+        // may see it. Important to have refcount>=2 or ~ITEM_LINKED
+        assert(it->refcount >= 2);
+        struct storage_write_item *w = &wi[count++];
+        w->it = it;
+        w->hdr_it = hdr_it;
+        w->hv = it_info.hv;
+        w->bucket = storage_write_bucket(it);
+        w->queued = false;
+        w->written = false;
+        w->io.len = ITEM_ntotal(it);
+        w->io.mode = OBJ_IO_WRITE;
+        w->io.data = w;
+    }
+
+    // Write out a bucket at a time. Each request hands back space for as many
+    // of that bucket's items as fit in its current write buffer.
+    for (int x = 0; x < count; x++) {
+        int bucket = wi[x].bucket;
+        obj_io *stack = NULL;
+        obj_io **tail = &stack;
+        if (wi[x].queued)
+            continue;
+        for (int y = x; y < count; y++) {
+            if (wi[y].bucket == bucket) {
+                wi[y].queued = true;
+                *tail = &wi[y].io;
+                tail = &wi[y].io.next;
             }
-            hdr_it->it_flags |= ITEM_HDR;
-            io.len = orig_ntotal;
-            io.mode = OBJ_IO_WRITE;
-            // NOTE: when the item is read back in, the slab mover
-            // may see it. Important to have refcount>=2 or ~ITEM_LINKED
-            assert(it->refcount >= 2);
+        }
+        *tail = NULL;
+
+        while (stack) {
             // NOTE: write bucket vs free page bucket will disambiguate once
             // lowttl feature is better understood.
-            if (extstore_write_request(storage, bucket, bucket, &io) == 0) {
-                // cuddle the hash value into the time field so we don't have
-                // to recalculate it.
-                item *buf_it = (item *) io.buf;
-                buf_it->time = it_info.hv;
-                // copy from past the headers + time headers.
-                // TODO: should be in items.c
-                if (it->it_flags & ITEM_CHUNKED) {
-                    // Need to loop through the item and copy
-                    item_chunk *sch = (item_chunk *) ITEM_schunk(it);
-                    int remain = orig_ntotal;
-                    int copied = 0;
-                    // copy original header
-                    int hdrtotal = ITEM_ntotal(it) - it->nbytes;
-                    memcpy((char *)io.buf+STORE_OFFSET, (char *)it+STORE_OFFSET, hdrtotal - STORE_OFFSET);
-                    copied = hdrtotal;
-                    // copy data in like it were one large object.
-                    while (sch && remain) {
-                        assert(remain >= sch->used);
-                        memcpy((char *)io.buf+copied, sch->data, sch->used);
-                        // FIXME: use one variable?
-                        remain -= sch->used;
-                        copied += sch->used;
-                        sch = sch->next;
-                    }
-                } else {
-                    memcpy((char *)io.buf+STORE_OFFSET, (char *)it+STORE_OFFSET, io.len-STORE_OFFSET);
-                }
-                // crc what we copied so we can do it sequentially.
-                buf_it->it_flags &= ~ITEM_LINKED;
-                buf_it->exptime = crc32c(0, (char*)io.buf+STORE_OFFSET, orig_ntotal-STORE_OFFSET);
-                extstore_write(storage, &io);
+            int ready = extstore_write_request_batch(storage, bucket, bucket, stack);
+            if (ready < 0) {
+                /* Failed to write for some reason, can't continue. */
+                break;
+            }
+            obj_io *io = stack;
+            for (int y = 0; y < ready; y++, io = io->next) {
+                struct storage_write_item *w = io->data;
+                storage_write_copy(w->it, w->hv, io);
+            }
+            extstore_write_batch(storage, stack, ready);
+
+            for (int y = 0; y < ready; y++, stack = stack->next) {
+                struct storage_write_item *w = stack->data;
+                item *it = w->it;
+                item *hdr_it = w->hdr_it;
                 item_hdr *hdr = (item_hdr *) ITEM_data(hdr_it);
-                hdr->page_version = io.page_version;
-                hdr->page_id = io.page_id;
-                hdr->offset  = io.offset;
+                hdr->page_version = stack->page_version;
+                hdr->page_id = stack->page_id;
+                hdr->offset  = stack->offset;
                 // overload nbytes for the header it
                 hdr_it->nbytes = it->nbytes;
                 /* success! Now we need to fill relevant data into the new
                  * header and replace. Most of this requires the item lock
                  */
                 /* CAS gets set while linking. Copy post-replace */
-                item_replace(it, hdr_it, it_info.hv);
+                item_replace(it, hdr_it, w->hv);
                 ITEM_set_cas(hdr_it, ITEM_get_cas(it));
                 do_item_remove(hdr_it);
-                did_moves = 1;
+                w->written = true;
+                did_moves++;
                 LOGGER_LOG(NULL, LOG_EVICTIONS, LOGGER_EXTSTORE_WRITE, it, bucket);
-            } else {
-                /* Failed to write for some reason, can't continue. */
-                slabs_free(hdr_it, ITEM_ntotal(hdr_it), ITEM_clsid(hdr_it));
             }
         }
     }
-    do_item_remove(it);
-    item_unlock(it_info.hv);
+
+    for (int x = 0; x < count; x++) {
+        struct storage_write_item *w = &wi[x];
+        if (!w->written) {
+            slabs_free(w->hdr_it, ITEM_ntotal(w->hdr_it), ITEM_clsid(w->hdr_it));
+        }
+        do_item_remove(w->it);
+        item_unlock(w->hv);
+    }
     return did_moves;
 }
 
@@ -624,8 +769,9 @@ static void *storage_write_thread(void *arg) {
                 } else {
                     item_age = settings.ext_item_age;
                 }
-                if (storage_write(storage, x, item_age)) {
-                    chunks_free++; // Allow stopping if we've done enough this loop
+                int moved = storage_write(storage, x, item_age);
+                if (moved) {
+                    chunks_free += moved; // Allow stopping if we've done enough this loop
                     did_move = true;
                     if (to_sleep > WRITE_SLEEP_MIN)
                         to_sleep /= 2;
@@ -697,8 +843,8 @@ int start_storage_write_thread(void *arg) {
  * compaction, up to a desired target when all pages are full.
  */
 static int storage_compact_check(void *storage, logger *l,
-        uint32_t *page_id, uint64_t *page_version,
-        uint64_t *page_size, bool *drop_unread) {
+        uint32_t *page_id, uint64_t *page_version, unsigned int *bucket,
+        uint64_t *page_size, bool *drop_unread, const bool *busy) {
     struct extstore_stats st;
     int x;
     double rate;
@@ -707,6 +853,8 @@ static int storage_compact_check(void *storage, logger *l,
     uint64_t lowest_version = ULLONG_MAX;
     unsigned int low_page = 0;
     unsigned int lowest_page = 0;
+    unsigned int low_bucket = 0;
+    unsigned int lowest_bucket = 0;
     extstore_get_stats(storage, &st);
     if (st.pages_used == 0)
         return 0;
@@ -727,18 +875,22 @@ static int storage_compact_check(void *storage, logger *l,
     extstore_get_page_data(storage, &st);
 
     // find oldest page by version that violates the constraint
+    // low TTL pages empty out as their items expire; compacting them would
+    // just mix their items into the compact bucket.
     for (x = 0; x < st.page_count; x++) {
         if (st.page_data[x].version == 0 ||
-            st.page_data[x].bucket == PAGE_BUCKET_LOWTTL)
+            st.page_data[x].bucket == PAGE_BUCKET_LOWTTL || busy[x])
             continue;
         if (st.page_data[x].version < lowest_version) {
             lowest_page = x;
             lowest_version = st.page_data[x].version;
+            lowest_bucket = st.page_data[x].bucket;
         }
         if (st.page_data[x].bytes_used < frag_limit) {
             if (st.page_data[x].version < low_version) {
                 low_page = x;
                 low_version = st.page_data[x].version;
+                low_bucket = st.page_data[x].bucket;
             }
         }
     }
@@ -749,6 +901,7 @@ static int storage_compact_check(void *storage, logger *l,
     if (low_version != ULLONG_MAX) {
         *page_id = low_page;
         *page_version = low_version;
+        *bucket = low_bucket;
         return 1;
     } else if (lowest_version != ULLONG_MAX && settings.ext_drop_unread
             && st.pages_free <= settings.ext_drop_under) {
@@ -756,6 +909,7 @@ static int storage_compact_check(void *storage, logger *l,
         // version if we're configured to drop items.
         *page_id = lowest_page;
         *page_version = lowest_version;
+        *bucket = lowest_bucket;
         *drop_unread = true;
         return 1;
     }
@@ -766,22 +920,52 @@ static int storage_compact_check(void *storage, logger *l,
 static pthread_t storage_compact_tid;
 static pthread_mutex_t storage_compact_plock;
 #define MIN_STORAGE_COMPACT_SLEEP 10000
+#define MAX_STORAGE_COMPACT_STREAMS 16
+// when reads are slow, don't throttle compaction below 1/16th of its rate.
+#define MIN_STORAGE_COMPACT_RATE_DIV 16
 
+// One compaction stream: a page being read back a wbuf at a time.
 struct storage_compact_wrap {
     obj_io io;
     pthread_mutex_t lock; // gates the bools.
     bool done;
     bool submitted;
     bool miss; // version flipped out from under us
+    bool compacting;
+    bool drop_unread;
+    bool throttled; // waiting on the rate limit
+    uint32_t page_id;
+    uint64_t page_version;
+    uint64_t page_offset;
+    unsigned int bucket; // bucket the page was written to
+    char *readback_buf;
+};
+
+// Token bucket for compaction reads, in bytes.
+struct storage_compact_limit {
+    uint64_t tokens;
+    uint64_t last; // usec timestamp of last refill
+    uint64_t rate; // bytes per second after adjusting for read latency
 };
 
+// Items rescued from a TTL band page go back into the same band, so the
+// band's pages keep emptying out together. Everything else is rewritten into
+// the compact bucket.
+static unsigned int storage_compact_bucket(unsigned int bucket) {
+    if (bucket >= PAGE_BUCKET_TTL &&
+            bucket < PAGE_BUCKET_TTL + settings.ext_ttl_buckets)
+        return bucket;
+    return PAGE_BUCKET_COMPACT;
+}
+
 static void storage_compact_readback(void *storage, logger *l,
-        bool drop_unread, char *readback_buf,
+        bool drop_unread, char *readback_buf, unsigned int page_bucket,
         uint32_t page_id, uint64_t page_version, uint64_t read_size) {
     uint64_t offset = 0;
     unsigned int rescues = 0;
     unsigned int lost = 0;
     unsigned int skipped = 0;
+    unsigned int bucket = storage_compact_bucket(page_bucket);
 
     while (offset < read_size) {
         item *hdr_it = NULL;
@@ -826,7 +1010,7 @@ static void storage_compact_readback(void *storage, logger *l,
                 io.len = ntotal;
                 io.mode = OBJ_IO_WRITE;
                 for (tries = 10; tries > 0; tries--) {
-                    if (extstore_write_request(storage, PAGE_BUCKET_COMPACT, PAGE_BUCKET_COMPACT, &io) == 0) {
+                    if (extstore_write_request(storage, bucket, bucket, &io) == 0) {
                         memcpy(io.buf, it, io.len);
                         extstore_write(storage, &io);
                         do_update = true;
@@ -883,20 +1067,46 @@ static void _storage_compact_cb(void *e, obj_io *io, int ret) {
     pthread_mutex_unlock(&wrap->lock);
 }
 
+// Refill the token bucket. A configured rate is scaled down by how far the
+// foreground read latency is over its target.
+static void storage_compact_refill(struct storage_compact_limit *lim) {
+    uint64_t now = storage_now_us();
+    uint64_t elapsed = now - lim->last;
+    uint64_t rate = (uint64_t)settings.ext_compact_rate * 1024 * 1024;
+    uint64_t lat = __atomic_load_n(&storage_read_lat_us, __ATOMIC_RELAXED);
+    lim->last = now;
+
+    if (rate == 0) {
+        lim->rate = 0;
+        return;
+    }
+    if (settings.ext_compact_read_lat && lat > settings.ext_compact_read_lat) {
+        uint64_t floor = rate / MIN_STORAGE_COMPACT_RATE_DIV;
+        rate = rate * settings.ext_compact_read_lat / lat;
+        if (rate < floor)
+            rate = floor;
+    }
+    lim->rate = rate;
+
+    // allow at most a second of burst, but always enough for one read.
+    uint64_t max = rate > settings.ext_wbuf_size ? rate : settings.ext_wbuf_size;
+    lim->tokens += rate * elapsed / 1000000;
+    if (lim->tokens > max)
+        lim->tokens = max;
+}
+
 // TODO: hoist the storage bits from lru_maintainer_thread in here.
 // would be nice if they could avoid hammering the same locks though?
 // I guess it's only COLD. that's probably fine.
 static void *storage_compact_thread(void *arg) {
     void *storage = arg;
     useconds_t to_sleep = settings.ext_max_sleep;
-    bool compacting = false;
-    uint64_t page_version = 0;
     uint64_t page_size = 0;
-    uint64_t page_offset = 0;
-    uint32_t page_id = 0;
-    bool drop_unread = false;
-    char *readback_buf = NULL;
-    struct storage_compact_wrap wrap;
+    struct storage_compact_wrap wraps[MAX_STORAGE_COMPACT_STREAMS];
+    struct storage_compact_limit lim = {0};
+    struct extstore_stats st;
+    unsigned int streams = settings.ext_compact_streams;
+    bool *busy;
 
     logger *l = logger_create();
     if (l == NULL) {
@@ -904,76 +1114,133 @@ static void *storage_compact_thread(void *arg) {
         abort();
     }
 
-    readback_buf = malloc(settings.ext_wbuf_size);
-    if (readback_buf == NULL) {
-        fprintf(stderr, "Failed to allocate readback buffer for storage compaction thread\n");
+    // pages being worked on, so streams don't pick the same one.
+    extstore_get_stats(storage, &st);
+    busy = calloc(st.page_count, sizeof(bool));
+    if (busy == NULL) {
+        fprintf(stderr, "Failed to allocate page list for storage compaction thread\n");
         abort();
     }
 
-    pthread_mutex_init(&wrap.lock, NULL);
-    wrap.done = false;
-    wrap.submitted = false;
-    wrap.io.data = &wrap;
-    wrap.io.iov = NULL;
-    wrap.io.buf = (void *)readback_buf;
+    memset(wraps, 0, sizeof(wraps));
+    for (int x = 0; x < streams; x++) {
+        struct storage_compact_wrap *wrap = &wraps[x];
+        wrap->readback_buf = malloc(settings.ext_wbuf_size);
+        if (wrap->readback_buf == NULL) {
+            fprintf(stderr, "Failed to allocate readback buffer for storage compaction thread\n");
+            abort();
+        }
+
+        pthread_mutex_init(&wrap->lock, NULL);
+        wrap->io.data = wrap;
+        wrap->io.iov = NULL;
+        wrap->io.buf = (void *)wrap->readback_buf;
 
-    wrap.io.len = settings.ext_wbuf_size;
-    wrap.io.mode = OBJ_IO_READ;
-    wrap.io.cb = _storage_compact_cb;
+        wrap->io.len = settings.ext_wbuf_size;
+        wrap->io.mode = OBJ_IO_READ;
+        wrap->io.cb = _storage_compact_cb;
+    }
+    lim.last = storage_now_us();
     pthread_mutex_lock(&storage_compact_plock);
 
     while (1) {
+        unsigned int active = 0;
+        bool exhausted = false;
         pthread_mutex_unlock(&storage_compact_plock);
         if (to_sleep) {
             extstore_run_maint(storage);
             usleep(to_sleep);
         }
         pthread_mutex_lock(&storage_compact_plock);
+        storage_compact_refill(&lim);
+
+        // each stream has one read in flight at a time; running several
+        // lets the IO threads work on them in parallel.
+        for (int x = 0; x < streams; x++) {
+            struct storage_compact_wrap *wrap = &wraps[x];
+
+            if (!wrap->compacting && !exhausted) {
+                if (storage_compact_check(storage, l,
+                        &wrap->page_id, &wrap->page_version, &wrap->bucket,
+                        &page_size, &wrap->drop_unread, busy)) {
+                    wrap->page_offset = 0;
+                    wrap->compacting = true;
+                    busy[wrap->page_id] = true;
+                    LOGGER_LOG(l, LOG_SYSEVENTS, LOGGER_COMPACT_START,
+                            NULL, wrap->page_id, wrap->page_version);
+                } else {
+                    // no other idle stream will find a page either.
+                    exhausted = true;
+                }
+            }
 
-        if (!compacting && storage_compact_check(storage, l,
-                    &page_id, &page_version, &page_size, &drop_unread)) {
-            page_offset = 0;
-            compacting = true;
-            LOGGER_LOG(l, LOG_SYSEVENTS, LOGGER_COMPACT_START,
-                    NULL, page_id, page_version);
-        }
-
-        if (compacting) {
-            pthread_mutex_lock(&wrap.lock);
-            if (page_offset < page_size && !wrap.done && !wrap.submitted) {
-                wrap.io.page_version = page_version;
-                wrap.io.page_id = page_id;
-                wrap.io.offset = page_offset;
-                // FIXME: should be smarter about io->next (unlink at use?)
-                wrap.io.next = NULL;
-                wrap.submitted = true;
-                wrap.miss = false;
-
-                extstore_submit(storage, &wrap.io);
-            } else if (wrap.miss) {
+            if (!wrap->compacting)
+                continue;
+            active++;
+
+            pthread_mutex_lock(&wrap->lock);
+            if (wrap->page_offset < page_size && !wrap->done && !wrap->submitted) {
+                if (lim.rate && lim.tokens < settings.ext_wbuf_size) {
+                    if (!wrap->throttled) {
+                        wrap->throttled = true;
+                        STATS_LOCK();
+                        stats.extstore_compact_throttled++;
+                        STATS_UNLOCK();
+                    }
+                } else {
+                    if (lim.rate)
+                        lim.tokens -= settings.ext_wbuf_size;
+                    wrap->throttled = false;
+                    wrap->io.page_version = wrap->page_version;
+                    wrap->io.page_id = wrap->page_id;
+                    wrap->io.offset = wrap->page_offset;
+                    // FIXME: should be smarter about io->next (unlink at use?)
+                    wrap->io.next = NULL;
+                    wrap->submitted = true;
+                    wrap->miss = false;
+
+                    extstore_submit(storage, &wrap->io);
+                }
+            } else if (wrap->miss) {
                 LOGGER_LOG(l, LOG_SYSEVENTS, LOGGER_COMPACT_ABORT,
-                        NULL, page_id);
-                wrap.done = false;
-                wrap.submitted = false;
-                compacting = false;
-            } else if (wrap.submitted && wrap.done) {
+                        NULL, wrap->page_id);
+                wrap->done = false;
+                wrap->submitted = false;
+                wrap->compacting = false;
+                busy[wrap->page_id] = false;
+            } else if (wrap->submitted && wrap->done) {
                 LOGGER_LOG(l, LOG_SYSEVENTS, LOGGER_COMPACT_READ_START,
-                        NULL, page_id, page_offset);
-                storage_compact_readback(storage, l, drop_unread,
-                        readback_buf, page_id, page_version, settings.ext_wbuf_size);
-                page_offset += settings.ext_wbuf_size;
-                wrap.done = false;
-                wrap.submitted = false;
-            } else if (page_offset >= page_size) {
-                compacting = false;
-                wrap.done = false;
-                wrap.submitted = false;
-                extstore_close_page(storage, page_id, page_version);
+                        NULL, wrap->page_id, wrap->page_offset);
+                storage_compact_readback(storage, l, wrap->drop_unread,
+                        wrap->readback_buf, wrap->bucket, wrap->page_id,
+                        wrap->page_version, settings.ext_wbuf_size);
+                wrap->page_offset += settings.ext_wbuf_size;
+                wrap->done = false;
+                wrap->submitted = false;
+                STATS_LOCK();
+                stats.extstore_compact_bytes += settings.ext_wbuf_size;
+                STATS_UNLOCK();
+            } else if (wrap->page_offset >= page_size) {
+                wrap->compacting = false;
+                wrap->done = false;
+                wrap->submitted = false;
+                busy[wrap->page_id] = false;
+                extstore_close_page(storage, wrap->page_id, wrap->page_version);
                 LOGGER_LOG(l, LOG_SYSEVENTS, LOGGER_COMPACT_END,
-                        NULL, page_id);
+                        NULL, wrap->page_id);
+                STATS_LOCK();
+                stats.extstore_compact_pages++;
+                STATS_UNLOCK();
             }
-            pthread_mutex_unlock(&wrap.lock);
+            pthread_mutex_unlock(&wrap->lock);
+        }
+
+        STATS_LOCK();
+        stats_state.extstore_compact_active = active;
+        stats_state.extstore_compact_rate = lim.rate;
+        STATS_UNLOCK();
 
+        if (active) {
             // finish actual compaction quickly.
             to_sleep = MIN_STORAGE_COMPACT_SLEEP;
         } else {
@@ -981,7 +1248,10 @@ static void *storage_compact_thread(void *arg) {
                 to_sleep += settings.ext_max_sleep;
         }
     }
-    free(readback_buf);
+    for (int x = 0; x < streams; x++) {
+        free(wraps[x].readback_buf);
+    }
+    free(busy);
 
     return NULL;
 }
@@ -1118,6 +1388,7 @@ void *storage_init_config(struct settings *s) {
     s->ext_item_size = 512;
     s->ext_item_age = UINT_MAX;
     s->ext_low_ttl = 0;
+    s->ext_ttl_buckets = 0;
     s->ext_recache_rate = 2000;
     s->ext_max_frag = 0.8;
     s->ext_drop_unread = false;
@@ -1125,6 +1396,9 @@ void *storage_init_config(struct settings *s) {
     s->ext_compact_under = 0;
     s->ext_drop_under = 0;
     s->ext_max_sleep = 1000000;
+    s->ext_compact_streams = 2;
+    s->ext_compact_rate = 0;
+    s->ext_compact_read_lat = 0;
     s->slab_automove_freeratio = 0.01;
     s->ext_page_size = 1024 * 1024 * 64;
     s->ext_io_threadcount = 1;
@@ -1132,7 +1406,7 @@ void *storage_init_config(struct settings *s) {
     cf->ext_cf.wbuf_size = settings.ext_wbuf_size;
     cf->ext_cf.io_threadcount = settings.ext_io_threadcount;
     cf->ext_cf.io_depth = 1;
-    cf->ext_cf.page_buckets = 4;
+    cf->ext_cf.page_buckets = PAGE_BUCKET_TTL;
     cf->ext_cf.wbuf_count = cf->ext_cf.page_buckets;
 
     return cf;
@@ -1153,12 +1427,17 @@ int storage_read_config(void *conf, char **subopt) {
         EXT_ITEM_SIZE,
         EXT_ITEM_AGE,
         EXT_LOW_TTL,
+        EXT_TTL_BUCKETS,
         EXT_RECACHE_RATE,
         EXT_COMPACT_UNDER,
         EXT_DROP_UNDER,
         EXT_MAX_SLEEP,
         EXT_MAX_FRAG,
         EXT_DROP_UNREAD,
+        EXT_IO_URING,
+        EXT_COMPACT_STREAMS,
+        EXT_COMPACT_RATE,
+        EXT_COMPACT_READ_LAT,
         SLAB_AUTOMOVE_FREERATIO, // FIXME: move this back?
     };
 
@@ -1171,12 +1450,17 @@ int storage_read_config(void *conf, char **subopt) {
         [EXT_ITEM_SIZE] = "ext_item_size",
         [EXT_ITEM_AGE] = "ext_item_age",
         [EXT_LOW_TTL] = "ext_low_ttl",
+        [EXT_TTL_BUCKETS] = "ext_ttl_buckets",
         [EXT_RECACHE_RATE] = "ext_recache_rate",
         [EXT_COMPACT_UNDER] = "ext_compact_under",
         [EXT_DROP_UNDER] = "ext_drop_under",
         [EXT_MAX_SLEEP] = "ext_max_sleep",
         [EXT_MAX_FRAG] = "ext_max_frag",
         [EXT_DROP_UNREAD] = "ext_drop_unread",
+        [EXT_IO_URING] = "ext_io_uring",
+        [EXT_COMPACT_STREAMS] = "ext_compact_streams",
+        [EXT_COMPACT_RATE] = "ext_compact_rate",
+        [EXT_COMPACT_READ_LAT] = "ext_compact_read_lat",
         [SLAB_AUTOMOVE_FREERATIO] = "slab_automove_freeratio",
         NULL
     };
@@ -1259,6 +1543,21 @@ int storage_read_config(void *conf, char **subopt) {
                 return 1;
             }
             break;
+        case EXT_TTL_BUCKETS:
+            if (subopts_value == NULL) {
+                fprintf(stderr, "Missing ext_ttl_buckets argument\n");
+                return 1;
+            }
+            if (!safe_strtoul(subopts_value, &settings.ext_ttl_buckets)) {
+                fprintf(stderr, "could not parse argument to ext_ttl_buckets\n");
+                return 1;
+            }
+            if (settings.ext_ttl_buckets > MAX_STORAGE_TTL_BUCKETS) {
+                fprintf(stderr, "ext_ttl_buckets must be %d or less\n",
+                        MAX_STORAGE_TTL_BUCKETS);
+                return 1;
+            }
+            break;
         case EXT_RECACHE_RATE:
             if (subopts_value == NULL) {
                 fprintf(stderr, "Missing ext_recache_rate argument\n");
@@ -1299,6 +1598,42 @@ int storage_read_config(void *conf, char **subopt) {
                 return 1;
             }
             break;
+        case EXT_COMPACT_STREAMS:
+            if (subopts_value == NULL) {
+                fprintf(stderr, "Missing ext_compact_streams argument\n");
+                return 1;
+            }
+            if (!safe_strtoul(subopts_value, &settings.ext_compact_streams)) {
+                fprintf(stderr, "could not parse argument to ext_compact_streams\n");
+                return 1;
+            }
+            if (settings.ext_compact_streams < 1 ||
+                    settings.ext_compact_streams > MAX_STORAGE_COMPACT_STREAMS) {
+                fprintf(stderr, "ext_compact_streams must be between 1 and %d\n",
+                        MAX_STORAGE_COMPACT_STREAMS);
+                return 1;
+            }
+            break;
+        case EXT_COMPACT_RATE:
+            if (subopts_value == NULL) {
+                fprintf(stderr, "Missing ext_compact_rate argument\n");
+                return 1;
+            }
+            if (!safe_strtoul(subopts_value, &settings.ext_compact_rate)) {
+                fprintf(stderr, "could not parse argument to ext_compact_rate\n");
+                return 1;
+            }
+            break;
+        case EXT_COMPACT_READ_LAT:
+            if (subopts_value == NULL) {
+                fprintf(stderr, "Missing ext_compact_read_lat argument\n");
+                return 1;
+            }
+            if (!safe_strtoul(subopts_value, &settings.ext_compact_read_lat)) {
+                fprintf(stderr, "could not parse argument to ext_compact_read_lat\n");
+                return 1;
+            }
+            break;
         case EXT_MAX_FRAG:
             if (subopts_value == NULL) {
                 fprintf(stderr, "Missing ext_max_frag argument\n");
@@ -1322,6 +1657,14 @@ int storage_read_config(void *conf, char **subopt) {
         case EXT_DROP_UNREAD:
             settings.ext_drop_unread = true;
             break;
+        case EXT_IO_URING:
+#ifdef EXTSTORE_URING
+            ext_cf->io_uring = true;
+            break;
+#else
+            fprintf(stderr, "ext_io_uring requires building with --enable-extstore-uring\n");
+            return 1;
+#endif
         case EXT_PATH:
             if (subopts_value) {
                 struct extstore_conf_file *tmp = storage_conf_parse(subopts_value, ext_cf->page_size);
@@ -1383,6 +1726,9 @@ void *storage_init(void *conf) {
     crc32c_init();
 
     settings.ext_global_pool_min = 0;
+    // each TTL band writes to its own set of pages.
+    ext_cf->page_buckets = PAGE_BUCKET_TTL + settings.ext_ttl_buckets;
+    ext_cf->wbuf_count = ext_cf->page_buckets;
     storage = extstore_init(cf->storage_file, ext_cf, &eres);
     if (storage == NULL) {
         fprintf(stderr, "Failed to initialize external storage: %s\n",
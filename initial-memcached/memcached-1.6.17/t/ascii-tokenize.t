@@ -0,0 +1,64 @@
+#!/usr/bin/env perl
+# Request line tokenizing: odd spacing, long multigets and meta flags.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $server = new_memcached();
+my $sock = $server->sock;
+
+my @keys = map { "tokkey$_" } (1 .. 300);
+for my $k (@keys) {
+    print $sock "set $k 0 0 " . length($k) . "\r\n$k\r\n";
+}
+for my $k (@keys) {
+    is(scalar <$sock>, "STORED\r\n", "stored $k");
+}
+
+sub multiget_is {
+    my ($line, $want, $msg) = @_;
+    print $sock $line;
+    my @got;
+    while (my $l = <$sock>) {
+        last if $l eq "END\r\n";
+        if ($l =~ /^VALUE (\S+) 0 \d+\r\n$/) {
+            push @got, $1;
+            my $v = <$sock>;
+            is($v, "$1\r\n", "value for $1");
+        } else {
+            fail("unexpected line: $l");
+            last;
+        }
+    }
+    is_deeply(\@got, $want, $msg);
+}
+
+# a long line is refilled many times, over many scan blocks.
+multiget_is("get " . join(' ', @keys) . "\r\n", \@keys, "300 key get");
+
+# runs of spaces, leading and trailing, land on every block offset.
+my $spaced = "get";
+my $n = 0;
+for my $k (@keys[0 .. 99]) {
+    $spaced .= ' ' x (1 + ($n++ % 37)) . $k;
+}
+multiget_is("  $spaced   \r\n", [@keys[0 .. 99]], "get with uneven spacing");
+
+# token limit boundary: the rest of the line is picked up on refill.
+for my $count (21 .. 25) {
+    multiget_is("get " . join(' ', @keys[0 .. $count - 1]) . "\r\n",
+        [@keys[0 .. $count - 1]], "get with $count keys");
+}
+
+# meta commands with spread out flags.
+print $sock "ms   metatok  2    T0   F5\r\nhi\r\n";
+is(scalar <$sock>, "HD\r\n", "meta set with extra spaces");
+print $sock "mg metatok    s  v   f     k\r\n";
+is(scalar <$sock>, "VA 2 s2 f5 kmetatok\r\n", "meta get flags");
+is(scalar <$sock>, "hi\r\n", "meta get value");
+
+done_testing();
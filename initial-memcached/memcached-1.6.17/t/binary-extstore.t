@@ -206,6 +206,9 @@ $set->('x', 10, 19, "somevalue");
     my %s = $mc->stats('');
     cmp_ok($s{extstore_objects_evicted}, '>', 0);
     cmp_ok($s{miss_from_extstore}, '>', 0);
+    # reads of evicted pages are answered without IO.
+    cmp_ok($s{extstore_reads_skipped}, '>', 0);
+    cmp_ok($s{extstore_bytes_skipped}, '>', 0);
 }
 
 # store and re-fetch a chunked value
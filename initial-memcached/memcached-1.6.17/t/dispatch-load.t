@@ -0,0 +1,90 @@
+#!/usr/bin/env perl
+# Load aware connection dispatch and per-thread stats.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+sub thread_stats {
+    my $sock = shift;
+    my $stats = mem_stats($sock, 'threads');
+    my %conns;
+    for my $key (keys %$stats) {
+        $conns{$1} = $stats->{$key} if $key =~ /^(\d+):conns$/;
+    }
+    return ($stats, \%conns);
+}
+
+my $server = new_memcached('-t 4 -o dispatch_mode=load');
+my $sock = $server->sock;
+
+my $settings = mem_stats($sock, ' settings');
+is($settings->{dispatch_mode}, "load", "dispatch_mode setting");
+is($settings->{dispatch_rebalance}, "no", "dispatch_rebalance setting");
+
+my @socks = map { $server->new_sock } (1 .. 7);
+for my $s (@socks) {
+    print $s "set dkey 0 0 1\r\na\r\n";
+    is(scalar <$s>, "STORED\r\n", "stored through new conn");
+}
+
+my ($stats, $conns) = thread_stats($sock);
+is(scalar keys %$conns, 4, "stats for each worker");
+for my $t (0 .. 3) {
+    ok(exists $stats->{"$t:util"}, "thread $t has util");
+    ok(exists $stats->{"$t:busy_us"}, "thread $t has busy_us");
+}
+my $total = 0;
+$total += $_ for values %$conns;
+is($total, 8, "all conns counted");
+my @sorted = sort { $a <=> $b } values %$conns;
+cmp_ok($sorted[-1] - $sorted[0], '<=', 1, "conns spread evenly");
+
+# closed conns are given back.
+close($_) for @socks;
+for (1 .. 10) {
+    ($stats, $conns) = thread_stats($sock);
+    $total = 0;
+    $total += $_ for values %$conns;
+    last if $total == 1;
+    sleep 1;
+}
+is($total, 1, "closed conns uncounted");
+
+# round robin dispatch doesn't time events at all.
+{
+    my $rr = new_memcached('-t 2');
+    my $rsock = $rr->sock;
+    for (1 .. 20) {
+        print $rsock "set rrkey 0 0 1\r\nc\r\n";
+        is(scalar <$rsock>, "STORED\r\n", "stored with round robin dispatch");
+    }
+    my $busy = 0;
+    my $rstats = mem_stats($rsock, ' threads');
+    for my $key (keys %$rstats) {
+        $busy += $rstats->{$key} if $key =~ /:busy_us$/;
+    }
+    is($busy, 0, "no busy time measured with round robin dispatch");
+}
+
+# rebalance can't be combined with idle timeouts.
+eval {
+    new_memcached('-o dispatch_mode=load,dispatch_rebalance,idle_timeout=10');
+};
+ok($@, "dispatch_rebalance refuses idle_timeout");
+
+$server = new_memcached('-t 4 -o dispatch_mode=load,dispatch_rebalance');
+$sock = $server->sock;
+$settings = mem_stats($sock, ' settings');
+is($settings->{dispatch_rebalance}, "yes", "dispatch_rebalance enabled");
+@socks = map { $server->new_sock } (1 .. 8);
+for my $s (@socks) {
+    print $s "set rkey 0 0 1\r\nb\r\n";
+    is(scalar <$s>, "STORED\r\n", "stored through new conn");
+    mem_get_is($s, "rkey", "b");
+}
+
+done_testing();
@@ -54,6 +54,76 @@ my $value;
     cmp_ok($stats->{extstore_page_reclaims}, '>', 1, 'at least two pages reclaimed');
 }
 
+# items with longer TTLs are split into their own bands of pages.
+{
+    $server->stop;
+    unlink $ext_path;
+    $server = new_memcached("-m 256 -U 0 -o ext_page_size=2,ext_wbuf_size=2,ext_threads=1,ext_io_depth=2,ext_item_size=512,ext_item_age=2,ext_recache_rate=10000,ext_path=$ext_path:64m,ext_ttl_buckets=4");
+    $sock = $server->sock;
+    my $keycount = 200;
+    for (1 .. $keycount) {
+        print $sock "set nfoo$_ 0 0 20000 noreply\r\n$value\r\n";
+        print $sock "set hfoo$_ 0 1800 20000 noreply\r\n$value\r\n";
+        print $sock "set dfoo$_ 0 86400 20000 noreply\r\n$value\r\n";
+    }
+    sleep 10;
+    mem_get_is($sock, "nfoo1", $value);
+    mem_get_is($sock, "hfoo1", $value);
+    mem_get_is($sock, "dfoo1", $value);
+    my $stats = mem_stats($sock);
+    cmp_ok($stats->{extstore_objects_written}, '>', $keycount * 2, 'some objects written');
+
+    # no TTL, the first band and the last band. Small pages so each bucket
+    # has filled at least one; the page being written isn't listed.
+    my %buckets;
+    my $pages = mem_stats($sock, 'extstore');
+    for my $key (keys %$pages) {
+        next unless $key =~ m/^(\d+):bucket$/;
+        next unless $pages->{"$1:bytes"} > 0;
+        $buckets{$pages->{$key}}++;
+    }
+    ok($buckets{0}, 'no TTL items on default bucket pages');
+    ok($buckets{4}, 'short TTL items on first band pages');
+    ok($buckets{7}, 'long TTL items on last band pages');
+}
+
+# band pages are compacted too, rather than left fragmented.
+{
+    $server->stop;
+    unlink $ext_path;
+    $server = new_memcached("-m 64 -U 0 -o ext_page_size=4,ext_wbuf_size=2,ext_threads=1,ext_io_depth=2,ext_item_size=512,ext_item_age=2,ext_recache_rate=10000,ext_max_frag=0.9,ext_path=$ext_path:64m,slab_automove=0,ext_compact_under=0,ext_max_sleep=100000,ext_ttl_buckets=4");
+    $sock = $server->sock;
+    my $keycount = 600;
+    for (1 .. $keycount) {
+        print $sock "set hfoo$_ 0 1800 20000 noreply\r\n$value\r\n";
+    }
+    wait_ext_flush($sock);
+
+    my $stats = mem_stats($sock);
+    cmp_ok($stats->{extstore_objects_written}, '>', $keycount / 2, 'some objects written');
+    is($stats->{extstore_compact_pages}, 0, 'nothing compacted yet');
+
+    for (1 .. $keycount) {
+        next if $_ % 10 == 0;
+        print $sock "delete hfoo$_ noreply\r\n";
+    }
+    print $sock "extstore compact_under 16\r\n";
+    is(scalar <$sock>, "OK\r\n", 'set compact_under');
+
+    for (1 .. 30) {
+        $stats = mem_stats($sock);
+        last if $stats->{extstore_compact_pages} > 0;
+        sleep 1;
+    }
+    cmp_ok($stats->{extstore_compact_pages}, '>', 0, 'band pages compacted');
+    cmp_ok($stats->{extstore_compact_rescues}, '>', 0, 'band items rescued');
+
+    for (1 .. $keycount) {
+        next unless $_ % 10 == 0;
+        mem_get_is($sock, "hfoo$_", $value);
+    }
+}
+
 done_testing();
 
 END {
@@ -0,0 +1,79 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $ext_path;
+
+if (!supports_extstore()) {
+    plan skip_all => 'extstore not enabled';
+    exit 0;
+}
+
+$ext_path = "/tmp/extstore-compact.$$";
+
+# compaction is off (compact_under=0) until the pages are fragmented.
+my $server = new_memcached("-m 64 -U 0 -o ext_page_size=4,ext_wbuf_size=2,ext_threads=2,ext_io_depth=2,ext_item_size=512,ext_item_age=2,ext_recache_rate=10000,ext_max_frag=0.9,ext_path=$ext_path:64m,slab_automove=0,ext_compact_under=0,ext_max_sleep=100000,ext_compact_streams=2,ext_compact_rate=1,ext_compact_read_lat=1000000");
+my $sock = $server->sock;
+
+{
+    my $s = mem_stats($sock, ' settings');
+    is($s->{ext_compact_streams}, 2, "compact streams set");
+    is($s->{ext_compact_rate}, 1, "compact rate set");
+    is($s->{ext_compact_read_lat}, 1000000, "compact read latency target set");
+}
+
+my $value;
+{
+    my @chars = ("C".."Z");
+    for (1 .. 20000) {
+        $value .= $chars[rand @chars];
+    }
+}
+
+# fill a few pages, then delete most of it so they're worth compacting.
+{
+    my $keycount = 600;
+    for (1 .. $keycount) {
+        print $sock "set cfoo$_ 0 0 20000 noreply\r\n$value\r\n";
+    }
+    wait_ext_flush($sock);
+
+    my $stats = mem_stats($sock);
+    cmp_ok($stats->{extstore_objects_written}, '>', $keycount / 2, 'some objects written');
+    is($stats->{extstore_compact_pages}, 0, 'nothing compacted yet');
+
+    for (1 .. $keycount) {
+        next if $_ % 10 == 0;
+        print $sock "delete cfoo$_ noreply\r\n";
+    }
+    print $sock "extstore compact_under 16\r\n";
+    is(scalar <$sock>, "OK\r\n", 'set compact_under');
+
+    # 1MB/s and 2MB reads, so each read waits on the rate limit.
+    for (1 .. 30) {
+        $stats = mem_stats($sock);
+        last if $stats->{extstore_compact_pages} > 0;
+        sleep 1;
+    }
+    cmp_ok($stats->{extstore_compact_pages}, '>', 0, 'pages compacted');
+    cmp_ok($stats->{extstore_compact_bytes}, '>', 0, 'bytes compacted');
+    cmp_ok($stats->{extstore_compact_throttled}, '>', 0, 'compaction was throttled');
+    is($stats->{extstore_compact_rate}, 1024 * 1024, 'compaction rate reported');
+
+    # the survivors were moved, not lost.
+    for (1 .. $keycount) {
+        next unless $_ % 10 == 0;
+        mem_get_is($sock, "cfoo$_", $value);
+    }
+}
+
+done_testing();
+
+END {
+    unlink $ext_path if $ext_path;
+}
@@ -0,0 +1,78 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $ext_path;
+
+if (!supports_extstore()) {
+    plan skip_all => 'extstore not enabled';
+    exit 0;
+}
+
+if (!supports_ext_io_uring()) {
+    plan skip_all => 'extstore io_uring support not built';
+    exit 0;
+}
+
+$ext_path = "/tmp/extstore-uring.$$";
+
+my $server = new_memcached("-m 64 -U 0 -o ext_page_size=8,ext_wbuf_size=2,ext_threads=2,ext_io_depth=8,ext_io_uring,ext_item_size=512,ext_item_age=2,ext_recache_rate=10000,ext_max_frag=0.9,ext_path=$ext_path:64m,slab_automove=0");
+my $sock = $server->sock;
+
+my @values;
+{
+    my @chars = ("C".."Z");
+    for my $x (0 .. 3) {
+        my $value = '';
+        for (1 .. 20000) {
+            $value .= $chars[rand @chars];
+        }
+        push(@values, $value);
+    }
+}
+
+# fill, flush, and read everything back through the rings.
+{
+    my $keycount = 800;
+    for (1 .. $keycount) {
+        my $value = $values[$_ % 4];
+        print $sock "set nfoo$_ 0 0 20000 noreply\r\n$value\r\n";
+    }
+    wait_ext_flush($sock);
+
+    my $stats = mem_stats($sock);
+    cmp_ok($stats->{extstore_objects_written}, '>', $keycount / 2, 'some objects written');
+
+    my $bad = 0;
+    for (1 .. $keycount) {
+        print $sock "mg nfoo$_ v\r\n";
+        my $hdr = <$sock>;
+        if ($hdr =~ /^VA (\d+)/) {
+            my $len = $1;
+            my $got = '';
+            while (length($got) < $len + 2) {
+                read($sock, $got, $len + 2 - length($got), length($got));
+            }
+            $bad++ if substr($got, 0, $len) ne $values[$_ % 4];
+        } else {
+            $bad++;
+        }
+    }
+    is($bad, 0, 'all values read back intact');
+
+    $stats = mem_stats($sock);
+    cmp_ok($stats->{get_extstore}, '>', 0, 'objects were fetched from storage');
+    cmp_ok($stats->{extstore_objects_read}, '>', 0, 'objects read');
+    is($stats->{badcrc_from_extstore}, 0, 'no crc failures');
+}
+
+done_testing();
+
+END {
+    unlink $ext_path if $ext_path;
+}
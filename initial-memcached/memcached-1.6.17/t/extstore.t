@@ -78,6 +78,8 @@ mem_get_is($sock, "foo", "hi");
     my $stats = mem_stats($sock);
     cmp_ok($stats->{extstore_page_allocs}, '>', 0, 'at least one page allocated');
     cmp_ok($stats->{extstore_objects_written}, '>', $keycount / 2, 'some objects written');
+    cmp_ok($stats->{extstore_write_batches}, '>', 0, 'write batches counted');
+    cmp_ok($stats->{extstore_write_batches}, '<', $stats->{extstore_objects_written}, 'writes were batched');
     cmp_ok($stats->{extstore_bytes_written}, '>', length($value) * 2, 'some bytes written');
     cmp_ok($stats->{get_extstore}, '>', 0, 'one object was fetched');
     cmp_ok($stats->{extstore_objects_read}, '>', 0, 'one object read');
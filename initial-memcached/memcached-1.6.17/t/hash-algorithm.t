@@ -0,0 +1,43 @@
+#!/usr/bin/env perl
+# Every -o hash_algorithm choice stores and finds keys of assorted lengths.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+for my $algo (qw(jenkins murmur3 xxh3 aes)) {
+    my $server = new_memcached("-o hash_algorithm=$algo");
+    my $sock = $server->sock;
+
+    my $settings = mem_stats($sock, ' settings');
+    if ($algo eq 'aes') {
+        # runtime pick: xxh3 stands in on CPUs without AES-NI.
+        like($settings->{hash_algorithm}, qr/^(aes|xxh3)$/, "aes or its fallback in use");
+    } else {
+        is($settings->{hash_algorithm}, $algo, "$algo in use");
+    }
+
+    my @keys;
+    for my $len (1 .. 250) {
+        push @keys, substr("k$len" . ("x" x 250), 0, $len);
+    }
+    for my $k (@keys) {
+        print $sock "set $k 0 0 " . length($k) . " noreply\r\n$k\r\n";
+    }
+    my $found = 0;
+    for my $k (@keys) {
+        print $sock "get $k\r\n";
+        my $line = <$sock>;
+        if ($line =~ /^VALUE/) {
+            my $v = <$sock>;
+            $found++ if $v eq "$k\r\n";
+            $line = <$sock>;
+        }
+    }
+    is($found, scalar @keys, "$algo: all key lengths found");
+}
+
+done_testing();
@@ -0,0 +1,60 @@
+#!/usr/bin/env perl
+# Checks both hash table layouts through expansion, deletes and a full walk.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+for my $index ("chained", "bucketed") {
+    my $server = new_memcached("-m 128 -o hashpower=13,hash_index=$index");
+    my $sock = $server->sock;
+
+    my $stats = mem_stats($sock, ' settings');
+    is($stats->{hash_index}, $index, "$index: hash_index setting");
+
+    # enough to overflow bucketed slots and grow the table either way.
+    my $count = 50000;
+    for (1 .. $count) {
+        print $sock "set hkey$_ 0 0 1 noreply\r\nz\r\n";
+    }
+    mem_get_is($sock, "hkey1", "z");
+
+    # expansion happens in the background.
+    for (1 .. 20) {
+        $stats = mem_stats($sock);
+        last if $stats->{hash_power_level} > 13 && !$stats->{hash_is_expanding};
+        sleep 1;
+    }
+    cmp_ok($stats->{hash_power_level}, '>', 13, "$index: hash table expanded");
+    is($stats->{hash_is_expanding}, 0, "$index: expansion finished");
+
+    for (1 .. $count) {
+        print $sock "delete hkey$_ noreply\r\n" if $_ % 2;
+    }
+
+    my $wrong = 0;
+    for (1 .. $count) {
+        print $sock "mg hkey$_ v\r\n";
+        my $res = <$sock>;
+        if ($res =~ /^VA/) {
+            <$sock>;
+            $wrong++ if $_ % 2;
+        } else {
+            $wrong++ unless $_ % 2;
+        }
+    }
+    is($wrong, 0, "$index: lookups match sets and deletes");
+
+    print $sock "lru_crawler metadump hash\r\n";
+    my $found = 0;
+    while (<$sock>) {
+        last if /^(\.|END)/;
+        $found++ if /^key=hkey/;
+    }
+    is($found, $count / 2, "$index: hash walk returns every item");
+}
+
+done_testing();
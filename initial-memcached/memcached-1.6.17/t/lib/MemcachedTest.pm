@@ -18,7 +18,8 @@ my @unixsockets = ();
              mem_get_is mem_gets mem_gets_is mem_stats mem_move_time
              supports_sasl free_port supports_drop_priv supports_extstore
              wait_ext_flush supports_tls enabled_tls_testing run_help
-             supports_unix_socket get_memcached_exe supports_proxy);
+             supports_unix_socket get_memcached_exe supports_proxy
+             supports_ext_io_uring);
 
 use constant MAX_READ_WRITE_SIZE => 16384;
 use constant SRV_CRT => "server_crt.pem";
@@ -215,6 +216,12 @@ sub supports_extstore {
     return 0;
 }
 
+sub supports_ext_io_uring {
+    my $output = print_help();
+    return 1 if $output =~ /ext_io_uring/i;
+    return 0;
+}
+
 sub supports_proxy {
     my $output = print_help();
     return 1 if $output =~ /proxy_config/i;
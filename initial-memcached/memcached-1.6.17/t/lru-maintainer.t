@@ -2,7 +2,7 @@
 
 use strict;
 use warnings;
-use Test::More tests => 226;
+use Test::More tests => 239;
 use FindBin qw($Bin);
 use lib "$Bin/lib";
 use MemcachedTest;
@@ -70,6 +70,9 @@ for (my $key = 0; $key < 100; $key++) {
         }
         $stats = mem_stats($sock, "items");
         isnt($stats->{"items:31:moves_to_warm"}, 0, "our canary moved to warm");
+        $stats = mem_stats($sock);
+        is($stats->{lru_bumps_queued}, 0, "bump queue drained");
+        is($stats->{lru_bumps_dropped}, 0, "no bumps dropped");
     }
     print $sock "set key$key 0 0 66560\r\n$value\r\n";
     is(scalar <$sock>, "STORED\r\n", "stored key$key");
@@ -117,3 +120,52 @@ for (my $key = 0; $key < 100; $key++) {
 # Canary should still exist, even unfetched, because it's protected by
 # temp LRU
 mem_get_is($sock, "canary", $value);
+
+# Flat mode hits are queued for the LRU maintainer instead of relinking
+# inline.
+$server = new_memcached('-m 6 -o lru_maintainer,lru_crawler');
+$sock = $server->sock;
+
+sub lru_order {
+    my $sock = shift;
+    print $sock "lru_crawler metadump all\r\n";
+    my @keys = ();
+    while (<$sock>) {
+        last if /^(\.|END)/;
+        push(@keys, $1) if /^key=(\S+)/;
+    }
+    return join(',', @keys);
+}
+
+print $sock "lru mode flat\r\n";
+is(scalar <$sock>, "OK\r\n", "switched to flat LRU");
+for my $key (qw/fa fb/) {
+    print $sock "set $key 0 0 2\r\nok\r\n";
+    is(scalar <$sock>, "STORED\r\n", "stored $key");
+}
+is(lru_order($sock), "fa,fb", "fa is at the tail");
+
+# Old enough to be bumped on the next hit.
+print $sock "debugtime 120\r\n";
+is(scalar <$sock>, "OK\r\n", "moved the clock forward");
+print $sock "debuglru p\r\n";
+is(scalar <$sock>, "OK\r\n", "paused the LRU maintainer");
+
+mem_get_is($sock, "fa", "ok");
+{
+    my $stats = mem_stats($sock);
+    is($stats->{lru_bumps_queued}, 1, "hit was queued, not relinked");
+}
+
+print $sock "debuglru r\r\n";
+is(scalar <$sock>, "OK\r\n", "resumed the LRU maintainer");
+for (0..10) {
+    my $stats = mem_stats($sock);
+    last if $stats->{lru_bumps_queued} == 0;
+    sleep 1;
+}
+{
+    my $stats = mem_stats($sock);
+    is($stats->{lru_bumps_queued}, 0, "bump queue drained");
+    is(lru_order($sock), "fb,fa", "fa moved to the head");
+}
@@ -0,0 +1,20 @@
+-- single-flight config for t/proxy-coalesce.t: one mock backend behind a
+-- coalescing pool.
+
+function mcp_config_pools(oldss)
+    mcp.add_stat(1, "coalesced")
+    return {
+        hot = mcp.pool({ mcp.backend('hot', '127.0.0.1', 11521) },
+            { dist = mcp.dist_jump_hash, coalesce = true, coalesce_stat = 1 }),
+    }
+end
+
+function mcp_config_routes(p)
+    local hot = p.hot
+    mcp.attach(mcp.CMD_GET, function(r)
+        return hot(r)
+    end)
+    mcp.attach(mcp.CMD_MG, function(r)
+        return hot(r)
+    end)
+end
@@ -0,0 +1,124 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use IO::Socket::INET;
+use IO::Select;
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+# mock backend, so the test decides when the backend answers.
+my $mock = IO::Socket::INET->new(LocalAddr => '127.0.0.1', LocalPort => 11521,
+    Proto => 'tcp', Listen => 5, ReuseAddr => 1)
+    or die "can't listen on 11521: $!";
+
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-coalesce.lua -l 127.0.0.1', 11520);
+my $p_sock = $p_srv->sock;
+my $c_sock = $p_srv->new_sock;
+
+my $be;
+sub be_sock {
+    if (!$be) {
+        my $sel = IO::Select->new($mock);
+        die "proxy never connected" unless $sel->can_read(5);
+        $be = $mock->accept();
+    }
+    return $be;
+}
+
+# next request line the proxy sent to the mock backend.
+sub be_read {
+    my $s = be_sock();
+    while (my $line = <$s>) {
+        if ($line =~ /^version/) {
+            print $s "VERSION 1.6.17\r\n";
+            next;
+        }
+        return $line;
+    }
+    return undef;
+}
+
+# true if the proxy sent nothing more for a little while.
+sub be_quiet {
+    my $sel = IO::Select->new(be_sock());
+    return !$sel->can_read(0.3);
+}
+
+sub be_value {
+    my ($key, $val) = @_;
+    print {be_sock()} "VALUE $key 0 " . length($val) . "\r\n$val\r\nEND\r\n";
+}
+
+sub get_is {
+    my ($sock, $key, $val, $msg) = @_;
+    is(scalar <$sock>, "VALUE $key 0 " . length($val) . "\r\n", "$msg value");
+    is(scalar <$sock>, "$val\r\n", "$msg data");
+    is(scalar <$sock>, "END\r\n", "$msg end");
+}
+
+# a second get for a key already in flight waits on the first one.
+{
+    print $p_sock "get hot\r\n";
+    like(be_read(), qr/^get hot/, "first get reaches backend");
+    print $c_sock "get hot\r\n";
+    ok(be_quiet(), "duplicate get not sent");
+    be_value('hot', 'one');
+    get_is($p_sock, 'hot', 'one', "leader");
+    get_is($c_sock, 'hot', 'one', "waiter");
+}
+
+# once answered, the key is released and the next get is sent again.
+{
+    print $c_sock "get hot\r\n";
+    like(be_read(), qr/^get hot/, "later get reaches backend");
+    be_value('hot', 'two');
+    get_is($c_sock, 'hot', 'two', "later get");
+}
+
+# mg with N (or T) has a side effect on the backend, so every one is sent.
+{
+    print $p_sock "mg hot v N30\r\n";
+    print $c_sock "mg hot v N30\r\n";
+    like(be_read(), qr/^mg hot v N30/, "first autoviv mg sent");
+    like(be_read(), qr/^mg hot v N30/, "second autoviv mg sent");
+    print {be_sock()} "EN\r\nEN\r\n";
+    is(scalar <$p_sock>, "EN\r\n", "first autoviv mg answered");
+    is(scalar <$c_sock>, "EN\r\n", "second autoviv mg answered");
+}
+
+# a backend reset fails the leader and its waiters alike.
+{
+    print $p_sock "get reset\r\n";
+    like(be_read(), qr/^get reset/, "get reaches backend");
+    print $c_sock "get reset\r\n";
+    ok(be_quiet(), "duplicate get not sent");
+    close($be);
+    $be = undef;
+    like(scalar <$p_sock>, qr/^SERVER_ERROR/, "leader fails on reset");
+    like(scalar <$c_sock>, qr/^SERVER_ERROR/, "waiter fails on reset");
+}
+
+# nothing is left attached to the reset connection.
+{
+    print $p_sock "get reset\r\n";
+    like(be_read(), qr/^get reset/, "get after reset reaches backend");
+    be_value('reset', 'back');
+    get_is($p_sock, 'reset', 'back', "get after reset");
+}
+
+{
+    my $stats = mem_stats($p_sock);
+    is($stats->{proxy_req_coalesced}, 2, "coalesced requests counted");
+    $stats = mem_stats($p_sock, 'proxy');
+    is($stats->{user_coalesced}, 2, "coalesce_stat counted");
+}
+
+done_testing();
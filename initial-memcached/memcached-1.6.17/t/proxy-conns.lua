@@ -0,0 +1,16 @@
+-- pooled backend connections for t/proxy-conns.t: three sockets to one
+-- mock backend.
+
+function mcp_config_pools(oldss)
+    mcp.backend_connections(3)
+    return {
+        main = mcp.pool({ mcp.backend('main', '127.0.0.1', 11531) }),
+    }
+end
+
+function mcp_config_routes(p)
+    local main = p.main
+    mcp.attach(mcp.CMD_GET, function(r)
+        return main(r)
+    end)
+end
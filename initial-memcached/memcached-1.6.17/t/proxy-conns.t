@@ -0,0 +1,94 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use IO::Socket::INET;
+use IO::Select;
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+# mock backend, so the test decides when each connection answers.
+my $mock = IO::Socket::INET->new(LocalAddr => '127.0.0.1', LocalPort => 11531,
+    Proto => 'tcp', Listen => 5, ReuseAddr => 1)
+    or die "can't listen on 11531: $!";
+
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-conns.lua -l 127.0.0.1', 11530);
+
+my @be;
+{
+    my $sel = IO::Select->new($mock);
+    while (@be < 3 && $sel->can_read(5)) {
+        push(@be, scalar $mock->accept());
+    }
+}
+is(scalar @be, 3, "proxy opened three connections to the backend");
+
+# next request line on any connection, and which connection it came in on.
+sub be_read {
+    my $sel = IO::Select->new(@be);
+    while (my @ready = $sel->can_read(5)) {
+        for my $s (@ready) {
+            my $line = <$s>;
+            die "backend connection closed" unless defined $line;
+            if ($line =~ /^version/) {
+                print $s "VERSION 1.6.17\r\n";
+                next;
+            }
+            return ($s, $line);
+        }
+    }
+    return (undef, undef);
+}
+
+sub be_value {
+    my ($s, $key, $val) = @_;
+    print $s "VALUE $key 0 " . length($val) . "\r\n$val\r\nEND\r\n";
+}
+
+sub get_is {
+    my ($sock, $key, $val) = @_;
+    is(scalar <$sock>, "VALUE $key 0 " . length($val) . "\r\n", "$key value");
+    is(scalar <$sock>, "$val\r\n", "$key data");
+    is(scalar <$sock>, "END\r\n", "$key end");
+}
+
+# with one request outstanding per connection, each new one goes to an idle
+# connection.
+my @socks = map { $p_srv->new_sock } (1 .. 4);
+my %used;
+my @held;
+for my $n (0 .. 2) {
+    print {$socks[$n]} "get k$n\r\n";
+    my ($s, $line) = be_read();
+    like($line, qr/^get k$n/, "k$n reaches backend");
+    ok(!$used{$s}, "k$n sent on an idle connection");
+    $used{$s} = 1;
+    push(@held, $s);
+}
+
+# all busy now, so the fourth doubles up on one of them.
+print {$socks[3]} "get k3\r\n";
+my ($s3, $line3) = be_read();
+like($line3, qr/^get k3/, "k3 reaches backend");
+ok($used{$s3}, "k3 shares a busy connection");
+
+# answers come back in order per connection.
+be_value($held[$_], "k$_", "v$_") for (0 .. 2);
+be_value($s3, "k3", "v3");
+get_is($socks[$_], "k$_", "v$_") for (0 .. 3);
+
+# every request found how deep its connection's queue was.
+{
+    my $stats = mem_stats($p_srv->sock, 'proxy');
+    is($stats->{'backend_127.0.0.1:11531_depth_1'}, 3, "three sent to idle connections");
+    is($stats->{'backend_127.0.0.1:11531_depth_2'}, 1, "one sent behind another");
+}
+
+done_testing();
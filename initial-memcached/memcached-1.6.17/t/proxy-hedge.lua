@@ -0,0 +1,30 @@
+-- hedged read and adaptive timeout config for t/proxy-hedge.t: a primary
+-- and a replica mock backend, each in its own pool.
+
+function mcp_config_pools(oldss)
+    mcp.hedge_budget(100)
+    mcp.backend_read_timeout(10)
+    mcp.backend_read_timeout_adaptive(4, 0.5)
+    local function pool(name, port)
+        return mcp.pool({ mcp.backend(name, '127.0.0.1', port) },
+            { dist = mcp.dist_jump_hash })
+    end
+    return {
+        primary = pool('primary', 11561),
+        replica = pool('replica', 11562),
+    }
+end
+
+function mcp_config_routes(p)
+    local pools = { p.primary, p.replica }
+    mcp.attach(mcp.CMD_GET, function(r)
+        local restable = mcp.await(r, pools, 1, mcp.AWAIT_HEDGE)
+        for _, res in pairs(restable) do
+            if res:ok() then
+                return res
+            end
+        end
+        return restable[1]
+    end)
+    mcp.attach(mcp.CMD_MG, p.primary)
+end
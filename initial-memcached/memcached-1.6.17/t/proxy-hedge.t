@@ -0,0 +1,136 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use IO::Socket::INET;
+use IO::Select;
+use Time::HiRes qw(time);
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+# mock backends, so the test decides when and whether each one answers.
+my @mock;
+for my $port (11561, 11562) {
+    my $s = IO::Socket::INET->new(LocalAddr => '127.0.0.1', LocalPort => $port,
+        Proto => 'tcp', Listen => 5, ReuseAddr => 1)
+        or die "can't listen on $port: $!";
+    push(@mock, $s);
+}
+my ($PRIMARY, $REPLICA) = (0, 1);
+
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-hedge.lua -l 127.0.0.1', 11560);
+my $started = time;
+my $p_sock = $p_srv->sock;
+
+my @be;
+sub be_sock {
+    my $i = shift;
+    if (!$be[$i]) {
+        my $sel = IO::Select->new($mock[$i]);
+        die "proxy never connected" unless $sel->can_read(5);
+        $be[$i] = scalar $mock[$i]->accept();
+    }
+    return $be[$i];
+}
+
+# next request line the proxy sent to a mock backend.
+sub be_read {
+    my $s = be_sock(shift);
+    while (my $line = <$s>) {
+        if ($line =~ /^version/) {
+            print $s "VERSION 1.6.17\r\n";
+            next;
+        }
+        return $line;
+    }
+    return undef;
+}
+
+# true if the proxy sent nothing more for a little while.
+sub be_quiet {
+    my $sel = IO::Select->new(be_sock(shift));
+    return !$sel->can_read(0.3);
+}
+
+sub be_value {
+    my ($i, $key, $val) = @_;
+    print {be_sock($i)} "VALUE $key 0 " . length($val) . "\r\n$val\r\nEND\r\n";
+}
+
+sub get_is {
+    my ($key, $val, $msg) = @_;
+    is(scalar <$p_sock>, "VALUE $key 0 " . length($val) . "\r\n", "$msg value");
+    is(scalar <$p_sock>, "$val\r\n", "$msg data");
+    is(scalar <$p_sock>, "END\r\n", "$msg end");
+}
+
+# with no latency samples yet there's nothing to hedge on, but a primary
+# that fails still falls back to the replica.
+{
+    print $p_sock "get k1\r\n";
+    is(be_read($PRIMARY), "get k1\r\n", "get sent to primary");
+    ok(be_quiet($REPLICA), "no hedge without samples");
+    close($be[$PRIMARY]);
+    $be[$PRIMARY] = undef;
+    is(be_read($REPLICA), "get k1\r\n", "failed primary retried on replica");
+    be_value($REPLICA, 'k1', 'replica');
+    get_is('k1', 'replica', "fallback");
+}
+
+# give the primary enough quick answers to know its p95 and p99.
+{
+    for (1 .. 256) {
+        print $p_sock "get warm\r\n";
+        be_read($PRIMARY);
+        be_value($PRIMARY, 'warm', 'up');
+        <$p_sock> for 1 .. 3;
+    }
+    my $stats = mem_stats($p_sock, 'proxy');
+    ok($stats->{'backend_127.0.0.1:11561_lat_p95_us'} > 0, "primary p95 known");
+    ok($stats->{'backend_127.0.0.1:11561_lat_p99_us'} > 0, "primary p99 known");
+}
+
+# a primary slower than its p95 gets the read hedged to the replica, and the
+# first good answer wins.
+{
+    print $p_sock "get k2\r\n";
+    is(be_read($PRIMARY), "get k2\r\n", "get sent to primary");
+    is(be_read($REPLICA), "get k2\r\n", "slow primary hedged to replica");
+    be_value($REPLICA, 'k2', 'fast');
+    get_is('k2', 'fast', "hedge");
+    # the late answer is read and dropped.
+    be_value($PRIMARY, 'k2', 'slow');
+
+    print $p_sock "get k3\r\n";
+    is(be_read($PRIMARY), "get k3\r\n", "get sent to primary");
+    be_value($PRIMARY, 'k3', 'fast');
+    get_is('k3', 'fast', "primary after late answer");
+
+    my $stats = mem_stats($p_sock);
+    is($stats->{proxy_hedge_sent}, 2, "hedges counted");
+    is($stats->{proxy_hedge_wins}, 2, "hedge wins counted");
+}
+
+# with samples, the read timeout follows the backend's p99 instead of the
+# fixed timeout: here the 0.5s floor rather than 10s.
+{
+    # the backend threads pick up new timeouts on their 3s clock tick.
+    my $wait = $started + 3.5 - time;
+    select(undef, undef, undef, $wait) if $wait > 0;
+
+    my $start = time;
+    print $p_sock "mg k4 v\r\n";
+    is(be_read($PRIMARY), "mg k4 v\r\n", "mg sent to primary");
+    like(scalar <$p_sock>, qr/^SERVER_ERROR/, "unanswered read times out");
+    my $elapsed = time - $start;
+    ok($elapsed >= 0.4 && $elapsed < 5, "timed out adaptively ($elapsed)");
+}
+
+done_testing();
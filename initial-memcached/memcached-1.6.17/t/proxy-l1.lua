@@ -0,0 +1,29 @@
+-- near-cache config for t/proxy-l1.t: reads and writes go to different
+-- mock backends so the test can hold a write in flight.
+
+function mcp_config_pools(oldss)
+    mcp.l1_size(100)
+    mcp.l1_ttl(30)
+    return {
+        reads = mcp.pool({ mcp.backend('reads', '127.0.0.1', 11511) }),
+        writes = mcp.pool({ mcp.backend('writes', '127.0.0.1', 11512) }),
+    }
+end
+
+function mcp_config_routes(p)
+    local reads = p.reads
+    local writes = p.writes
+
+    mcp.attach(mcp.CMD_GET, function(r)
+        local res = mcp.l1_get(r)
+        if res then
+            return res
+        end
+        res = reads(r)
+        mcp.l1_set(r, res)
+        return res
+    end)
+    mcp.attach(mcp.CMD_SET, function(r)
+        return writes(r)
+    end)
+end
@@ -0,0 +1,96 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use IO::Socket::INET;
+use IO::Select;
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+# mock backends, so the test decides when the backend answers.
+my %mocks;
+for my $port (11511, 11512) {
+    $mocks{$port} = IO::Socket::INET->new(LocalAddr => '127.0.0.1',
+        LocalPort => $port, Proto => 'tcp', Listen => 5, ReuseAddr => 1)
+        or die "can't listen on $port: $!";
+}
+
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-l1.lua -l 127.0.0.1', 11510);
+my $p_sock = $p_srv->sock;
+
+my %be;
+sub be_sock {
+    my $port = shift;
+    if (!$be{$port}) {
+        my $sel = IO::Select->new($mocks{$port});
+        die "proxy never connected to $port" unless $sel->can_read(5);
+        $be{$port} = $mocks{$port}->accept();
+    }
+    return $be{$port};
+}
+
+# next request line the proxy sent to a mock backend.
+sub be_read {
+    my $s = be_sock(shift);
+    while (my $line = <$s>) {
+        if ($line =~ /^version/) {
+            print $s "VERSION 1.6.17\r\n";
+            next;
+        }
+        return $line;
+    }
+    return undef;
+}
+
+sub be_value {
+    my ($port, $key, $val) = @_;
+    my $s = be_sock($port);
+    print $s "VALUE $key 0 " . length($val) . "\r\n$val\r\nEND\r\n";
+}
+
+# a read that races an in-flight write must not leave the old value cached
+# once the write has been answered.
+{
+    print $p_sock "get l1race\r\n";
+    like(be_read(11511), qr/^get l1race/, "first read goes to backend");
+    be_value(11511, 'l1race', 'old');
+    is(scalar <$p_sock>, "VALUE l1race 0 3\r\n", "first read value");
+    is(scalar <$p_sock>, "old\r\n", "first read old");
+    is(scalar <$p_sock>, "END\r\n", "first read end");
+
+    # write arrives at the backend, which holds the reply.
+    my $w_sock = $p_srv->new_sock;
+    print $w_sock "set l1race 0 0 3\r\nnew\r\n";
+    like(be_read(11512), qr/^set l1race/, "write reached backend");
+    my $wbe = be_sock(11512);
+    is(scalar <$wbe>, "new\r\n", "write payload");
+
+    # racing read: the backend hasn't applied the write yet.
+    select(undef, undef, undef, 0.1);
+    print $p_sock "get l1race\r\n";
+    like(be_read(11511), qr/^get l1race/, "racing read misses near-cache");
+    be_value(11511, 'l1race', 'old');
+    is(scalar <$p_sock>, "VALUE l1race 0 3\r\n", "racing read value");
+    is(scalar <$p_sock>, "old\r\n", "racing read old");
+    is(scalar <$p_sock>, "END\r\n", "racing read end");
+
+    print $wbe "STORED\r\n";
+    is(scalar <$w_sock>, "STORED\r\n", "write answered");
+
+    # the racing read's entry must be stale now.
+    print $p_sock "get l1race\r\n";
+    like(be_read(11511), qr/^get l1race/, "read after write goes to backend");
+    be_value(11511, 'l1race', 'new');
+    is(scalar <$p_sock>, "VALUE l1race 0 3\r\n", "new read value");
+    is(scalar <$p_sock>, "new\r\n", "read after write is new");
+    is(scalar <$p_sock>, "END\r\n", "new read end");
+}
+
+done_testing();
@@ -0,0 +1,20 @@
+-- batched multiget config for t/proxy-mget.t: two mock backends behind one
+-- pool. get goes straight to the pool and is batched; gets goes through a
+-- function and is split per key.
+
+function mcp_config_pools(oldss)
+    mcp.batch_multiget(true)
+    return {
+        main = mcp.pool({ mcp.backend('a', '127.0.0.1', 11541),
+            mcp.backend('b', '127.0.0.1', 11542) },
+            { dist = mcp.dist_jump_hash }),
+    }
+end
+
+function mcp_config_routes(p)
+    local main = p.main
+    mcp.attach(mcp.CMD_GET, main)
+    mcp.attach(mcp.CMD_GETS, function(r)
+        return main(r)
+    end)
+end
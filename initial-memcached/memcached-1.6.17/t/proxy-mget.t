@@ -0,0 +1,152 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use IO::Socket::INET;
+use IO::Select;
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+# mock backends, so the test sees exactly what each one is sent.
+my @mock;
+for my $port (11541, 11542) {
+    my $s = IO::Socket::INET->new(LocalAddr => '127.0.0.1', LocalPort => $port,
+        Proto => 'tcp', Listen => 5, ReuseAddr => 1)
+        or die "can't listen on $port: $!";
+    push(@mock, $s);
+}
+
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-mget.lua -l 127.0.0.1', 11540);
+my $p_sock = $p_srv->sock;
+
+my @be;
+sub be_sock {
+    my $i = shift;
+    if (!$be[$i]) {
+        my $sel = IO::Select->new($mock[$i]);
+        die "proxy never connected" unless $sel->can_read(5);
+        $be[$i] = scalar $mock[$i]->accept();
+    }
+    return $be[$i];
+}
+
+# next request line the proxy sent to a mock backend.
+sub be_read {
+    my $s = be_sock(shift);
+    while (my $line = <$s>) {
+        if ($line =~ /^version/) {
+            print $s "VERSION 1.6.17\r\n";
+            next;
+        }
+        return $line;
+    }
+    return undef;
+}
+
+# true if the proxy sent nothing more for a little while.
+sub be_quiet {
+    my $sel = IO::Select->new(be_sock(shift));
+    return !$sel->can_read(0.3);
+}
+
+my @keys = map { "key$_" } (1 .. 12);
+
+# one request per backend, each carrying its keys in the client's order.
+my %owner;
+{
+    print $p_sock "get @keys\r\n";
+    for my $i (0, 1) {
+        my $line = be_read($i);
+        like($line, qr/^get /, "backend $i sent a batch");
+        $line =~ s/\r\n$//;
+        my @sent = split(/ /, $line);
+        shift @sent;
+        ok(scalar @sent > 0, "backend $i has keys");
+        my %want = map { $_ => 1 } @sent;
+        is_deeply(\@sent, [grep { $want{$_} } @keys], "backend $i keys in order");
+        $owner{$_} = $i for @sent;
+        ok(be_quiet($i), "backend $i sent one request");
+    }
+    is(scalar keys %owner, scalar @keys, "every key sent once");
+}
+
+# every other key hits, and the hits come back in the client's order.
+sub answer {
+    my $i = shift;
+    my $res = '';
+    for my $k (grep { $owner{$_} == $i } @keys) {
+        next if ($k =~ /(\d+)$/ && $1 % 2);
+        $res .= "VALUE $k 0 " . length("v$k") . "\r\nv$k\r\n";
+    }
+    print {be_sock($i)} $res . "END\r\n";
+}
+
+{
+    # answer the second backend first so the merge has to reorder.
+    answer(1);
+    answer(0);
+    my $want = '';
+    for my $k (@keys) {
+        next if ($k =~ /(\d+)$/ && $1 % 2);
+        $want .= "VALUE $k 0 " . length("v$k") . "\r\nv$k\r\n";
+    }
+    $want .= "END\r\n";
+    my $got = '';
+    while (my $line = <$p_sock>) {
+        $got .= $line;
+        last if $line eq "END\r\n";
+    }
+    is($got, $want, "batches merged in key order");
+}
+
+# a backend that fails turns each of its keys into an error, in place.
+{
+    print $p_sock "get @keys\r\n";
+    like(be_read(0), qr/^get /, "backend 0 sent a batch");
+    like(be_read(1), qr/^get /, "backend 1 sent a batch");
+    answer(0);
+    close($be[1]);
+    $be[1] = undef;
+    my $want = '';
+    for my $k (@keys) {
+        if ($owner{$k} == 1) {
+            $want .= "SERVER_ERROR backend failure\r\n";
+        } elsif ($k =~ /(\d+)$/ && $1 % 2 == 0) {
+            $want .= "VALUE $k 0 " . length("v$k") . "\r\nv$k\r\n";
+        }
+    }
+    $want .= "END\r\n";
+    my $got = '';
+    while (my $line = <$p_sock>) {
+        $got .= $line;
+        last if $line eq "END\r\n";
+    }
+    is($got, $want, "failed batch stitched in as errors");
+}
+
+# a hook function only sees the first key, so its multigets aren't batched.
+{
+    my ($k1, $k2) = grep { $owner{$_} == 0 } @keys;
+    print $p_sock "gets $k1 $k2\r\n";
+    # sub-requests can reach the backend in either order.
+    my @sent = sort(be_read(0), be_read(0));
+    is_deeply(\@sent, [sort("gets $k1\r\n", "gets $k2\r\n")],
+        "function hook sends each key alone");
+    print {be_sock(0)} "END\r\nEND\r\n";
+    is(scalar <$p_sock>, "END\r\n", "unbatched multiget answered");
+}
+
+{
+    my $stats = mem_stats($p_sock);
+    is($stats->{proxy_mget_keys}, 24, "batched keys counted");
+    is($stats->{proxy_mget_batches}, 4, "batches counted");
+}
+
+done_testing();
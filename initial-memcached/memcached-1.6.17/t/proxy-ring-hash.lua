@@ -0,0 +1,34 @@
+-- ring_hash pools for t/proxy-ring-hash.t. Every 127.0.0.x address reaches
+-- the one backend, so each gets its own points on the ring. Debug builds
+-- check each ring against the old binary search as it's built.
+
+local modes = { "default", "ketama", "twemproxy", "evcache" }
+
+function mcp_config_pools(oldss)
+    local pools = {}
+    for _, mode in ipairs(modes) do
+        local bes = {}
+        for x = 1, 40 do
+            table.insert(bes, mcp.backend(mode .. x, '127.0.0.' .. x, 11611))
+        end
+        pools[mode] = mcp.pool(bes, { dist = mcp.dist_ring_hash,
+            omode = mode, hash = mcp.dist_ring_hash.hash })
+        pools[mode .. "_small"] = mcp.pool({ bes[1], bes[2], bes[3] },
+            { dist = mcp.dist_ring_hash, omode = mode,
+              hash = mcp.dist_ring_hash.hash, obuckets = 7 })
+        pools[mode .. "_one"] = mcp.pool({ bes[1] },
+            { dist = mcp.dist_ring_hash, omode = mode,
+              hash = mcp.dist_ring_hash.hash, obuckets = 1 })
+    end
+    return pools
+end
+
+function mcp_config_routes(pools)
+    mcp.attach(mcp.CMD_ANY_STORAGE, function(r)
+        local pool = pools[string.match(r:key(), "^/([%w_]+)/")]
+        if pool == nil then
+            return "SERVER_ERROR no pool\r\n"
+        end
+        return pool(r)
+    end)
+end
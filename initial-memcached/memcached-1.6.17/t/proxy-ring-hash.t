@@ -0,0 +1,32 @@
+#!/usr/bin/env perl
+# ring_hash pools in every omode. memcached-debug checks each ring's jump
+# table against the old binary search when the pools are built.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+my $be_srv = new_memcached('-l 0.0.0.0', 11611);
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-ring-hash.lua -l 127.0.0.1', 11610);
+my $p_sock = $p_srv->sock;
+
+for my $mode (qw/default ketama twemproxy evcache/) {
+    for my $pool ($mode, "${mode}_small", "${mode}_one") {
+        for my $n (1 .. 20) {
+            my $key = "/$pool/key$n";
+            print $p_sock "set $key 0 0 2\r\nok\r\n";
+            is(scalar <$p_sock>, "STORED\r\n", "stored $key");
+            mem_get_is($p_sock, $key, "ok");
+        }
+    }
+}
+
+done_testing();
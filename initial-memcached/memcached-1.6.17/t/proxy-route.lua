@@ -0,0 +1,26 @@
+-- route table config for t/proxy-route.t: three mock backends, each in its
+-- own pool, picked by key prefix.
+
+function mcp_config_pools(oldss)
+    local function pool(name, port)
+        return mcp.pool({ mcp.backend(name, '127.0.0.1', port) },
+            { dist = mcp.dist_jump_hash })
+    end
+    return {
+        a = pool('a', 11551),
+        b = pool('b', 11552),
+        c = pool('c', 11553),
+    }
+end
+
+function mcp_config_routes(p)
+    local a = p.a
+    local rt = mcp.route_table({
+        ["/a/"] = p.a,
+        ["/a/b/"] = p.b,
+        ["/fo/"] = { p.b, p.c },
+    }, function(r)
+        return a(r)
+    end)
+    mcp.attach(mcp.CMD_ANY_STORAGE, rt)
+end
@@ -0,0 +1,140 @@
+#!/usr/bin/env perl
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use IO::Socket::INET;
+use IO::Select;
+use MemcachedTest;
+
+if (!supports_proxy()) {
+    plan skip_all => 'proxy not enabled';
+    exit 0;
+}
+
+# mock backends, so the test sees which one each request lands on.
+my @mock;
+for my $port (11551, 11552, 11553) {
+    my $s = IO::Socket::INET->new(LocalAddr => '127.0.0.1', LocalPort => $port,
+        Proto => 'tcp', Listen => 5, ReuseAddr => 1)
+        or die "can't listen on $port: $!";
+    push(@mock, $s);
+}
+my ($A, $B, $C) = (0, 1, 2);
+
+my $p_srv = new_memcached('-o proxy_config=./t/proxy-route.lua -l 127.0.0.1', 11550);
+my $p_sock = $p_srv->sock;
+
+my @be;
+sub be_sock {
+    my $i = shift;
+    if (!$be[$i]) {
+        my $sel = IO::Select->new($mock[$i]);
+        die "proxy never connected" unless $sel->can_read(5);
+        $be[$i] = scalar $mock[$i]->accept();
+    }
+    return $be[$i];
+}
+
+# next request line the proxy sent to a mock backend.
+sub be_read {
+    my $s = be_sock(shift);
+    while (my $line = <$s>) {
+        if ($line =~ /^version/) {
+            print $s "VERSION 1.6.17\r\n";
+            next;
+        }
+        return $line;
+    }
+    return undef;
+}
+
+sub be_value {
+    my ($i, $key, $val) = @_;
+    print {be_sock($i)} "VALUE $key 0 " . length($val) . "\r\n$val\r\nEND\r\n";
+}
+
+sub get_is {
+    my ($key, $val, $msg) = @_;
+    is(scalar <$p_sock>, "VALUE $key 0 " . length($val) . "\r\n", "$msg value");
+    is(scalar <$p_sock>, "$val\r\n", "$msg data");
+    is(scalar <$p_sock>, "END\r\n", "$msg end");
+}
+
+# keys go to the pool of their longest matching prefix.
+{
+    print $p_sock "get /a/1\r\n";
+    is(be_read($A), "get /a/1\r\n", "prefix routed to its pool");
+    be_value($A, '/a/1', 'one');
+    get_is('/a/1', 'one', "prefix route");
+
+    print $p_sock "get /a/b/1\r\n";
+    is(be_read($B), "get /a/b/1\r\n", "longest prefix wins");
+    be_value($B, '/a/b/1', 'two');
+    get_is('/a/b/1', 'two', "longer prefix route");
+
+    print $p_sock "get /zz/1\r\n";
+    is(be_read($A), "get /zz/1\r\n", "unmatched key runs the default function");
+    be_value($A, '/zz/1', 'three');
+    get_is('/zz/1', 'three', "default route");
+}
+
+# values are read in for both table routes and function routes.
+{
+    print $p_sock "set /a/b/s 0 0 2\r\nhi\r\n";
+    is(be_read($B), "set /a/b/s 0 0 2\r\n", "table route set sent");
+    is(be_read($B), "hi\r\n", "table route set value sent");
+    print {be_sock($B)} "STORED\r\n";
+    is(scalar <$p_sock>, "STORED\r\n", "table route set stored");
+
+    print $p_sock "set /zz/s 0 0 2\r\nho\r\n";
+    is(be_read($A), "set /zz/s 0 0 2\r\n", "function route set sent");
+    is(be_read($A), "ho\r\n", "function route set value sent");
+    print {be_sock($A)} "STORED\r\n";
+    is(scalar <$p_sock>, "STORED\r\n", "function route set stored");
+}
+
+# a SERVER_ERROR from the pool is retried once on the failover pool.
+{
+    print $p_sock "get /fo/1\r\n";
+    is(be_read($B), "get /fo/1\r\n", "request sent to primary");
+    print {be_sock($B)} "SERVER_ERROR out of memory\r\n";
+    is(be_read($C), "get /fo/1\r\n", "error retried on failover");
+    be_value($C, '/fo/1', 'four');
+    get_is('/fo/1', 'four', "failover after SERVER_ERROR");
+
+    print $p_sock "get /fo/2\r\n";
+    is(be_read($B), "get /fo/2\r\n", "request sent to primary");
+    print {be_sock($B)} "SERVER_ERROR out of memory\r\n";
+    is(be_read($C), "get /fo/2\r\n", "error retried on failover");
+    print {be_sock($C)} "SERVER_ERROR busy\r\n";
+    is(scalar <$p_sock>, "SERVER_ERROR busy\r\n", "failover only tried once");
+}
+
+# so is a primary that goes away.
+{
+    print $p_sock "get /fo/3\r\n";
+    is(be_read($B), "get /fo/3\r\n", "request sent to primary");
+    close($be[$B]);
+    $be[$B] = undef;
+    is(be_read($C), "get /fo/3\r\n", "reset retried on failover");
+    be_value($C, '/fo/3', 'five');
+    get_is('/fo/3', 'five', "failover after reset");
+}
+
+# misses and other answers from the primary are final.
+{
+    print $p_sock "get /fo/4\r\n";
+    is(be_read($B), "get /fo/4\r\n", "request sent to primary");
+    print {be_sock($B)} "END\r\n";
+    is(scalar <$p_sock>, "END\r\n", "miss not retried");
+}
+
+{
+    my $stats = mem_stats($p_sock);
+    is($stats->{proxy_route_failovers}, 3, "failovers counted");
+}
+
+done_testing();
@@ -0,0 +1,61 @@
+#!/usr/bin/env perl
+# Per-worker SO_REUSEPORT listeners.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+sub thread_conns {
+    my $sock = shift;
+    my $stats = mem_stats($sock, 'threads');
+    my %conns;
+    for my $key (keys %$stats) {
+        $conns{$1} = $stats->{$key} if $key =~ /^(\d+):conns$/;
+    }
+    return \%conns;
+}
+
+my $server = new_memcached('-t 4 -o reuseport_listen');
+my $sock = $server->sock;
+
+my $settings = mem_stats($sock, ' settings');
+is($settings->{reuseport_listen}, "yes", "reuseport_listen setting");
+
+my @socks = map { $server->new_sock } (1 .. 31);
+for my $s (@socks) {
+    print $s "set rpkey 0 0 1\r\na\r\n";
+    is(scalar <$s>, "STORED\r\n", "stored through new conn");
+    mem_get_is($s, "rpkey", "a");
+}
+
+my $conns = thread_conns($sock);
+my $total = 0;
+$total += $_ for values %$conns;
+is($total, 32, "accepted conns counted by their worker");
+# the kernel hashes each conn to a listener, so with 32 conns more than one
+# worker should have accepted some.
+cmp_ok(scalar(grep { $_ > 0 } values %$conns), '>', 1, "accepts spread over workers");
+
+my $stats = mem_stats($sock);
+cmp_ok($stats->{curr_connections}, '>=', 32, "curr_connections includes accepted conns");
+
+close($_) for @socks;
+for (1 .. 10) {
+    $conns = thread_conns($sock);
+    $total = 0;
+    $total += $_ for values %$conns;
+    last if $total == 1;
+    sleep 1;
+}
+is($total, 1, "closed conns uncounted");
+
+# the kernel already picks the worker.
+eval {
+    new_memcached('-o reuseport_listen,dispatch_mode=load');
+};
+ok($@, "reuseport_listen refuses dispatch_mode=load");
+
+done_testing();
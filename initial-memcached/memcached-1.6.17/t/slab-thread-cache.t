@@ -0,0 +1,61 @@
+#!/usr/bin/env perl
+# Per-worker slab chunk caches: counts stay whole and the mover still works.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $server = new_memcached('-m 4 -o slab_thread_cache,slab_reassign,slab_automove=0');
+my $sock = $server->sock;
+
+my $stats = mem_stats($sock, ' settings');
+is($stats->{slab_thread_cache}, "yes", "slab_thread_cache enabled");
+
+my $data = 'x' x 1000;
+for (1 .. 8000) {
+    print $sock "set tkey$_ 0 0 1000 noreply\r\n$data\r\n";
+}
+mem_get_is($sock, "tkey8000", $data);
+
+my $items = mem_stats($sock, "items");
+my ($clsid) = map { /^items:(\d+):number$/ ? $1 : () } keys %$items;
+ok(defined $clsid, "found slab class in use");
+isnt($items->{"items:$clsid:evicted"}, 0, "class evicted");
+
+# freed chunks land in the thread cache, but are still counted as free.
+for (7000 .. 8000) {
+    print $sock "delete tkey$_ noreply\r\n";
+}
+mem_get_is($sock, "tkey8000", undef);
+
+my $slabs = mem_stats($sock, "slabs");
+cmp_ok($slabs->{"$clsid:free_chunks"}, '>=', 1000, "deleted chunks are free");
+is($slabs->{"$clsid:used_chunks"} + $slabs->{"$clsid:free_chunks"},
+    $slabs->{"$clsid:total_chunks"}, "used + free == total");
+
+# move a page out of the class; cached chunks must be drained first.
+print $sock "slabs reassign $clsid 0\r\n";
+is(scalar <$sock>, "OK\r\n", "slab rebalancer started");
+
+for (1 .. 20) {
+    $stats = mem_stats($sock);
+    last if $stats->{slabs_moved} && !$stats->{slab_reassign_running};
+    sleep 1;
+}
+is($stats->{slabs_moved}, 1, "page moved");
+
+my $after = mem_stats($sock, "slabs");
+is($after->{"$clsid:total_pages"}, $slabs->{"$clsid:total_pages"} - 1,
+    "class lost a page");
+is($after->{"$clsid:used_chunks"} + $after->{"$clsid:free_chunks"},
+    $after->{"$clsid:total_chunks"}, "used + free == total after move");
+
+for (1 .. 2000) {
+    print $sock "set nkey$_ 0 0 1000 noreply\r\n$data\r\n";
+}
+mem_get_is($sock, "nkey2000", $data);
+
+done_testing();
@@ -0,0 +1,40 @@
+#!/usr/bin/env perl
+# Prefix stats are counted per worker thread and merged on dump.
+
+use strict;
+use warnings;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $server = new_memcached('-D : -t 4');
+
+# round robin dispatch spreads these over every worker.
+my @socks = map { $server->new_sock } (1 .. 8);
+for my $sock (@socks) {
+    print $sock "set foo:a 0 0 1\r\na\r\n";
+    is(scalar <$sock>, "STORED\r\n", "stored foo:a");
+    mem_get_is($sock, "foo:a", "a");
+    mem_get_is($sock, "bar:b", undef);
+    print $sock "delete foo:nope\r\n";
+    is(scalar <$sock>, "NOT_FOUND\r\n", "delete miss");
+}
+
+my $sock = $server->sock;
+print $sock "stats detail dump\r\n";
+my %lines;
+while (my $line = <$sock>) {
+    last if $line eq "END\r\n";
+    $lines{$line} = 1;
+}
+ok($lines{"PREFIX foo get 8 hit 8 set 8 del 8\r\n"}, "foo prefix merged");
+ok($lines{"PREFIX bar get 8 hit 0 set 0 del 0\r\n"}, "bar prefix merged");
+is(scalar keys %lines, 2, "only two prefixes");
+
+print $sock "stats reset\r\n";
+is(scalar <$sock>, "RESET\r\n", "stats reset");
+print $sock "stats detail dump\r\n";
+is(scalar <$sock>, "END\r\n", "prefix stats cleared on every thread");
+
+done_testing();
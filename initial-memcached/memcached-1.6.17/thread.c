@@ -39,6 +39,9 @@ enum conn_queue_item_modes {
     queue_redispatch, /* return conn from side thread */
     queue_stop,       /* exit thread */
     queue_return_io,  /* returning a pending IO object immediately */
+    queue_rebalance,  /* hand idle conns to the worker numbered sfd */
+    queue_listen,     /* take ownership of a SO_REUSEPORT listener */
+    queue_listen_pause, /* stop accepting on own listeners until fds free up */
 #ifdef PROXY
     queue_proxy_reload, /* signal proxy to reload worker VM */
 #endif
@@ -53,6 +56,7 @@ struct conn_queue_item {
     enum conn_queue_item_modes mode;
     conn *c;
     void    *ssl;
+    bool     ssl_enabled; // for listeners handed over with queue_listen
     uint64_t conntag;
     enum protocol bproto;
     io_pending_t *io; // IO when used for deferred IO handling.
@@ -396,6 +400,13 @@ void accept_new_conns(const bool do_accept) {
     pthread_mutex_lock(&conn_lock);
     do_accept_new_conns(do_accept);
     pthread_mutex_unlock(&conn_lock);
+    // workers own their listeners' events, and resume them on their own
+    // once allow_new_conns is set again.
+    if (!do_accept && settings.reuseport_listen) {
+        for (int i = 0; i < settings.num_threads; i++) {
+            notify_worker_fd(&threads[i], 0, queue_listen_pause);
+        }
+    }
 }
 /****************************** LIBEVENT THREADS *****************************/
 
@@ -510,6 +521,8 @@ static void *worker_libevent(void *arg) {
     if (me->l == NULL || me->lru_bump_buf == NULL) {
         abort();
     }
+    slabs_cache_thread_init();
+    stats_prefix_thread_init();
 
     if (settings.drop_privileges) {
         drop_worker_privileges();
@@ -534,6 +547,45 @@ static void *worker_libevent(void *arg) {
 // Syscalls can be expensive enough that handling a few of them once here can
 // save both throughput and overall latency.
 #define MAX_PIPE_EVENTS 32
+/*
+ * Creates a client connection on the calling worker. The caller has already
+ * counted it in me->conns.
+ */
+static void thread_conn_new(LIBEVENT_THREAD *me, int sfd, enum conn_states init_state,
+        int event_flags, int read_buffer_size, enum network_transport transport,
+        void *ssl, uint64_t conntag, enum protocol bproto) {
+    conn *c = conn_new(sfd, init_state, event_flags, read_buffer_size,
+            transport, me->base, ssl, conntag, bproto);
+    if (c == NULL) {
+        __atomic_fetch_sub(&me->conns, 1, __ATOMIC_RELAXED);
+        if (IS_UDP(transport)) {
+            fprintf(stderr, "Can't listen for events on UDP socket\n");
+            exit(1);
+        } else {
+            if (settings.verbose > 0) {
+                fprintf(stderr, "Can't listen for events on fd %d\n", sfd);
+            }
+#ifdef TLS
+            if (ssl) {
+                SSL_shutdown(ssl);
+                SSL_free(ssl);
+            }
+#endif
+            close(sfd);
+        }
+    } else {
+        c->thread = me;
+        conn_thread_link(c);
+        conn_io_queue_setup(c);
+#ifdef TLS
+        if (settings.ssl_enabled && c->ssl != NULL) {
+            assert(c->thread && c->thread->ssl_wbuf);
+            c->ssl_wbuf = c->thread->ssl_wbuf;
+        }
+#endif
+    }
+}
+
 static void thread_libevent_process(evutil_socket_t fd, short which, void *arg) {
     LIBEVENT_THREAD *me = arg;
     CQ_ITEM *item;
@@ -567,36 +619,9 @@ static void thread_libevent_process(evutil_socket_t fd, short which, void *arg)
 
         switch (item->mode) {
             case queue_new_conn:
-                c = conn_new(item->sfd, item->init_state, item->event_flags,
-                                   item->read_buffer_size, item->transport,
-                                   me->base, item->ssl, item->conntag, item->bproto);
-                if (c == NULL) {
-                    if (IS_UDP(item->transport)) {
-                        fprintf(stderr, "Can't listen for events on UDP socket\n");
-                        exit(1);
-                    } else {
-                        if (settings.verbose > 0) {
-                            fprintf(stderr, "Can't listen for events on fd %d\n",
-                                item->sfd);
-                        }
-#ifdef TLS
-                        if (item->ssl) {
-                            SSL_shutdown(item->ssl);
-                            SSL_free(item->ssl);
-                        }
-#endif
-                        close(item->sfd);
-                    }
-                } else {
-                    c->thread = me;
-                    conn_io_queue_setup(c);
-#ifdef TLS
-                    if (settings.ssl_enabled && c->ssl != NULL) {
-                        assert(c->thread && c->thread->ssl_wbuf);
-                        c->ssl_wbuf = c->thread->ssl_wbuf;
-                    }
-#endif
-                }
+                thread_conn_new(me, item->sfd, item->init_state, item->event_flags,
+                        item->read_buffer_size, item->transport, item->ssl,
+                        item->conntag, item->bproto);
                 break;
             case queue_pause:
                 /* we were told to pause and report in */
@@ -618,6 +643,25 @@ static void thread_libevent_process(evutil_socket_t fd, short which, void *arg)
                 /* getting an individual IO object back */
                 conn_io_queue_return(item->io);
                 break;
+            case queue_rebalance:
+                conn_worker_rebalance(me, threads + item->sfd);
+                break;
+            case queue_listen:
+                c = conn_new(item->sfd, conn_listening, EV_READ | EV_PERSIST, 1,
+                        item->transport, me->base, NULL, item->conntag, item->bproto);
+                if (c == NULL) {
+                    fprintf(stderr, "failed to create listening connection\n");
+                    exit(EXIT_FAILURE);
+                }
+                c->thread = me;
+#ifdef TLS
+                c->ssl_enabled = item->ssl_enabled;
+#endif
+                listen_conn_register(c);
+                break;
+            case queue_listen_pause:
+                worker_accept_new_conns(me, false);
+                break;
 #ifdef PROXY
             case queue_proxy_reload:
                 proxy_worker_reload(settings.proxy_ctx, me);
@@ -650,6 +694,112 @@ static LIBEVENT_THREAD *select_thread_round_robin(void)
     return threads + tid;
 }
 
+/* Utilization is only sampled once a second, so threads within this many
+ * percent of each other are compared by connection count instead. */
+#define LOAD_UTIL_SLACK 10
+/* Minimum utilization gap between two workers before idle conns move. */
+#define LOAD_REBALANCE_GAP 25
+
+static bool thread_less_loaded(LIBEVENT_THREAD *a, LIBEVENT_THREAD *b) {
+    if (a->util + LOAD_UTIL_SLACK < b->util)
+        return true;
+    if (b->util + LOAD_UTIL_SLACK < a->util)
+        return false;
+    return __atomic_load_n(&a->conns, __ATOMIC_RELAXED) <
+        __atomic_load_n(&b->conns, __ATOMIC_RELAXED);
+}
+
+/* Pick the least loaded worker. Starts scanning after the last pick so ties
+ * still spread out round robin. */
+static LIBEVENT_THREAD *select_thread_by_load(void)
+{
+    LIBEVENT_THREAD *best = NULL;
+    int start = last_thread + 1;
+
+    for (int i = 0; i < settings.num_threads; i++) {
+        LIBEVENT_THREAD *t = threads + (start + i) % settings.num_threads;
+        if (best == NULL || thread_less_loaded(t, best))
+            best = t;
+    }
+
+    last_thread = best - threads;
+    return best;
+}
+
+uint64_t thread_clock_ns(void) {
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000000 + (uint64_t)tv.tv_usec * 1000;
+#endif
+}
+
+/* Called once a second from the main thread's clock handler. Samples how
+ * busy each worker was and, if asked to, has an overloaded worker hand some
+ * idle connections to the least loaded one. */
+void threads_load_update(void) {
+    static uint64_t last_ns = 0;
+    LIBEVENT_THREAD *busiest = NULL, *idlest = NULL;
+    uint64_t now, elapsed;
+
+    if (threads == NULL)
+        return;
+
+    now = thread_clock_ns();
+    elapsed = now - last_ns;
+    for (int i = 0; i < settings.num_threads; i++) {
+        LIBEVENT_THREAD *t = threads + i;
+        uint64_t busy = __atomic_load_n(&t->busy_ns, __ATOMIC_RELAXED);
+        if (last_ns != 0 && elapsed != 0) {
+            uint64_t util = (busy - t->busy_ns_last) * 100 / elapsed;
+            t->util = util > 100 ? 100 : util;
+        }
+        t->busy_ns_last = busy;
+
+        if (busiest == NULL || t->util > busiest->util)
+            busiest = t;
+        if (idlest == NULL || thread_less_loaded(t, idlest))
+            idlest = t;
+    }
+    last_ns = now;
+
+    if (settings.dispatch_rebalance && busiest != idlest
+            && busiest->util >= idlest->util + LOAD_REBALANCE_GAP
+            && __atomic_load_n(&busiest->conns, __ATOMIC_RELAXED) >
+               __atomic_load_n(&idlest->conns, __ATOMIC_RELAXED) + 1) {
+        notify_worker_fd(busiest, idlest - threads, queue_rebalance);
+    }
+}
+
+void threads_stats(ADD_STAT add_stats, void *c) {
+    char key_str[STAT_KEY_LEN];
+    char val_str[STAT_VAL_LEN];
+    int klen = 0, vlen = 0;
+
+    for (int i = 0; i < settings.num_threads; i++) {
+        LIBEVENT_THREAD *t = threads + i;
+        uint64_t rebalanced;
+
+        pthread_mutex_lock(&t->stats.mutex);
+        rebalanced = t->stats.conns_rebalanced;
+        pthread_mutex_unlock(&t->stats.mutex);
+
+        APPEND_NUM_STAT(i, "conns", "%llu",
+                (unsigned long long)__atomic_load_n(&t->conns, __ATOMIC_RELAXED));
+        APPEND_NUM_STAT(i, "util", "%u", t->util);
+        APPEND_NUM_STAT(i, "busy_us", "%llu",
+                (unsigned long long)__atomic_load_n(&t->busy_ns, __ATOMIC_RELAXED) / 1000);
+        APPEND_NUM_STAT(i, "conns_rebalanced", "%llu",
+                (unsigned long long)rebalanced);
+    }
+
+    add_stats(NULL, 0, NULL, 0, c);
+}
+
 static void reset_threads_napi_id(void)
 {
     LIBEVENT_THREAD *thread;
@@ -720,10 +870,12 @@ void dispatch_conn_new(int sfd, enum conn_states init_state, int event_flags,
     CQ_ITEM *item = NULL;
     LIBEVENT_THREAD *thread;
 
-    if (!settings.num_napi_ids)
-        thread = select_thread_round_robin();
-    else
+    if (settings.num_napi_ids)
         thread = select_thread_by_napi_id(sfd);
+    else if (settings.dispatch_load)
+        thread = select_thread_by_load();
+    else
+        thread = select_thread_round_robin();
 
     item = cqi_new(thread->ev_queue);
     if (item == NULL) {
@@ -743,10 +895,50 @@ void dispatch_conn_new(int sfd, enum conn_states init_state, int event_flags,
     item->conntag = conntag;
     item->bproto = bproto;
 
+    // counted here rather than by the worker so a burst of new conns is
+    // spread out before the workers catch up.
+    __atomic_fetch_add(&thread->conns, 1, __ATOMIC_RELAXED);
+
     MEMCACHED_CONN_DISPATCH(sfd, (int64_t)thread->thread_id);
     notify_worker(thread, item);
 }
 
+/*
+ * Creates a connection accepted by one of the worker's own listeners without
+ * going through the connection queue.
+ */
+void dispatch_conn_local(LIBEVENT_THREAD *me, int sfd, enum conn_states init_state,
+        int event_flags, int read_buffer_size, enum network_transport transport,
+        void *ssl, uint64_t conntag, enum protocol bproto) {
+    __atomic_fetch_add(&me->conns, 1, __ATOMIC_RELAXED);
+    MEMCACHED_CONN_DISPATCH(sfd, (int64_t)me->thread_id);
+    thread_conn_new(me, sfd, init_state, event_flags, read_buffer_size,
+            transport, ssl, conntag, bproto);
+}
+
+/*
+ * Hands a listening socket to worker number tid, which registers it on its
+ * own event base. Used at startup for SO_REUSEPORT listeners.
+ */
+void dispatch_listen_conn(int tid, int sfd, enum network_transport transport,
+        bool ssl_enabled, uint64_t conntag, enum protocol bproto) {
+    LIBEVENT_THREAD *thread = threads + tid;
+    CQ_ITEM *item = cqi_new(thread->ev_queue);
+    if (item == NULL) {
+        fprintf(stderr, "Failed to allocate memory for listening connection\n");
+        exit(EXIT_FAILURE);
+    }
+
+    item->sfd = sfd;
+    item->transport = transport;
+    item->mode = queue_listen;
+    item->ssl_enabled = ssl_enabled;
+    item->conntag = conntag;
+    item->bproto = bproto;
+
+    notify_worker(thread, item);
+}
+
 /*
  * Re-dispatches a connection back to the original thread. Can be called from
  * any side thread borrowing a connection.